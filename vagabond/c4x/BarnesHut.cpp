@@ -0,0 +1,234 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Please email: vagabond @ hginn.co.uk for more details.
+
+#include "BarnesHut.h"
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+
+/* identical points cannot be separated by subdivision, so stop here and
+ * let them share a cell */
+#define MAX_DEPTH 48
+
+BarnesHut::BarnesHut(const PCA::Matrix &points, float theta)
+{
+	_dims = points.cols;
+	_theta = theta;
+
+	if (_dims < 1 || _dims > 3)
+	{
+		throw std::runtime_error("Barnes-Hut tree only supports one to "
+		                         "three dimensions");
+	}
+
+	_split = 1 << _dims;
+	_positions.resize(points.rows * _dims);
+
+	double min[3] = {0, 0, 0};
+	double max[3] = {0, 0, 0};
+
+	for (size_t i = 0; i < points.rows; i++)
+	{
+		for (size_t k = 0; k < _dims; k++)
+		{
+			double v = points[i][k];
+			_positions[i * _dims + k] = v;
+			min[k] = (i == 0 ? v : std::min(min[k], v));
+			max[k] = (i == 0 ? v : std::max(max[k], v));
+		}
+	}
+
+	Cell root{};
+	root.half = 0;
+	for (size_t k = 0; k < _dims; k++)
+	{
+		root.centre[k] = (min[k] + max[k]) / 2;
+		root.half = std::max(root.half, (max[k] - min[k]) / 2);
+	}
+
+	/* keep every point strictly inside the root cell */
+	root.half = root.half * 1.001 + 1e-6;
+
+	_cells.reserve(points.rows * 2);
+	_cells.push_back(root);
+
+	for (size_t i = 0; i < points.rows; i++)
+	{
+		insert(0, i, 0);
+	}
+}
+
+int BarnesHut::childFor(const Cell &cell, const double *pos) const
+{
+	int idx = 0;
+	for (size_t k = 0; k < _dims; k++)
+	{
+		if (pos[k] >= cell.centre[k])
+		{
+			idx |= (1 << k);
+		}
+	}
+
+	return idx;
+}
+
+void BarnesHut::addToMass(Cell &cell, const double *pos)
+{
+	cell.count++;
+
+	for (size_t k = 0; k < _dims; k++)
+	{
+		cell.mass[k] += (pos[k] - cell.mass[k]) / cell.count;
+	}
+}
+
+void BarnesHut::subdivide(int idx)
+{
+	int first = _cells.size();
+
+	for (size_t i = 0; i < _split; i++)
+	{
+		const Cell &parent = _cells[idx];
+		Cell child{};
+		child.half = parent.half / 2;
+
+		for (size_t k = 0; k < _dims; k++)
+		{
+			float dir = (i & (1 << k)) ? 1 : -1;
+			child.centre[k] = parent.centre[k] + dir * child.half;
+			child.mass[k] = 0;
+		}
+
+		_cells.push_back(child);
+	}
+
+	_cells[idx].children = first;
+}
+
+void BarnesHut::insert(int idx, int point, int depth)
+{
+	const double *pos = position(point);
+
+	while (true)
+	{
+		addToMass(_cells[idx], pos);
+		Cell &cell = _cells[idx];
+
+		if (cell.children >= 0)
+		{
+			idx = cell.children + childFor(cell, pos);
+			depth++;
+			continue;
+		}
+
+		if (cell.count == 1)
+		{
+			cell.point = point;
+			return;
+		}
+
+		if (depth >= MAX_DEPTH)
+		{
+			return;
+		}
+
+		/* leaf already held a single point: push it down a level and carry
+		 * on placing the new point */
+		int old = cell.point;
+		subdivide(idx);
+
+		Cell &split = _cells[idx];
+		split.point = -1;
+
+		int oldIdx = split.children + childFor(split, position(old));
+		addToMass(_cells[oldIdx], position(old));
+		_cells[oldIdx].point = old;
+
+		idx = split.children + childFor(split, pos);
+		depth++;
+	}
+}
+
+double BarnesHut::repulsion(int i, double *force) const
+{
+	const double *pos = position(i);
+	double z = 0;
+
+	for (size_t k = 0; k < _dims; k++)
+	{
+		force[k] = 0;
+	}
+
+	/* second member is true if the cell lies on point i's own path down the
+	 * tree, so that i itself can be taken out of the cell's mass */
+	std::vector<std::pair<int, bool> > stack;
+	stack.push_back(std::make_pair(0, true));
+	const double theta_sq = _theta * _theta;
+
+	while (stack.size())
+	{
+		int idx = stack.back().first;
+		bool path = stack.back().second;
+		stack.pop_back();
+
+		const Cell &cell = _cells[idx];
+		if (cell.count == 0)
+		{
+			continue;
+		}
+
+		double diff[3];
+		double dsq = 0;
+		for (size_t k = 0; k < _dims; k++)
+		{
+			diff[k] = pos[k] - cell.mass[k];
+			dsq += diff[k] * diff[k];
+		}
+
+		double width = 2 * cell.half;
+		bool summarise = (cell.children < 0 || width * width < theta_sq * dsq);
+
+		if (!summarise)
+		{
+			int mine = (path ? childFor(cell, pos) : -1);
+			for (size_t j = 0; j < _split; j++)
+			{
+				stack.push_back(std::make_pair(cell.children + j,
+				                               (int)j == mine));
+			}
+
+			continue;
+		}
+
+		double members = cell.count - (path ? 1 : 0);
+		if (members <= 0)
+		{
+			continue;
+		}
+
+		double w = 1 / (1 + dsq);
+		z += members * w;
+
+		for (size_t k = 0; k < _dims; k++)
+		{
+			force[k] += members * w * w * diff[k];
+		}
+	}
+
+	return z;
+}
@@ -0,0 +1,70 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Please email: vagabond @ hginn.co.uk for more details.
+
+#ifndef __vagabond__BarnesHut__
+#define __vagabond__BarnesHut__
+
+#include <vector>
+#include <vagabond/utils/svd/PCA.h>
+
+/** \class BarnesHut
+ *  space-partitioning tree (quadtree in 2D, octree in 3D) over the rows of
+ *  an embedding, used to approximate the t-SNE repulsion between a point
+ *  and all others. Cells which appear smaller than theta from the point
+ *  are treated as a single mass at their centre. */
+
+class BarnesHut
+{
+public:
+	/** @param points one point per row, one dimension per column
+	 *  @param theta opening angle, 0 for an exact sum */
+	BarnesHut(const PCA::Matrix &points, float theta = 0.5);
+
+	/** sums over all other points j of w_ij = 1 / (1 + |y_i - y_j|^2).
+	 *  @param force returns sum of w_ij^2 (y_i - y_j), one per dimension
+	 *  @returns sum of w_ij */
+	double repulsion(int i, double *force) const;
+private:
+	struct Cell
+	{
+		double centre[3];
+		double mass[3];
+		double half;
+		int count = 0;
+		int point = -1;
+		int children = -1;
+	};
+
+	void insert(int cell, int point, int depth);
+	void subdivide(int cell);
+	int childFor(const Cell &cell, const double *pos) const;
+	void addToMass(Cell &cell, const double *pos);
+
+	const double *position(int i) const
+	{
+		return &_positions[i * _dims];
+	}
+
+	std::vector<Cell> _cells;
+	std::vector<double> _positions;
+	int _dims = 0;
+	int _split = 0;
+	float _theta = 0.5;
+};
+
+#endif
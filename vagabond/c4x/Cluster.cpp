@@ -54,12 +54,12 @@ template <class DG>
 int Cluster<DG>::bestAxisFit(std::vector<float> &vals)
 {
 	std::vector<AxisCC> _pairs;
-	for (size_t j = 0; j < _result.rows; j++)
+	for (size_t j = 0; j < _result.cols; j++)
 	{
 		float x = 0; float y = 0; float xx = 0; 
 		float yy = 0; float xy = 0; float s = 0;
 
-		for (size_t i = 0; i < _result.cols; i++)
+		for (size_t i = 0; i < _result.rows && i < vals.size(); i++)
 		{
 			float x_ = _result[i][j];
 			float y_ = vals[i];
@@ -99,7 +99,7 @@ int Cluster<DG>::bestAxisFit(std::vector<float> &vals)
 	
 	std::sort(_pairs.begin(), _pairs.end(), std::greater<AxisCC>());
 	
-	for (size_t i = 0; i < 3; i++)
+	for (size_t i = 0; i < 3 && i < _pairs.size(); i++)
 	{
 		_axes[i] = _pairs[i].axis;
 	}
@@ -129,10 +129,13 @@ glm::vec3 Cluster<DG>::point(int idx) const
 {
 	glm::vec3 v = glm::vec3(0.f);
 
-	for (size_t i = 0; i < 3 && i < _result.cols; i++)
+	for (size_t i = 0; i < 3; i++)
 	{
 		int axis = _axes[i];
-		v[i] = _result[idx][axis];
+		if (axis < _result.cols)
+		{
+			v[i] = _result[idx][axis];
+		}
 	}
 	
 	return v;
@@ -237,6 +240,11 @@ float Cluster<DG>::weight(int axis) const
 template <class DG>
 void Cluster<DG>::changeLastAxis(int axis)
 {
+	if (axis < 0 || axis >= _result.cols)
+	{
+		return;
+	}
+
 	for (size_t i = 0; i < 3; i++)
 	{
 		if (axis == _axes[i])
@@ -251,5 +259,19 @@ void Cluster<DG>::changeLastAxis(int axis)
 	_clusterVersion++;
 }
 
+template <class DG>
+void Cluster<DG>::clampAxes()
+{
+	for (size_t i = 0; i < 3; i++)
+	{
+		if (_axes[i] >= _result.cols)
+		{
+			/* fewer than three axes leave the missing ones at zero */
+			_axes[0] = 0; _axes[1] = 1; _axes[2] = 2;
+			return;
+		}
+	}
+}
+
 #endif
 
@@ -126,6 +126,10 @@ public:
 protected:
 	void normaliseResults(float scale = 1);
 
+	/** returns to the first three axes if any chosen axis is not in the
+	 *  results, e.g. when fewer axes were calculated */
+	void clampAxes();
+
 	DG _dg;
 
 	float _scaleFactor = 1;
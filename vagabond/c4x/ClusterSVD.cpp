@@ -71,33 +71,101 @@ std::vector<float> ClusterSVD<DG>::mapComparable(typename DG::Comparable &vec)
 }
 
 template <class DG>
-void ClusterSVD<DG>::cluster()
+PCA::Matrix ClusterSVD<DG>::normalisedComparables()
 {
-	if (this->dataGroup()->vectorCount() == 0)
+	this->_dg.prepareComparables();
+
+	int n = this->_dg.vectorCount();
+	int l = this->_dg.comparable_length();
+
+	PCA::Matrix comps;
+	setupMatrix(&comps, n, l);
+
+	for (size_t i = 0; i < n; i++)
 	{
-		return;
-	}
+		const typename DG::Comparable &c = this->_dg.comparableVector(i);
+		double sq = 0;
+
+		for (size_t j = 0; j < l && j < c.size(); j++)
+		{
+			if (c[j] == c[j] && isfinite(c[j]))
+			{
+				comps[i][j] = c[j];
+				sq += c[j] * c[j];
+			}
+		}
 
-	PCA::Matrix mat = matrix();
+		double scale = (sq > 0 ? 1 / sqrt(sq) : 0);
+		for (size_t j = 0; j < l; j++)
+		{
+			comps[i][j] *= scale;
+		}
+	}
 
-	setupSVD(&_svd, mat.rows, mat.cols);
-	setupMatrix(&this->_result, mat.rows, mat.cols);
+	return comps;
+}
 
-	copyMatrix(_svd.u, mat);
-	
+template <class DG>
+bool ClusterSVD<DG>::decompose()
+{
 	try
 	{
-		runSVD(&_svd);
+		if (_components <= 0)
+		{
+			PCA::Matrix mat = matrix();
+			setupSVD(&_svd, mat.rows, mat.cols);
+			copyMatrix(_svd.u, mat);
+			freeMatrix(&mat);
+
+			runSVD(&_svd);
+			reorderSVD(&_svd);
+		}
+		else if (_type == PCA::Correlation)
+		{
+			/* with unit-length rows X, the correlation matrix is X X', so
+			 * if X = U S V' then its axes are U with weights S^2 */
+			PCA::Matrix comps = normalisedComparables();
+			runTruncatedSVD(comps, &_svd, _components);
+			freeMatrix(&comps);
+
+			for (size_t i = 0; i < _svd.u.cols; i++)
+			{
+				_svd.w[i] *= _svd.w[i];
+			}
+		}
+		else
+		{
+			PCA::Matrix mat = matrix();
+			runTruncatedSVD(mat, &_svd, _components);
+			freeMatrix(&mat);
+		}
 	}
 	catch (std::runtime_error &err)
 	{
 		std::cout << "Error running svd: " << err.what() << std::endl;
-		freeMatrix(&mat);
+		return false;
+	}
+
+	return true;
+}
+
+template <class DG>
+void ClusterSVD<DG>::cluster()
+{
+	if (this->dataGroup()->vectorCount() == 0)
+	{
 		return;
 	}
 
-	reorderSVD(&_svd);
+	freeSVD(&_svd);
+	freeMatrix(&this->_result);
+
+	if (!decompose())
+	{
+		return;
+	}
 
+	setupMatrix(&this->_result, _svd.u.rows, _svd.u.cols);
 	copyMatrix(this->_result, _svd.u);
 	this->_scaleFactor = 1 / _svd.w[0];
 
@@ -110,7 +178,7 @@ void ClusterSVD<DG>::cluster()
 		this->_total += _svd.w[i];
 	}
 
-	freeMatrix(&mat);
+	this->clampAxes();
 	this->_clusterVersion++;
 }
 
@@ -120,9 +188,9 @@ void ClusterSVD<DG>::calculateInverse()
 	_mutex.lock();
 	int l = this->_dg.comparable_length();
 	PCA::SVD tmp;
-	setupSVD(&tmp, l, _svd.u.rows);
+	setupSVD(&tmp, l, _svd.u.cols);
 	
-	for (size_t i = 0; i < _svd.u.rows; i++)
+	for (size_t i = 0; i < _svd.u.cols; i++)
 	{
 		typename DG::Comparable raw = this->rawComparable(i);
 
@@ -34,6 +34,15 @@ public:
 	{
 		_type = type;
 	}
+	
+	/** only calculate the largest few axes, by randomised SVD. For the
+	 *  correlation type this works on the difference vectors directly, so
+	 *  the member x member matrix is never made.
+	 *  @param components number of axes to keep, or 0 for all axes */
+	void setComponents(int components)
+	{
+		_components = components;
+	}
 
 	virtual void cluster();
 	
@@ -55,13 +64,22 @@ public:
 	virtual void reweight(glm::vec3 &point) const
 	{
 		float ave = 0;
+		int count = 0;
 		for (size_t i = 0; i < 3 && i < this->rows(); i++)
 		{
 			float w = weight(this->axis(i));
 			point[i] *= w;
 			ave += w;
+			count += (w > 0 ? 1 : 0);
 		}
-		ave /= 3;
+
+		/* axes which were not calculated do not count */
+		if (count == 0 || ave <= 0)
+		{
+			return;
+		}
+
+		ave /= count;
 
 		for (size_t i = 0; i < 3; i++)
 		{
@@ -88,11 +106,21 @@ public:
 
 	virtual float weight(int axis) const
 	{
+		if (axis >= _svd.u.cols)
+		{
+			return 0;
+		}
+
 		return _svd.w[axis];
 	}
 
 	virtual float weight(int i, int j) const
 	{
+		if (j >= _svd.u.cols)
+		{
+			return 0;
+		}
+
 		return _svd.u[i][j];
 	}
 
@@ -107,10 +135,13 @@ public:
 	void calculateInverse();
 private:
 	PCA::Matrix matrix();
+	bool decompose();
+	PCA::Matrix normalisedComparables();
 
 	PCA::SVD _svd{};
 	PCA::Matrix _rawToCluster{};
 	PCA::MatrixType _type = PCA::Correlation;
+	int _components = 0;
 	std::mutex _mutex;
 };
 
@@ -18,6 +18,11 @@
 
 #include "ClusterTSNE.h"
 #include "ClusterSVD.h"
+#include "BarnesHut.h"
+#include <vagabond/utils/row_ranges.h>
+#include <algorithm>
+
+#define MAX_ITERATIONS 3000
 
 ClusterTSNE::ClusterTSNE(const PCA::Matrix &distances, const PCA::Matrix *start,
                          int dims)
@@ -52,145 +57,108 @@ ClusterTSNE::~ClusterTSNE()
 	freeMatrix(&_result);
 	freeMatrix(&_lastResult);
 	freeMatrix(&_distances);
-	freeMatrix(&_ps);
 	freeMatrix(&_tmp);
 }
 
-void normalise_row(PCA::Matrix &m, int row)
+void ClusterTSNE::findNeighbours(int count)
 {
-	double add = 0;
-	for (size_t j = 0; j < m.cols; j++)
+	PCA::Matrix &dm = _distances;
+	_rowStarts.resize(dm.rows + 1);
+	_neighbours.clear();
+
+	for (size_t i = 0; i <= dm.rows; i++)
 	{
-		if (m[row][j] == m[row][j])
-		{
-			add += m[row][j];
-		}
+		_rowStarts[i] = i * count;
 	}
 
-	for (size_t j = 0; j < m.cols; j++)
+	_neighbours.resize(dm.rows * count);
+	_probs.resize(dm.rows * count);
+
+	for_row_ranges(dm.rows, [this, &dm, count](size_t start, size_t end)
 	{
-		m[row][j] /= add;
+		std::vector<int> order(dm.cols);
 
-		if (m[row][j] != m[row][j] || !isfinite(m[row][j]))
+		for (size_t i = start; i < end; i++)
 		{
-			m[row][j] = 0;
-		}
-	}
-}
+			/* missing distances sort last and are never chosen */
+			auto closer = [&dm, i](const int &a, const int &b)
+			{
+				double da = dm[i][a], db = dm[i][b];
+				bool fa = (da == da && isfinite(da));
+				bool fb = (db == db && isfinite(db));
+				if (fa != fb)
+				{
+					return fa;
+				}
 
-void normalise_matrix(PCA::Matrix &m)
-{
-	double add = 0;
-	for (size_t j = 0; j < m.cols * m.rows; j++)
-	{
-		if (m.vals[j] == m.vals[j])
-		{
-			add += m.vals[j];
-		}
-	}
+				return (fa && da < db);
+			};
 
-	for (size_t j = 0; j < m.cols * m.rows; j++)
-	{
-		m.vals[j] /= add;
+			order.clear();
+			for (size_t j = 0; j < dm.cols; j++)
+			{
+				if (j != i)
+				{
+					order.push_back(j);
+				}
+			}
 
-		if (m.vals[j] != m.vals[j] || !isfinite(m.vals[j]))
-		{
-			m.vals[j] = 0;
+			std::partial_sort(order.begin(), order.begin() + count, 
+			                  order.end(), closer);
+
+			for (size_t k = 0; k < count; k++)
+			{
+				_neighbours[_rowStarts[i] + k] = order[k];
+			}
 		}
-	}
+	});
 }
 
-PCA::Matrix ClusterTSNE::probabilityMatrix(int i, float s)
+void ClusterTSNE::rowProbabilities(int i, float s, float *probs)
 {
 	PCA::Matrix &dm = _distances;
-	PCA::Matrix prob;
-	setupMatrix(&prob, 1, dm.cols);
-
-	if (s != s)
-	{
-		return prob;
-	}
+	size_t count = _rowStarts[i + 1] - _rowStarts[i];
+	const int *nb = &_neighbours[_rowStarts[i]];
+	double sum = 0;
 
-	for (size_t j = 0; j < dm.cols; j++)
+	for (size_t k = 0; k < count; k++)
 	{
-		prob[0][j] = 0;
-
-		if (i == j)
-		{
-			continue;
-		}
+		probs[k] = 0;
+		double d = dm[i][nb[k]];
 
-		double d = dm[i][j];
-		if (d != d || !isfinite(d))
+		if (s != s || d != d || !isfinite(d))
 		{
 			continue;
 		}
 
-		double p = exp(-d * d / (2 * s * s));
-		prob[0][j] = p;
+		probs[k] = exp(-d * d / (2 * s * s));
+		sum += probs[k];
 	}
 
-	normalise_matrix(prob);
-
-	return prob;
-}
-
-PCA::Matrix ClusterTSNE::probabilityMatrix(PCA::Matrix &sigmas)
-{
-	PCA::Matrix &dm = _distances;
-
-	PCA::Matrix prob;
-	setupMatrix(&prob, dm.rows, dm.cols);
-	
-	for (size_t i = 0; i < dm.rows; i++)
+	for (size_t k = 0; k < count; k++)
 	{
-		for (size_t j = 0; j < dm.cols; j++)
-		{
-			prob[i][j] = 0;
-
-			if (i == j)
-			{
-				continue;
-			}
-
-			double d = dm[i][j];
-			if (d != d || !isfinite(d))
-			{
-				continue;
-			}
+		probs[k] /= sum;
 
-			double p = exp(-d * d / (2 * sigmas[0][i] * sigmas[0][i]));
-
-			prob[i][j] = p;
+		if (probs[k] != probs[k] || !isfinite(probs[k]))
+		{
+			probs[k] = 0;
 		}
-
-		normalise_row(prob, i);
 	}
-	
-	return prob;
 }
 
-float ClusterTSNE::perplexity(PCA::Matrix &m)
+float ClusterTSNE::perplexity(const float *probs, int count)
 {
 	float entropy = 0;
 
-	for (size_t i = 0; i < m.rows; i++)
+	for (size_t j = 0; j < count; j++)
 	{
-		for (size_t j = 0; j < m.cols; j++)
+		if (probs[j] <= 1e-6 || probs[j] != probs[j])
 		{
-			if (i == j)
-			{
-				continue;
-			}
-			
-			if (m[i][j] <= 1e-6 || m[i][j] != m[i][j])
-			{
-				continue;
-			}
-			
-			float part = m[i][j] * log(m[i][j]) / log(2);
-			entropy += part;
+			continue;
 		}
+
+		float part = probs[j] * log(probs[j]) / log(2);
+		entropy += part;
 	}
 	
 	double perp = pow(2, -entropy);
@@ -219,9 +187,8 @@ float ClusterTSNE::startingSigma()
 }
 
 
-float ClusterTSNE::findSigma(int row, float target)
+float ClusterTSNE::findSigma(int row, float target, float s)
 {
-	float s = startingSigma();
 	if (s != s)
 	{
 		return 1;
@@ -231,12 +198,14 @@ float ClusterTSNE::findSigma(int row, float target)
 	float last_dir = 0;
 	float guess = s;
 	int count = 0;
+
+	size_t n = _rowStarts[row + 1] - _rowStarts[row];
+	std::vector<float> prob(n);
 	
 	while (step > s / 1000 && count < 100)
 	{
-		PCA::Matrix prob = probabilityMatrix(row, guess);
-		float measured = perplexity(prob);
-		freeMatrix(&prob);
+		rowProbabilities(row, guess, &prob[0]);
+		float measured = perplexity(&prob[0], n);
 		
 		float dir = (measured - target > 0 ? -1 : 1);
 		
@@ -259,18 +228,19 @@ float ClusterTSNE::findSigma(int row, float target)
 	return guess;
 }
 
-PCA::Matrix ClusterTSNE::findSigmas(float target)
+void ClusterTSNE::findSigmas(float target)
 {
-	PCA::Matrix sigmas;
-	setupMatrix(&sigmas, 1, _distances.cols);
+	/* starting guess is shared by all rows */
+	float start = startingSigma();
 
-	for (size_t i = 0; i < _distances.rows; i++)
+	for_row_ranges(_distances.rows, [this, target, start](size_t b, size_t e)
 	{
-		float s = findSigma(i, target);
-		sigmas[0][i] = s;
-	}
-
-	return sigmas;
+		for (size_t i = b; i < e; i++)
+		{
+			float s = findSigma(i, target, start);
+			rowProbabilities(i, s, &_probs[_rowStarts[i]]);
+		}
+	});
 }
 
 float ClusterTSNE::qDistanceValue(int i, int j)
@@ -286,38 +256,6 @@ float ClusterTSNE::qDistanceValue(int i, int j)
 	return nom;
 }
 
-PCA::Matrix ClusterTSNE::qMatrix()
-{
-	PCA::Matrix prob;
-	setupMatrix(&prob, _distances.rows, _distances.cols);
-	
-	if (this->_result.cols != displayableDimensions())
-	{
-		throw std::runtime_error("Result columns not equal to dimensions");
-	}
-	
-	for (size_t i = 0; i < _distances.rows; i++)
-	{
-		for (size_t j = 0; j < _distances.cols; j++)
-		{
-			if (i == j)
-			{
-				continue;
-			}
-
-			float nom = qDistanceValue(i, j);
-			if (nom == nom)
-			{
-				prob[i][j] = nom;
-			}
-		}
-		
-		normalise_row(prob, i);
-	}
-
-	return prob;
-}
-
 void ClusterTSNE::prepareResults(float s)
 {
 	setupMatrix(&this->_result, _distances.rows, displayableDimensions());
@@ -325,64 +263,79 @@ void ClusterTSNE::prepareResults(float s)
 	setupMatrix(&_tmp, _distances.rows, displayableDimensions());
 }
 
-// eq 5 from paper vandermaaten08a
-PCA::Matrix ClusterTSNE::gradients(PCA::Matrix &ps)
+/* eq 5 from paper vandermaaten08a, with q normalised per row as
+ * q(j|i) = w_ij / Z_i. The attractive part only runs over the neighbours
+ * holding p(j|i), and the repulsive part (which needs w_ij for every j) is
+ * approximated from a Barnes-Hut tree, as in vandermaaten14a. */
+PCA::Matrix ClusterTSNE::gradients(float *divergence)
 {
+	if (this->_result.cols != displayableDimensions())
+	{
+		throw std::runtime_error("Result columns not equal to dimensions");
+	}
+
+	const int dims = displayableDimensions();
 	PCA::Matrix grads;
-	setupMatrix(&grads, _distances.rows, displayableDimensions());
+	setupMatrix(&grads, _distances.rows, dims);
 
-	PCA::Matrix qs = qMatrix();
+	BarnesHut tree(this->_result);
+	std::vector<double> kls(grads.rows, 0);
 
-	for (size_t i = 0; i < grads.rows; i++)
+	for_row_ranges(grads.rows, [&](size_t start, size_t end)
 	{
-		for (size_t k = 0; k < displayableDimensions(); k++)
-		{
-			grads[i][k] = 0;
-		}
+		std::vector<double> rep(dims), attr(dims);
 
-		for (size_t j = 0; j < grads.rows; j++)
+		for (size_t i = start; i < end; i++)
 		{
-			float prob_diff = ps[i][j] - qs[i][j];
-			float nom = qDistanceValue(i, j);
+			double z = tree.repulsion(i, &rep[0]);
 
-			for (size_t k = 0; k < displayableDimensions(); k++)
+			for (size_t k = 0; k < dims; k++)
 			{
-				float point_diff = this->_result[i][k] - this->_result[j][k];
-				
-				double grad = -4 * point_diff * nom * prob_diff;
-				
-				grads[i][k] += grad;
+				attr[k] = 0;
 			}
-		}
-	}
 
-	freeMatrix(&qs);
-	
-	return grads;
-}
+			for (size_t n = _rowStarts[i]; n < _rowStarts[i + 1]; n++)
+			{
+				int j = _neighbours[n];
+				float p = _probs[n];
+				if (p <= 0)
+				{
+					continue;
+				}
 
-float ClusterTSNE::averagePQDiff()
-{
-	PCA::Matrix qs = qMatrix();
+				float nom = qDistanceValue(i, j);
 
-	float sum = 0;
-	for (size_t i = 0; i < qs.rows; i++)
-	{
-		for (size_t j = 0; j < qs.cols; j++)
-		{
-			float add = fabs(qs[i][j] - _ps[i][j]);
-			sum += add;
+				for (size_t k = 0; k < dims; k++)
+				{
+					float point_diff = this->_result[i][k] - this->_result[j][k];
+					attr[k] += p * nom * point_diff;
+				}
+
+				kls[i] += p * log(p * z / nom);
+			}
+
+			for (size_t k = 0; k < dims; k++)
+			{
+				grads[i][k] = -4 * (attr[k] - rep[k] / z);
+			}
 		}
+	});
+
+	*divergence = 0;
+	for (const double &kl : kls)
+	{
+		*divergence += kl;
 	}
 	
-	return sum;
+	return grads;
 }
 
 float ClusterTSNE::incrementResult(float &scale, float &learning)
 {
 	copyMatrix(_tmp, this->_result);
 
-	PCA::Matrix grads = gradients(_ps);
+	float divergence = 0;
+	PCA::Matrix grads = gradients(&divergence);
 
 	for (size_t i = 0; i < this->_result.rows; i++)
 	{
@@ -399,8 +352,7 @@ float ClusterTSNE::incrementResult(float &scale, float &learning)
 	copyMatrix(_lastResult, _tmp);
 	freeMatrix(&grads);
 	
-	float val = averagePQDiff();
-	return val;
+	return divergence;
 }
 
 void ClusterTSNE::normaliseResults(float scale)
@@ -433,9 +385,10 @@ void ClusterTSNE::cluster()
 		perp = _distances.rows / 2;
 	}
 	
-	PCA::Matrix sigmas = findSigmas(perp);
-	_ps = probabilityMatrix(sigmas);
-	freeMatrix(&sigmas);
+	/* only the nearest neighbours carry appreciable probability */
+	int neighbours = std::min((int)_distances.rows - 1, (int)(3 * perp));
+	findNeighbours(neighbours);
+	findSigmas(perp);
 	
 	float scale = 0.5;
 	float learning = 50;
@@ -476,13 +429,17 @@ void ClusterTSNE::cluster()
 				break;
 			}
 		}
+		
+		/* an exact gradient can keep improving the target very slowly */
+		if (count >= MAX_ITERATIONS)
+		{
+			break;
+		}
 	}
 	
 	std::cout << "Target: from " << first << " to " << last << std::endl;
 	
 	this->normaliseResults(4);
-
-	freeMatrix(&_ps);
 }
 
 std::vector<float> ClusterTSNE::point(int j)
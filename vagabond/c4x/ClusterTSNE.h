@@ -73,29 +73,32 @@ public:
 	PCA::Matrix result();
 	void normaliseResults(float scale = 1);
 private:
-	PCA::Matrix probabilityMatrix(int i, float sigma);
-	PCA::Matrix probabilityMatrix(PCA::Matrix &sigmas);
-	float findSigma(int row, float perp);
+	void findNeighbours(int count);
+	void rowProbabilities(int row, float sigma, float *probs);
+	float findSigma(int row, float perp, float start);
 	float incrementResult(float &scale, float &learning);
 	
-	/* returns row=1 col=n vector of sigmas */
-	PCA::Matrix findSigmas(float target);
+	/* fills in _probs for each row's neighbours */
+	void findSigmas(float target);
 	float startingSigma();
-	float perplexity(PCA::Matrix &m);
+	float perplexity(const float *probs, int count);
 
-	PCA::Matrix gradients(PCA::Matrix &prob);
+	PCA::Matrix gradients(float *divergence);
 	float qDistanceValue(int i, int j);
-	PCA::Matrix qMatrix();
 
 	void prepareResults(float s);
-	float averagePQDiff();
 
 	PCA::Matrix _distances{};
-	PCA::Matrix _ps{};
 	PCA::Matrix _lastResult{};
 	PCA::Matrix _result{};
 	PCA::Matrix _tmp{};
 	
+	/* sparse conditional probabilities p(j|i), only for the nearest
+	 * neighbours j of each row i, which start at _rowStarts[i] */
+	std::vector<size_t> _rowStarts;
+	std::vector<int> _neighbours;
+	std::vector<float> _probs;
+	
 	int _dims = 3;
 };
 
@@ -23,6 +23,9 @@
 #include <vagabond/utils/os.h>
 #include "DataGroup.h"
 #include <vagabond/utils/svd/PCA.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 #include <cmath>
 #include <fstream>
 #include <iostream>
@@ -30,6 +33,69 @@
 
 using std::isfinite;
 
+/* pairwise matrices are filled in square tiles of rows, so that both sets
+ * of rows stay in cache while all their pairs are compared. Sums are split
+ * over lanes which can be handled as one vector, and rows are padded to a
+ * whole number of lanes */
+#define TILE_SIZE (32)
+#define LANES (8)
+
+/* squared distance over entries present in both rows. Missing entries have
+ * been zeroed, with mask entries of 0 */
+inline float pair_distance(const float *v, const float *w,
+                           const float *mv, const float *mw, size_t n)
+{
+	float sums[LANES] = {};
+
+	for (size_t i = 0; i < n; i += LANES)
+	{
+		for (size_t l = 0; l < LANES; l++)
+		{
+			const float diff = v[i + l] - w[i + l];
+			sums[l] += diff * diff * mv[i + l] * mw[i + l];
+		}
+	}
+
+	float sq = 0;
+	for (size_t l = 0; l < LANES; l++)
+	{
+		sq += sums[l];
+	}
+
+	return sqrt(sq);
+}
+
+/* as correlation_between(), over entries present in both rows */
+inline float pair_correlation(const float *v, const float *w,
+                              const float *mv, const float *mw, size_t n)
+{
+	float xy[LANES] = {};
+	float xx[LANES] = {};
+	float yy[LANES] = {};
+
+	for (size_t i = 0; i < n; i += LANES)
+	{
+		for (size_t l = 0; l < LANES; l++)
+		{
+			const float vn = v[i + l];
+			const float wn = w[i + l];
+			xy[l] += vn * wn;
+			xx[l] += vn * vn * mw[i + l];
+			yy[l] += wn * wn * mv[i + l];
+		}
+	}
+
+	double sum_xy = 0, sum_xx = 0, sum_yy = 0;
+	for (size_t l = 0; l < LANES; l++)
+	{
+		sum_xy += xy[l];
+		sum_xx += xx[l];
+		sum_yy += yy[l];
+	}
+
+	return sum_xy / sqrt(sum_xx * sum_yy);
+}
+
 template <class Unit, class Header>
 DataGroup<Unit, Header>::DataGroup(int length)
 {
@@ -474,8 +540,9 @@ float DataGroup<Unit, Header>::correlation_between(int i, int j)
 
 
 template <class Unit, class Header>
-PCA::Matrix DataGroup<Unit, Header>::arbitraryMatrix
-(float(DataGroup<Unit, Header>::*comparison)(int, int))
+PCA::Matrix DataGroup<Unit, Header>::arbitraryMatrix(PairFunction comparison,
+                                                     size_t entries, 
+                                                     float self)
 {
 	PCA::Matrix m;
 	
@@ -483,27 +550,104 @@ PCA::Matrix DataGroup<Unit, Header>::arbitraryMatrix
 	
 	PCA::setupMatrix(&m, n, n);
 	
-	for (size_t j = 0; j < n; j++)
+	/* contiguous copy of the comparables, with missing entries zeroed and
+	 * recorded in a matching mask */
+	size_t stride = ((entries + LANES - 1) / LANES) * LANES;
+	std::vector<float> vals(n * stride, 0);
+	std::vector<float> masks(n * stride, 0);
+
+	for (size_t i = 0; i < n; i++)
 	{
-		for (size_t i = 0; i < n; i++)
+		const Comparable &c = _comparables[i];
+		for (size_t k = 0; k < entries && k < c.size(); k++)
 		{
-			double &val = m[j][i];
-			
-			float corr = (this->*comparison)(i, j);
+			if (c[k] == c[k] && isfinite(c[k]))
+			{
+				vals[i * stride + k] = c[k];
+				masks[i * stride + k] = 1;
+			}
+		}
+	}
+
+	/* result is symmetric, so only tiles on or above the diagonal are
+	 * calculated, and each is mirrored into the lower triangle */
+	size_t tiles = (n + TILE_SIZE - 1) / TILE_SIZE;
+	std::vector<std::pair<size_t, size_t> > jobs;
+	for (size_t a = 0; a < tiles; a++)
+	{
+		for (size_t b = a; b < tiles; b++)
+		{
+			jobs.push_back(std::make_pair(a, b));
+		}
+	}
+
+	std::atomic<size_t> next{0};
+
+	auto work = [&]()
+	{
+		while (true)
+		{
+			size_t job = next++;
+			if (job >= jobs.size())
+			{
+				return;
+			}
+
+			size_t a = jobs[job].first * TILE_SIZE;
+			size_t b = jobs[job].second * TILE_SIZE;
+			size_t a_end = std::min(a + TILE_SIZE, (size_t)n);
+			size_t b_end = std::min(b + TILE_SIZE, (size_t)n);
+
+			/* only diagonal tiles own the diagonal, so that no two threads
+			 * write the same element */
+			bool diagonal = (a == b);
+
+			for (size_t i = a; i < a_end; i++)
+			{
+				if (diagonal)
+				{
+					m[i][i] = self;
+				}
+
+				for (size_t j = std::max(b, i + 1); j < b_end; j++)
+				{
+					float corr = comparison(&vals[i * stride], 
+					                        &vals[j * stride],
+					                        &masks[i * stride], 
+					                        &masks[j * stride], stride);
 
 #ifdef OS_UNIX
-            if (corr != corr || !isfinite(corr))
+					if (corr != corr || !isfinite(corr))
 #else
 #ifdef OS_WINDOWS
-            if (corr != corr || !std::isfinite(corr))
+					if (corr != corr || !std::isfinite(corr))
 #endif
 #endif
-			{
-				corr = 0;
-			}
+					{
+						corr = 0;
+					}
 
-			val = corr;
+					m[i][j] = corr;
+					m[j][i] = corr;
+				}
+			}
 		}
+	};
+
+	size_t threads = std::max(1u, std::thread::hardware_concurrency());
+	threads = std::min(threads, jobs.size());
+
+	std::vector<std::thread> workers;
+	for (size_t t = 1; t < threads; t++)
+	{
+		workers.push_back(std::thread(work));
+	}
+
+	work();
+
+	for (std::thread &w : workers)
+	{
+		w.join();
 	}
 	
 	return m;
@@ -512,20 +656,26 @@ PCA::Matrix DataGroup<Unit, Header>::arbitraryMatrix
 template <class Unit, class Header>
 PCA::Matrix DataGroup<Unit, Header>::distanceMatrix()
 {
-	return arbitraryMatrix(&DataGroup::distance_between);
+	return arbitraryMatrix(&pair_distance, _length, 0);
 }
 
 
 template <class Unit, class Header>
-PCA::Matrix DataGroup<Unit, Header>::correlationMatrix()
+void DataGroup<Unit, Header>::prepareComparables()
 {
 	if (_diffs.size() != _vectors.size() || _averages.size() == 0)
 	{
 		findDifferences();
 		normalise();
 	}
+}
+
+template <class Unit, class Header>
+PCA::Matrix DataGroup<Unit, Header>::correlationMatrix()
+{
+	prepareComparables();
 	
-	return arbitraryMatrix(&DataGroup::correlation_between);
+	return arbitraryMatrix(&pair_correlation, comparable_length(), 1);
 }
 
 template <class Unit, class Header>
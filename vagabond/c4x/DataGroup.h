@@ -80,6 +80,9 @@ public:
 	/** Normalise differences for each unit (i.e. vector component) */
 	virtual void normalise();
 	
+	/** Find and normalise differences, unless already up to date */
+	void prepareComparables();
+	
 	/** Return correlation matrix of size m*m where m = member size */
 	virtual PCA::Matrix correlationMatrix();
 	
@@ -167,7 +170,16 @@ protected:
 	std::vector<int> _groupMembership;
 	std::map<const Array *, int> _arrayToGroup;
 
-	PCA::Matrix arbitraryMatrix(float(DataGroup<Unit, Header>::*comparison)(int, int));
+	/** compares two padded rows of comparable values, given masks of 1 for
+	 *  entries which are present and 0 for those which are missing */
+	typedef float (*PairFunction)(const float *v, const float *w,
+	                              const float *mv, const float *mw, size_t n);
+
+	/** fills symmetric matrix over all pairs of vectors, in parallel.
+	 *  @param entries number of comparable values per vector to use
+	 *  @param self value for the diagonal */
+	PCA::Matrix arbitraryMatrix(PairFunction comparison, size_t entries,
+	                            float self);
 
 	int _length;
 	bool _subtractAverage = true;
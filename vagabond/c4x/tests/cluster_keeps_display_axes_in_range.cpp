@@ -0,0 +1,58 @@
+#include <vagabond/core/ObjectGroup.h>
+#include "../ClusterSVD.h"
+#include "../Angular.h"
+#include <iostream>
+
+struct Name
+{
+	std::string desc() const
+	{
+		return "name";
+	}
+};
+
+int main()
+{
+	size_t length = 6;
+	DataGroup<Angular, Name> dg(length);
+	
+	for (size_t i = 0; i < 10; i++)
+	{
+		std::vector<Angular> v(length);
+		for (size_t j = 0; j < length; j++)
+		{
+			v[j] = 40 * sin(i * 1.7 + j * 0.9) + (i % 2) * 10 * j;
+		}
+
+		dg.addArray("array_" + std::to_string(i), v);
+	}
+
+	dg.normalise();
+	
+	/* only two axes, so the third display axis must stay empty */
+	ClusterSVD<DataGroup<Angular, Name> > cx(dg);
+	cx.setComponents(2);
+	cx.cluster();
+	cx.changeLastAxis(5);
+
+	if (cx.columns() != 2 || cx.axis(2) != 2)
+	{
+		std::cout << "Unexpected axes: " << cx.columns() << " columns, "
+		<< "last axis " << cx.axis(2) << std::endl;
+		return 1;
+	}
+
+	for (size_t i = 0; i < cx.pointCount(); i++)
+	{
+		glm::vec3 p = cx.pointForDisplay(i);
+
+		if (p[2] != 0 || p[0] != p[0] || p[1] != p[1])
+		{
+			std::cout << "Bad display point " << i << ": " << p[0] << " " 
+			<< p[1] << " " << p[2] << std::endl;
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,90 @@
+#include "../DataGroup.h"
+#include "../Angular.h"
+#include <iostream>
+
+struct Name
+{
+	std::string desc() const
+	{
+		return "name";
+	}
+};
+
+/* gives access to the one-pair comparisons which the tiled matrices
+ * replaced */
+class PairwiseGroup : public DataGroup<Angular, Name>
+{
+public:
+	PairwiseGroup(int length) : DataGroup<Angular, Name>(length) {}
+
+	using DataGroup<Angular, Name>::distance_between;
+	using DataGroup<Angular, Name>::correlation_between;
+};
+
+int compare(PCA::Matrix &m, PairwiseGroup &dg, bool correlation)
+{
+	for (size_t i = 0; i < dg.vectorCount(); i++)
+	{
+		for (size_t j = 0; j < dg.vectorCount(); j++)
+		{
+			double target = (correlation ? dg.correlation_between(i, j) :
+			                 dg.distance_between(i, j));
+			double have = m[i][j];
+
+			if (fabs(have - target) > 1e-4 * std::max(1., fabs(target)))
+			{
+				std::cout << (correlation ? "Correlation" : "Distance")
+				<< " " << i << ", " << j << ": have " << have 
+				<< " but target is " << target << std::endl;
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+int main()
+{
+	/* enough vectors for several tiles, and a length which is not a 
+	 * multiple of the vector lanes */
+	size_t length = 13;
+	size_t num = 75;
+	PairwiseGroup dg(length);
+	
+	for (size_t i = 0; i < num; i++)
+	{
+		std::vector<Angular> v(length);
+		for (size_t j = 0; j < length; j++)
+		{
+			v[j] = 40 * sin(i * 1.3 + j * 0.7) + (i % 3) * 5 * j;
+		}
+		
+		/* missing values must be skipped by both */
+		if (i % 7 == 0)
+		{
+			v[i % length] = NAN;
+		}
+
+		dg.addArray("array_" + std::to_string(i), v);
+	}
+
+	dg.normalise();
+
+	PCA::Matrix distances = dg.distanceMatrix();
+	if (compare(distances, dg, false))
+	{
+		return 1;
+	}
+
+	PCA::Matrix correlations = dg.correlationMatrix();
+	if (compare(correlations, dg, true))
+	{
+		return 1;
+	}
+
+	PCA::freeMatrix(&distances);
+	PCA::freeMatrix(&correlations);
+
+	return 0;
+}
@@ -0,0 +1,93 @@
+#include "../ClusterTSNE.h"
+#include <iostream>
+#include <cfloat>
+
+int main()
+{
+	/* two groups of points scattered in five dimensions, far apart */
+	const int n = 200;
+	const int dims = 5;
+	std::vector<float> coords(n * dims);
+
+	for (int i = 0; i < n; i++)
+	{
+		for (int k = 0; k < dims; k++)
+		{
+			coords[i * dims + k] = sin(i * 1.3 + k * 2.1) * 2 + (i < n / 2 ? 0 : 10);
+		}
+	}
+
+	PCA::Matrix distances;
+	PCA::setupMatrix(&distances, n, n);
+
+	for (int i = 0; i < n; i++)
+	{
+		for (int j = 0; j < n; j++)
+		{
+			float sq = 0;
+			for (int k = 0; k < dims; k++)
+			{
+				float diff = coords[i * dims + k] - coords[j * dims + k];
+				sq += diff * diff;
+			}
+
+			distances[i][j] = sqrt(sq);
+		}
+	}
+
+	ClusterTSNE tsne(distances, nullptr, 2);
+	tsne.cluster();
+
+	/* nearly every point should have a nearest neighbour from its own 
+	 * group, and points in different groups should be further apart on 
+	 * average than points within the same group */
+	int same = 0;
+	float within = 0, between = 0;
+
+	for (int i = 0; i < n; i++)
+	{
+		float closest = FLT_MAX;
+		int nearest = -1;
+
+		for (int j = 0; j < n; j++)
+		{
+			if (i == j)
+			{
+				continue;
+			}
+
+			float d = glm::length(tsne.pointForDisplay(i) - 
+			                      tsne.pointForDisplay(j));
+
+			if ((i < n / 2) == (j < n / 2))
+			{
+				within += d;
+			}
+			else
+			{
+				between += d;
+			}
+
+			if (d < closest)
+			{
+				closest = d;
+				nearest = j;
+			}
+		}
+
+		same += ((i < n / 2) == (nearest < n / 2));
+	}
+
+	within /= (float)(n * (n / 2 - 1));
+	between /= (float)(n * n / 2);
+
+	if (same < n * 0.95 || between <= within * 1.5)
+	{
+		std::cout << same << " of " << n << " points next to their own "
+		<< "group, average distance " << between << " between groups and " 
+		<< within << " within groups" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -89,27 +89,28 @@ Result *AlignmentTool::resultForAnchor(Atom *anchor, int jumps)
 
 glm::mat4x4 AlignmentTool::superposition(Result *result, bool derived)
 {
-	AtomPosMap &aps = result->aps;
+	const FlatPositions &flat = result->flat;
 
 	Superpose pose;
 	pose.forceSameHand(false);
 
-	AtomPosMap::iterator it;
-	for (it = aps.begin(); it != aps.end(); it++)
+	for (size_t i = 0; i < flat.atomCount(); i++)
 	{
+		Atom *atom = flat.index->atoms[i];
 		glm::vec3 init;
 		if (derived)
 		{
-			init = it->first->derivedPosition();
+			init = atom->derivedPosition();
 		}
 		else
 		{
-			init = it->first->initialPosition();
+			init = atom->initialPosition();
 		}
 
-		glm::vec3 pos = it->second.ave;
+		size_t found = 0;
+		glm::vec3 pos = flat.average(i, &found);
 		
-		if (init.x != init.x || pos.x != pos.x)
+		if (init.x != init.x || found == 0)
 		{
 			continue;
 		}
@@ -124,15 +125,21 @@ glm::mat4x4 AlignmentTool::superposition(Result *result, bool derived)
 
 void AlignmentTool::updatePositions(Result *result, glm::mat4 transform)
 {
-	AtomPosMap &aps = result->aps;
+	const FlatPositions &flat = result->flat;
 
-	AtomPosMap::iterator it;
-	for (it = aps.begin(); it != aps.end(); it++)
+	for (size_t i = 0; i < flat.atomCount(); i++)
 	{
-		glm::vec4 pos = glm::vec4(it->second.ave, 1.);
+		size_t found = 0;
+		glm::vec3 ave = flat.average(i, &found);
+		if (found == 0)
+		{
+			continue;
+		}
+
+		glm::vec4 pos = glm::vec4(ave, 1.);
 		pos = transform * pos;
 		glm::vec3 tmp = glm::vec3(pos);
-		it->first->setDerivedPosition(tmp);
+		flat.index->atoms[i]->setDerivedPosition(tmp);
 	}
 }
 
@@ -22,6 +22,8 @@
 #include <vagabond/utils/glm_import.h>
 #include <unordered_map>
 #include <vector>
+#include <memory>
+#include <cmath>
 
 class Atom;
 
@@ -42,4 +44,148 @@ struct AtomWithPos
 typedef std::unordered_map<Atom *, WithPos> AtomPosMap;
 typedef std::vector<AtomWithPos> AtomPosList;
 
+/** \class AtomIndex
+ *  order of atoms in a FlatPositions buffer. Made once by a BondSequence and
+ *  shared, unchanged, between all the results it produces. */
+
+struct AtomIndex
+{
+	AtomIndex(const std::vector<Atom *> &list) : atoms(list)
+	{
+		for (size_t i = 0; i < atoms.size(); i++)
+		{
+			lookup[atoms[i]] = i;
+		}
+	}
+
+	size_t size() const
+	{
+		return atoms.size();
+	}
+
+	/** position of atom in the table, or -1 if not present */
+	int indexOf(Atom *atom) const
+	{
+		std::unordered_map<Atom *, int>::const_iterator it = lookup.find(atom);
+		return (it == lookup.end() ? -1 : it->second);
+	}
+
+	const std::vector<Atom *> atoms;
+	std::unordered_map<Atom *, int> lookup;
+};
+
+/** \class FlatPositions
+ *  positions of every sample of every atom in one buffer, laid out as
+ *  samples x atoms x 3 in AtomIndex order. Entries for an atom missing from
+ *  a sample are NaN. Buffers keep their capacity when cleared, so a recycled
+ *  Result does not need to allocate again. */
+
+struct FlatPositions
+{
+	std::shared_ptr<const AtomIndex> index;
+	size_t samples = 0;
+	std::vector<float> positions;
+	std::vector<float> targets;
+	
+	size_t atomCount() const
+	{
+		return index ? index->size() : 0;
+	}
+	
+	bool empty() const
+	{
+		return positions.size() == 0;
+	}
+
+	void clear()
+	{
+		index.reset();
+		samples = 0;
+		positions.clear();
+		targets.clear();
+	}
+
+	glm::vec3 position(int sample, int atom) const
+	{
+		const float *p = &positions[(sample * atomCount() + atom) * 3];
+		return glm::vec3(p[0], p[1], p[2]);
+	}
+
+	glm::vec3 target(int sample, int atom) const
+	{
+		const float *p = &targets[(sample * atomCount() + atom) * 3];
+		return glm::vec3(p[0], p[1], p[2]);
+	}
+
+	/** fills wp with the samples, and the sums of positions and targets over
+	 *  the samples, of one atom. Missing samples are left out.
+	 *  @return number of samples found */
+	size_t withPos(int atom, WithPos &wp) const
+	{
+		wp.samples.clear();
+		wp.ave = glm::vec3(0.f);
+		wp.target = glm::vec3(0.f);
+
+		for (size_t s = 0; s < samples; s++)
+		{
+			glm::vec3 p = position(s, atom);
+			if (p.x != p.x)
+			{
+				continue;
+			}
+
+			wp.samples.push_back(p);
+			wp.ave += p;
+			wp.target += target(s, atom);
+		}
+
+		return wp.samples.size();
+	}
+
+	/** average position of one atom over the samples it appears in, or 
+	 *  the origin if it appears in none
+	 *  @param found if given, set to the number of samples averaged */
+	glm::vec3 average(int atom, size_t *found = nullptr) const
+	{
+		glm::vec3 sum = glm::vec3(0.f);
+		float count = 0;
+
+		for (size_t s = 0; s < samples; s++)
+		{
+			glm::vec3 p = position(s, atom);
+			if (p.x == p.x)
+			{
+				sum += p;
+				count++;
+			}
+		}
+		
+		if (found)
+		{
+			*found = count;
+		}
+
+		if (count == 0)
+		{
+			return sum;
+		}
+
+		return sum / count;
+	}
+
+	/** converts to the per-atom map, with positions and targets summed over
+	 *  samples as BondSequence::extractPositions() gives them */
+	void toAtomPosMap(AtomPosMap &aps) const
+	{
+		for (size_t i = 0; i < atomCount(); i++)
+		{
+			WithPos wp{};
+			if (withPos(i, wp) > 0)
+			{
+				aps[index->atoms[i]] = wp;
+			}
+		}
+	}
+};
+
 #endif
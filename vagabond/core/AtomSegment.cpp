@@ -40,12 +40,58 @@ void AtomSegment::addElementSegment(ElementSegment *seg)
 
 	for (size_t i = 0; i < nn(); i++)
 	{
-		float r = seg->density(i, 0);
-		float im = seg->density(i, 1);
-		long add_r = r * FIXED_MULTIPLY;
-		long add_im = im * FIXED_MULTIPLY;
-		_data[i].value[0].fetch_add(add_r);
-		_data[i].value[1].fetch_add(add_im);
+		const VoxelElement &ve = seg->element(i);
+		_data[i].value[0] += ve.value[0];
+		_data[i].value[1] += ve.value[1];
+	}
+}
+
+/* float has no fetch_add before C++20, so compare-and-swap instead */
+static void atomicAdd(float *dest, float add)
+{
+	float old;
+	__atomic_load(dest, &old, __ATOMIC_RELAXED);
+	float sum = old + add;
+
+	while (!__atomic_compare_exchange(dest, &old, &sum, true, 
+	                                  __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	{
+		sum = old + add;
+	}
+}
+
+void AtomSegment::addElementSegmentAtomically(ElementSegment *seg)
+{
+	if (seg->nn() != nn())
+	{
+		throw std::runtime_error("Trying to add element segment "
+		                         "of different nn()");
+	}
+
+	for (size_t i = 0; i < nn(); i++)
+	{
+		const VoxelElement &ve = seg->element(i);
+		atomicAdd(&_data[i].value[0], ve.value[0]);
+		atomicAdd(&_data[i].value[1], ve.value[1]);
+	}
+}
+
+void AtomSegment::addSegment(AtomSegment *other)
+{
+	if (other->nn() != nn())
+	{
+		throw std::runtime_error("Trying to add atom segment "
+		                         "of different nn()");
+	}
+
+	/* plain float loop, which the compiler can vectorise */
+	float *dest = &_data[0].value[0];
+	const float *src = &other->_data[0].value[0];
+	const size_t n = nn() * 2;
+
+	for (size_t i = 0; i < n; i++)
+	{
+		dest[i] += src[i];
 	}
 }
 
@@ -61,7 +107,5 @@ void AtomSegment::clear()
 
 float AtomSegment::density(int i, int j)
 {
-	Density &ele = element(i);
-	float val = ele.value[j] / (float)FIXED_MULTIPLY;
-	return val;
+	return element(i).value[j];
 }
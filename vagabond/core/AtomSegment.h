@@ -20,19 +20,18 @@
 #define __vagabond__AtomSegment__
 
 #include "FFTCubicGrid.h"
-#include <atomic>
-
-#define FIXED_MULTIPLY (1000000)
 
 class ElementSegment;
 
 /** \class AtomSegment
- *  class for atomically adding map values. Because float isn't intrinsically 
- *  supported in std:atomic, will have to go for fixed-point number. */
+ *  class for summing map values from element segments. Only 
+ *  addElementSegmentAtomically() is thread-safe: otherwise each thread sums
+ *  into its own AtomSegment, and these partial sums are then added to one
+ *  another (see MapSumHandler). */
 
 struct Density
 {
-	std::atomic<long> value[2];
+	float value[2];
 };
 
 class AtomSegment : public FFTCubicGrid<Density>
@@ -53,13 +52,20 @@ public:
 	}
 	
 	void addElementSegment(ElementSegment *seg);
+
+	/** as addElementSegment(), but safe while other threads add to the
+	 *  same AtomSegment */
+	void addElementSegmentAtomically(ElementSegment *seg);
+	
+	/** add another partial sum into this one */
+	void addSegment(AtomSegment *other);
 	float density(int i, int j);
 	
 	void clear();
 
 	virtual float elementValue(long i) const
 	{
-		return _data[i].value[0] / (float)FIXED_MULTIPLY;
+		return _data[i].value[0];
 	}
 private:
 
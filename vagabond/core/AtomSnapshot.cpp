@@ -0,0 +1,704 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Please email: vagabond @ hginn.co.uk for more details.
+
+#include "AtomSnapshot.h"
+#include "AtomContent.h"
+#include "Atom.h"
+#include "BondLength.h"
+#include "BondAngle.h"
+#include "BondTorsion.h"
+#include "Chirality.h"
+#include "HyperValue.h"
+#include "Environment.h"
+#include "FileManager.h"
+#include <vagabond/utils/FileReader.h>
+#include <unordered_map>
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <atomic>
+#include <mutex>
+#include <map>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* bump whenever the layout of the records below changes */
+#define SNAPSHOT_VERSION (1)
+
+std::string AtomSnapshot::_directory;
+bool AtomSnapshot::_chosen = false;
+
+const std::string &AtomSnapshot::directory()
+{
+	if (!_chosen)
+	{
+		std::string dir = user_cache_directory();
+		_directory = (dir.length() ? dir + "/snapshots" : "");
+		_chosen = true;
+	}
+
+	return _directory;
+}
+
+struct AtomSnapshot::Header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t level;
+	uint64_t fileHash;
+	uint64_t geometryHash;
+	uint32_t atoms;
+	uint32_t lengths;
+	uint32_t angles;
+	uint32_t torsions;
+	uint32_t hypers;
+	uint32_t chirals;
+	uint32_t strings;
+	uint32_t stringBytes;
+};
+
+/* records are laid out in this order after the header, each section
+ * padded to eight bytes so that the mapped records can be read in place.
+ * Atoms and strings are referred to by index. */
+
+struct AtomRecord
+{
+	int32_t name;
+	int32_t code;
+	int32_t chain;
+	int32_t ele;
+	int32_t insert;
+	int32_t resNum;
+	int32_t atomNum;
+	int32_t hetatm;
+	float occupancy;
+	float b;
+	float pos[3];
+	int32_t pad;
+};
+
+struct LengthRecord
+{
+	int32_t atoms[2];
+	double length;
+};
+
+struct AngleRecord
+{
+	int32_t atoms[3];
+	int32_t pad;
+	double angle;
+};
+
+struct TorsionRecord
+{
+	int32_t atoms[4];
+	double angle;
+	int32_t constrained;
+	int32_t pad;
+};
+
+struct HyperRecord
+{
+	int32_t atom;
+	int32_t name;
+	int32_t constrained;
+	int32_t pad;
+	double value;
+};
+
+struct ChiralRecord
+{
+	int32_t atoms[4];
+	int32_t sign;
+	int32_t pad;
+};
+
+static const char snapshot_magic[8] = {'R', 'O', 'P', 'E', 'S', 'N', 'A', 'P'};
+
+static size_t padded(size_t size)
+{
+	return (size + 7) & ~(size_t)7;
+}
+
+static uint64_t hash_bytes(const char *data, size_t size,
+                           uint64_t h = 1469598103934665603ULL)
+{
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8)
+	{
+		uint64_t word;
+		memcpy(&word, data + i, 8);
+		h = (h ^ word) * 1099511628211ULL;
+		h ^= h >> 32;
+	}
+
+	for (; i < size; i++)
+	{
+		h = (h ^ (unsigned char)data[i]) * 1099511628211ULL;
+	}
+
+	return (h ^ size) * 1099511628211ULL;
+}
+
+/* read-only view of a whole file, unmapped on destruction */
+struct MappedFile
+{
+	MappedFile(const std::string &path)
+	{
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			return;
+		}
+
+		struct stat st;
+		if (fstat(fd, &st) == 0)
+		{
+			size = st.st_size;
+			if (size == 0)
+			{
+				ok = true;
+			}
+			else
+			{
+				void *ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (ptr != MAP_FAILED)
+				{
+					data = (const char *)ptr;
+					ok = true;
+				}
+			}
+		}
+
+		close(fd);
+	}
+
+	~MappedFile()
+	{
+		if (data)
+		{
+			munmap((void *)data, size);
+		}
+	}
+
+	const char *data = nullptr;
+	size_t size = 0;
+	bool ok = false;
+};
+
+static bool hash_file(const std::string &path, uint64_t *hash)
+{
+	MappedFile file(path);
+	if (!file.ok)
+	{
+		return false;
+	}
+
+	*hash = hash_bytes(file.data, file.size);
+	return true;
+}
+
+AtomSnapshot::AtomSnapshot(const std::string &filename, File::KnotLevel level)
+{
+	_level = level;
+
+	if (directory().length() == 0)
+	{
+		return;
+	}
+
+	std::string path = File::toFilename(filename);
+	if (!hash_file(path, &_fileHash))
+	{
+		return;
+	}
+
+	_geometryHash = (level == File::KnotNone ? 0 : geometryHash());
+
+	uint64_t key[] = {_fileHash, _geometryHash, (uint64_t)level,
+	                  SNAPSHOT_VERSION};
+	uint64_t name = hash_bytes((const char *)key, sizeof(key));
+
+	char hex[17];
+	snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)name);
+	_path = directory() + "/" + hex + ".snap";
+	_valid = true;
+}
+
+uint64_t AtomSnapshot::geometryHash()
+{
+	/* dictionaries rarely change during a session, so each is only hashed
+	 * again if its size or modification time has */
+	struct Stamp
+	{
+		off_t size;
+		time_t modified;
+		uint64_t hash;
+	};
+
+	static std::mutex mutex;
+	static std::map<std::string, Stamp> stamps;
+	std::unique_lock<std::mutex> lock(mutex);
+
+	std::set<std::string> files;
+	FileManager *fm = Environment::fileManager();
+	if (fm)
+	{
+		files = fm->geometryFiles();
+	}
+	files.insert("assets/geometry/standard_geometry.cif");
+
+	std::vector<uint64_t> hashes;
+	for (const std::string &file : files)
+	{
+		std::string path = File::toFilename(file);
+
+		struct stat st;
+		if (stat(path.c_str(), &st) != 0)
+		{
+			hashes.push_back(hash_bytes(file.c_str(), file.length()));
+			continue;
+		}
+
+		std::map<std::string, Stamp>::iterator it = stamps.find(path);
+		if (it == stamps.end() || it->second.size != st.st_size ||
+		    it->second.modified != st.st_mtime)
+		{
+			Stamp stamp{st.st_size, st.st_mtime, 0};
+			hash_file(path, &stamp.hash);
+			it = stamps.insert(std::make_pair(path, stamp)).first;
+			it->second = stamp;
+		}
+
+		hashes.push_back(it->second.hash);
+	}
+
+	return hash_bytes((const char *)&hashes[0],
+	                  hashes.size() * sizeof(uint64_t));
+}
+
+bool AtomSnapshot::matches(const Header &header) const
+{
+	return (memcmp(header.magic, snapshot_magic, 8) == 0 &&
+	        header.version == SNAPSHOT_VERSION &&
+	        header.level == (uint32_t)_level &&
+	        header.fileHash == _fileHash &&
+	        header.geometryHash == _geometryHash);
+}
+
+void AtomSnapshot::save(AtomGroup *group)
+{
+	if (!_valid)
+	{
+		return;
+	}
+
+	std::vector<std::string> strings;
+	std::unordered_map<std::string, int> string_ids;
+	auto intern = [&strings, &string_ids](const std::string &str)
+	{
+		auto it = string_ids.find(str);
+		if (it != string_ids.end())
+		{
+			return it->second;
+		}
+
+		string_ids[str] = strings.size();
+		strings.push_back(str);
+		return (int)strings.size() - 1;
+	};
+
+	std::unordered_map<const Atom *, int> atom_ids;
+	std::vector<AtomRecord> atoms(group->size());
+
+	for (size_t i = 0; i < group->size(); i++)
+	{
+		Atom *a = (*group)[i];
+		atom_ids[a] = i;
+
+		AtomRecord &r = atoms[i];
+		r = AtomRecord{};
+		r.name = intern(a->atomName());
+		r.code = intern(a->code());
+		r.chain = intern(a->chain());
+		r.ele = intern(a->elementSymbol());
+		r.insert = intern(a->residueId().insert);
+		r.resNum = a->residueId().num;
+		r.atomNum = a->atomNum();
+		r.hetatm = a->hetatm();
+		r.occupancy = a->occupancy();
+		r.b = a->initialBFactor();
+
+		for (size_t j = 0; j < 3; j++)
+		{
+			r.pos[j] = a->initialPosition()[j];
+		}
+	}
+
+	bool complete = true;
+	auto index = [&atom_ids, &complete](const Atom *a)
+	{
+		auto it = atom_ids.find(a);
+		if (it == atom_ids.end())
+		{
+			complete = false;
+			return -1;
+		}
+
+		return it->second;
+	};
+
+	std::vector<LengthRecord> lengths(group->bondLengthCount());
+	for (size_t i = 0; i < lengths.size(); i++)
+	{
+		BondLength *bl = group->bondLength(i);
+		lengths[i] = LengthRecord{};
+		lengths[i].atoms[0] = index(bl->atom(0));
+		lengths[i].atoms[1] = index(bl->atom(1));
+		lengths[i].length = bl->length();
+	}
+
+	std::vector<AngleRecord> angles(group->bondAngleCount());
+	for (size_t i = 0; i < angles.size(); i++)
+	{
+		BondAngle *ba = group->bondAngle(i);
+		angles[i] = AngleRecord{};
+		for (size_t j = 0; j < 3; j++)
+		{
+			angles[i].atoms[j] = index(ba->atom(j));
+		}
+		angles[i].angle = ba->angle();
+	}
+
+	std::vector<TorsionRecord> torsions(group->bondTorsionCount());
+	for (size_t i = 0; i < torsions.size(); i++)
+	{
+		BondTorsion *bt = group->bondTorsion(i);
+		torsions[i] = TorsionRecord{};
+		for (size_t j = 0; j < 4; j++)
+		{
+			torsions[i].atoms[j] = index(bt->atom(j));
+		}
+		torsions[i].angle = bt->angle();
+		torsions[i].constrained = bt->isConstrained();
+	}
+
+	std::vector<HyperRecord> hypers(group->hyperValueCount());
+	for (size_t i = 0; i < hypers.size(); i++)
+	{
+		HyperValue *hv = group->hyperValue(i);
+		hypers[i] = HyperRecord{};
+		hypers[i].atom = index(hv->atom());
+		hypers[i].name = intern(hv->name());
+		hypers[i].constrained = hv->isConstrained();
+		hypers[i].value = hv->value();
+	}
+
+	std::vector<ChiralRecord> chirals(group->chiralityCount());
+	for (size_t i = 0; i < chirals.size(); i++)
+	{
+		Chirality *ch = group->chirality(i);
+		chirals[i] = ChiralRecord{};
+		chirals[i].atoms[0] = index(ch->centreAtom());
+		for (size_t j = 0; j < 3; j++)
+		{
+			chirals[i].atoms[j + 1] = index(ch->atom(j));
+		}
+		chirals[i].sign = ch->sign();
+	}
+
+	if (!complete)
+	{
+		std::cout << "Not writing snapshot for atoms with bondstraints "
+		"outside the group" << std::endl;
+		return;
+	}
+
+	std::vector<uint32_t> offsets;
+	std::string blob;
+	for (const std::string &str : strings)
+	{
+		offsets.push_back(blob.size());
+		blob += str;
+		blob += '\0';
+	}
+
+	Header header{};
+	memcpy(header.magic, snapshot_magic, 8);
+	header.version = SNAPSHOT_VERSION;
+	header.level = _level;
+	header.fileHash = _fileHash;
+	header.geometryHash = _geometryHash;
+	header.atoms = atoms.size();
+	header.lengths = lengths.size();
+	header.angles = angles.size();
+	header.torsions = torsions.size();
+	header.hypers = hypers.size();
+	header.chirals = chirals.size();
+	header.strings = strings.size();
+	header.stringBytes = blob.size();
+
+	std::string out;
+	auto append = [&out](const void *data, size_t size)
+	{
+		out.append((const char *)data, size);
+		out.resize(padded(out.size()), '\0');
+	};
+
+	append(&header, sizeof(Header));
+	append(atoms.data(), atoms.size() * sizeof(AtomRecord));
+	append(lengths.data(), lengths.size() * sizeof(LengthRecord));
+	append(angles.data(), angles.size() * sizeof(AngleRecord));
+	append(torsions.data(), torsions.size() * sizeof(TorsionRecord));
+	append(hypers.data(), hypers.size() * sizeof(HyperRecord));
+	append(chirals.data(), chirals.size() * sizeof(ChiralRecord));
+	append(offsets.data(), offsets.size() * sizeof(uint32_t));
+	append(blob.data(), blob.size());
+
+	if (!is_directory(directory()))
+	{
+		mkdir(directory().c_str(), 0755);
+	}
+
+	/* written under a unique name and then moved into place, so that a
+	 * snapshot is never read while half-written */
+	static std::atomic<int> count{0};
+	std::string tmp = _path + "." + std::to_string(getpid()) + "_"
+	+ std::to_string(count++);
+
+	std::ofstream file(tmp, std::ios::out | std::ios::binary);
+	file.write(out.data(), out.size());
+	file.close();
+
+	if (!file || rename(tmp.c_str(), _path.c_str()) != 0)
+	{
+		std::cout << "Could not write snapshot " << _path << std::endl;
+		remove(tmp.c_str());
+	}
+}
+
+AtomContent *AtomSnapshot::load()
+{
+	if (!_valid)
+	{
+		return nullptr;
+	}
+
+	MappedFile file(_path);
+	if (!file.ok || file.size < sizeof(Header))
+	{
+		return nullptr;
+	}
+
+	const Header &header = *(const Header *)file.data;
+	if (!matches(header))
+	{
+		return nullptr;
+	}
+
+	size_t offset = padded(sizeof(Header));
+	auto section = [&file, &offset](size_t size) -> const char *
+	{
+		const char *start = file.data + offset;
+		offset += padded(size);
+		return (offset <= file.size ? start : nullptr);
+	};
+
+	const AtomRecord *atoms = (const AtomRecord *)
+	section(header.atoms * sizeof(AtomRecord));
+	const LengthRecord *lengths = (const LengthRecord *)
+	section(header.lengths * sizeof(LengthRecord));
+	const AngleRecord *angles = (const AngleRecord *)
+	section(header.angles * sizeof(AngleRecord));
+	const TorsionRecord *torsions = (const TorsionRecord *)
+	section(header.torsions * sizeof(TorsionRecord));
+	const HyperRecord *hypers = (const HyperRecord *)
+	section(header.hypers * sizeof(HyperRecord));
+	const ChiralRecord *chirals = (const ChiralRecord *)
+	section(header.chirals * sizeof(ChiralRecord));
+	const uint32_t *offsets = (const uint32_t *)
+	section(header.strings * sizeof(uint32_t));
+	const char *blob = section(header.stringBytes);
+
+	if (blob == nullptr || offset != file.size ||
+	    (header.stringBytes > 0 && blob[header.stringBytes - 1] != '\0'))
+	{
+		return nullptr;
+	}
+
+	/* check every reference before building anything */
+	bool ok = true;
+	auto check = [&ok](int32_t idx, uint32_t count)
+	{
+		ok &= (idx >= 0 && (uint32_t)idx < count);
+	};
+
+	for (size_t i = 0; i < header.strings; i++)
+	{
+		ok &= (offsets[i] < header.stringBytes);
+	}
+
+	for (size_t i = 0; i < header.atoms; i++)
+	{
+		const AtomRecord &r = atoms[i];
+		check(r.name, header.strings);
+		check(r.code, header.strings);
+		check(r.chain, header.strings);
+		check(r.ele, header.strings);
+		check(r.insert, header.strings);
+	}
+
+	for (size_t i = 0; i < header.lengths; i++)
+	{
+		for (size_t j = 0; j < 2; j++)
+		{
+			check(lengths[i].atoms[j], header.atoms);
+		}
+	}
+
+	for (size_t i = 0; i < header.angles; i++)
+	{
+		for (size_t j = 0; j < 3; j++)
+		{
+			check(angles[i].atoms[j], header.atoms);
+		}
+	}
+
+	for (size_t i = 0; i < header.torsions; i++)
+	{
+		for (size_t j = 0; j < 4; j++)
+		{
+			check(torsions[i].atoms[j], header.atoms);
+		}
+	}
+
+	for (size_t i = 0; i < header.hypers; i++)
+	{
+		check(hypers[i].atom, header.atoms);
+		check(hypers[i].name, header.strings);
+	}
+
+	for (size_t i = 0; i < header.chirals; i++)
+	{
+		for (size_t j = 0; j < 4; j++)
+		{
+			check(chirals[i].atoms[j], header.atoms);
+		}
+	}
+
+	if (!ok)
+	{
+		return nullptr;
+	}
+
+	auto str = [offsets, blob](int32_t idx)
+	{
+		return std::string(blob + offsets[idx]);
+	};
+
+	/* bondstraints are created in the order the Knotter made them, so that
+	 * every atom ends up with the same lists as after parsing */
+	AtomGroup group;
+	group.setOwns(true);
+	std::vector<Atom *> list(header.atoms);
+
+	try
+	{
+		for (size_t i = 0; i < header.atoms; i++)
+		{
+			const AtomRecord &r = atoms[i];
+			ResidueId id(r.resNum);
+			id.insert = str(r.insert);
+
+			Atom *a = new Atom();
+			list[i] = a;
+			std::string ele = str(r.ele);
+			if (ele.length())
+			{
+				a->setElementSymbol(ele);
+			}
+			a->setAtomName(str(r.name));
+			a->setAtomNum(r.atomNum);
+			a->setResidueId(id);
+			a->setHetatm(r.hetatm);
+			glm::vec3 pos = glm::vec3(r.pos[0], r.pos[1], r.pos[2]);
+			a->setInitialPosition(pos, r.b);
+			a->setOccupancy(r.occupancy);
+			a->setCode(str(r.code));
+			a->setChain(str(r.chain));
+			group.add(a);
+		}
+
+		for (size_t i = 0; i < header.lengths; i++)
+		{
+			const LengthRecord &r = lengths[i];
+			new BondLength(&group, list[r.atoms[0]], list[r.atoms[1]],
+			               r.length);
+		}
+
+		for (size_t i = 0; i < header.angles; i++)
+		{
+			const AngleRecord &r = angles[i];
+			new BondAngle(&group, list[r.atoms[0]], list[r.atoms[1]],
+			              list[r.atoms[2]], r.angle);
+		}
+
+		for (size_t i = 0; i < header.torsions; i++)
+		{
+			const TorsionRecord &r = torsions[i];
+			BondTorsion *bt = new BondTorsion(&group, list[r.atoms[0]],
+			                                  list[r.atoms[1]],
+			                                  list[r.atoms[2]],
+			                                  list[r.atoms[3]], r.angle);
+			bt->setConstrained(r.constrained);
+		}
+
+		for (size_t i = 0; i < header.chirals; i++)
+		{
+			const ChiralRecord &r = chirals[i];
+			new Chirality(&group, list[r.atoms[0]], list[r.atoms[1]],
+			              list[r.atoms[2]], list[r.atoms[3]], r.sign);
+		}
+
+		for (size_t i = 0; i < header.hypers; i++)
+		{
+			const HyperRecord &r = hypers[i];
+			HyperValue *hv = new HyperValue(&group, list[r.atom],
+			                                str(r.name), r.value);
+			hv->setConstrained(r.constrained);
+		}
+	}
+	catch (const std::runtime_error &err)
+	{
+		std::cout << "Ignoring snapshot " << _path << ": " << err.what()
+		<< std::endl;
+
+		for (Atom *a : list)
+		{
+			delete a;
+		}
+
+		return nullptr;
+	}
+
+	return new AtomContent(group);
+}
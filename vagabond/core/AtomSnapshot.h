@@ -0,0 +1,92 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Please email: vagabond @ hginn.co.uk for more details.
+
+#ifndef __vagabond__AtomSnapshot__
+#define __vagabond__AtomSnapshot__
+
+#include <string>
+#include <cstdint>
+#include "File.h"
+
+class AtomGroup;
+class AtomContent;
+
+/** \class AtomSnapshot
+ *  binary cache of the atoms found in a model file once parsed and knotted,
+ *  together with their bond lengths, angles, torsions, chiral centres and
+ *  hyper-values. Snapshots are named after a hash of the file contents, the
+ *  geometry dictionary and the knot level, so a changed file or dictionary
+ *  is never served stale geometry. Reading maps the snapshot into memory and
+ *  builds the atoms straight from its records, skipping the parse. */
+
+class AtomSnapshot
+{
+public:
+	/** @param filename model file as given to File::openUnknown
+	 *  @param level how much geometry was assigned when parsing */
+	AtomSnapshot(const std::string &filename, File::KnotLevel level);
+
+	/** @returns false if the model file could not be read, in which case
+	 *  load() and save() do nothing */
+	bool valid() const
+	{
+		return _valid;
+	}
+
+	/** Warning: passes ownership of the AtomContent onto the caller.
+	 *  @returns atoms restored from the snapshot, or nullptr if there is no
+	 *  matching snapshot */
+	AtomContent *load();
+
+	/** writes the atoms and bondstraints of the group. Failures are only
+	 *  reported, as the snapshot is just a cache. */
+	void save(AtomGroup *group);
+
+	const std::string &path() const
+	{
+		return _path;
+	}
+
+	/** directory for snapshot files, created when first saving. By default
+	 *  the snapshots directory in user_cache_directory(). Snapshots are 
+	 *  not used if empty. */
+	static void setDirectory(const std::string &dir)
+	{
+		_directory = dir;
+		_chosen = true;
+	}
+
+	static const std::string &directory();
+private:
+	struct Header;
+
+	static uint64_t geometryHash();
+
+	bool matches(const Header &header) const;
+
+	std::string _path;
+	uint64_t _fileHash = 0;
+	uint64_t _geometryHash = 0;
+	File::KnotLevel _level;
+	bool _valid = false;
+
+	static std::string _directory;
+	static bool _chosen;
+};
+
+#endif
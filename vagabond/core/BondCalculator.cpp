@@ -27,6 +27,7 @@
 #include "engine/SolventHandler.h"
 #include "engine/MapSumHandler.h"
 #include "Sampler.h"
+#include <algorithm>
 
 BondCalculator::BondCalculator()
 {
@@ -38,6 +39,16 @@ BondCalculator::BondCalculator()
 BondCalculator::~BondCalculator()
 {
 	reset();
+
+	for (Result *r : _spareResults)
+	{
+		r->destroy();
+	}
+
+	for (Result *r : _setAside)
+	{
+		r->destroy();
+	}
 }
 
 void BondCalculator::reset()
@@ -205,6 +216,16 @@ void BondCalculator::setupForceFieldHandler()
 	_ffHandler->setForceFieldCount(_maxThreads);
 }
 
+void BondCalculator::setProbeRadius(float probe)
+{
+	_probeRadius = probe;
+
+	if (_surfaceHandler != nullptr)
+	{
+		_surfaceHandler->setProbeRadius(probe);
+	}
+}
+
 void BondCalculator::setupSurfaceAreaHandler()
 {
 	if (!(_type & PipelineSolventSurfaceArea))
@@ -213,8 +234,9 @@ void BondCalculator::setupSurfaceAreaHandler()
 	}
 
 	_surfaceHandler = new SurfaceAreaHandler(this);
-	_surfaceHandler->setThreads(1);
-	_surfaceHandler->setMeasurerCount(1);
+	_surfaceHandler->setThreads(_maxThreads);
+	_surfaceHandler->setMeasurerCount(_maxThreads);
+	_surfaceHandler->setProbeRadius(_probeRadius);
 }
 
 void BondCalculator::setup()
@@ -313,11 +335,83 @@ void BondCalculator::start()
 
 Result *BondCalculator::acquireResult()
 {
+	{
+		std::unique_lock<std::mutex> lock(_asideMutex);
+		if (_setAside.size())
+		{
+			Result *r = _setAside.front();
+			_setAside.pop_front();
+			return r;
+		}
+	}
+
 	Result *result = nullptr;
 	_resultPool.acquireObjectOrNull(result);
 	return result;
 }
 
+Result *BondCalculator::acquireResult(const std::map<int, size_t> &tickets)
+{
+	{
+		std::unique_lock<std::mutex> lock(_asideMutex);
+		std::list<Result *>::iterator it;
+		for (it = _setAside.begin(); it != _setAside.end(); it++)
+		{
+			if (tickets.count((*it)->ticket))
+			{
+				Result *r = *it;
+				_setAside.erase(it);
+				return r;
+			}
+		}
+	}
+
+	while (true)
+	{
+		Result *r = nullptr;
+		_resultPool.acquireObjectOrNull(r);
+
+		if (r == nullptr || tickets.count(r->ticket))
+		{
+			return r;
+		}
+
+		/* belongs to someone else, keep it for their acquireResult() */
+		std::unique_lock<std::mutex> lock(_asideMutex);
+		_setAside.push_back(r);
+	}
+}
+
+Result *BondCalculator::freshResult(Job *job)
+{
+	Result *r = nullptr;
+	
+	{
+		std::unique_lock<std::mutex> lock(_spareMutex);
+		if (_spareResults.size())
+		{
+			r = _spareResults.back();
+			_spareResults.pop_back();
+		}
+	}
+
+	if (r == nullptr)
+	{
+		r = new Result();
+	}
+
+	r->setFromJob(job);
+	return r;
+}
+
+void BondCalculator::recycleResult(Result *r)
+{
+	r->reset();
+
+	std::unique_lock<std::mutex> lock(_spareMutex);
+	_spareResults.push_back(r);
+}
+
 void BondCalculator::submitResult(Result *r)
 {
 	_resultPool.pushObject(r);
@@ -386,6 +480,120 @@ int BondCalculator::submitJob(Job &original_job)
 	return ticket;
 }
 
+void BondCalculator::submitBatch(Batch &batch)
+{
+	if (batch.params.size() < batch.count * batch.size)
+	{
+		throw std::runtime_error("Batch has fewer parameters than its vector"
+		                         " count and size require");
+	}
+
+	batch.tickets.clear();
+	batch.deviations.resize(batch.count);
+	batch.scores.resize(batch.count);
+	batch.correlations.resize(batch.count);
+	batch.gradients.clear();
+	batch.gradients.resize(batch.count);
+	batch.positions.clear();
+
+	/* anything beyond the sequence's own results needs the other handlers,
+	 * so each vector must go down the pipeline as a job of its own */
+	const int loopable = (JobCalculateDeviations | JobDeviationGradient | 
+	                      JobPositionVector);
+	batch.looped = ((batch.requests & ~loopable) == 0 && batch.count > 0);
+	
+	/* looped batches are split into one chunk for each sequence */
+	size_t chunks = batch.count;
+	if (batch.looped)
+	{
+		size_t seqs = std::max(_sequenceHandler->sequenceCount(), 1);
+		chunks = std::min(batch.count, seqs);
+		
+		if (batch.requests & JobPositionVector)
+		{
+			/* chunks write their positions side by side */
+			batch.atoms = sequence()->vectorSize();
+			batch.positions.resize(batch.count * batch.atoms);
+		}
+	}
+
+	for (size_t c = 0; c < chunks; c++)
+	{
+		size_t start = (c * batch.count) / chunks;
+		size_t end = ((c + 1) * batch.count) / chunks;
+
+		Job job{};
+		job.requests = batch.requests;
+		job.borrowed = true;
+		job.custom.vecs.resize(1);
+
+		CustomVector &cv = job.custom.vecs[0];
+		cv.mean = batch.vector(start);
+		cv.size = batch.size;
+		cv.sample_num = batch.samples;
+
+		if (batch.fractions.size() > start)
+		{
+			job.fraction = batch.fractions[start];
+		}
+
+		if (batch.looped)
+		{
+			job.batch = &batch;
+			job.batch_start = start;
+			job.batch_end = end;
+		}
+
+		int ticket = submitJob(job);
+		batch.tickets[ticket] = start;
+	}
+}
+
+void BondCalculator::retrieveBatch(Batch &batch)
+{
+	size_t expected = batch.tickets.size();
+
+	for (size_t n = 0; n < expected; n++)
+	{
+		Result *r = acquireResult(batch.tickets);
+		
+		if (r == nullptr)
+		{
+			break;
+		}
+
+		if (batch.looped)
+		{
+			/* results were written straight into the batch */
+			recycleResult(r);
+			continue;
+		}
+
+		size_t i = batch.tickets[r->ticket];
+		batch.deviations[i] = r->deviation;
+		batch.scores[i] = r->score;
+		batch.correlations[i] = r->correlation;
+		batch.gradients[i].swap(r->gradient);
+		
+		if (r->requests & JobPositionVector)
+		{
+			batch.atoms = r->apl.size();
+			batch.positions.resize(batch.count * batch.atoms);
+			glm::vec3 *dest = &batch.positions[i * batch.atoms];
+
+			for (const AtomWithPos &awp : r->apl)
+			{
+				*dest = awp.wp.ave;
+				dest++;
+			}
+		}
+
+		recycleResult(r);
+	}
+	
+	batch.tickets.clear();
+}
+
 Job *BondCalculator::acquireJob()
 {
 	Job *job = nullptr;
@@ -409,6 +617,11 @@ void BondCalculator::finish()
 		_correlHandler->finish();
 	}
 
+	if (_surfaceHandler != nullptr)
+	{
+		_surfaceHandler->finish();
+	}
+
 	if (_mapHandler != nullptr)
 	{
 		_sumHandler->finish();
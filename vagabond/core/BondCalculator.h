@@ -24,6 +24,8 @@
 #include <climits>
 #include <vector>
 #include <queue>
+#include <list>
+#include <map>
 #include "engine/Handler.h"
 #include "TorsionBasis.h"
 #include "AnchorExtension.h"
@@ -87,6 +89,19 @@ public:
 	int submitJob(Job &job);
 	void submitResult(Result *result);
 	
+	/** submits the parameter vectors of the batch. If only deviations,
+	 *  gradients or position vectors are requested, the batch is split 
+	 *  into one chunk per sequence and each chunk is calculated in a loop,
+	 *  otherwise each vector is a job of its own. Jobs read their 
+	 *  parameters from the batch, which must be left untouched until 
+	 *  retrieveBatch() returns. */
+	void submitBatch(Batch &batch);
+
+	/** waits for all the results of a submitted batch and writes them into
+	 *  the batch's arrays, recycling the Result objects. Results of other
+	 *  jobs which arrive in the meantime are kept for acquireResult(). */
+	void retrieveBatch(Batch &batch);
+	
 	/** Set limits for which atoms should be used for output results such
 	 *  as deviation calculations for positions. All atom positions will
 	 *  nevertheless be calculated.
@@ -143,6 +158,10 @@ public:
 		_basisType = type;
 	}
 	
+	/** radius of solvent probe for surface area calculations in Angstroms,
+	 *  default 1.4 for water. Zero gives the Van der Waals surface. */
+	void setProbeRadius(float probe);
+	
 	void addAnchorExtension(Atom *atom, size_t bondCount = UINT_MAX);
 	void addAnchorExtension(AnchorExtension ext);
 	
@@ -207,6 +226,18 @@ public:
 
 	Job *acquireJob();
 	Result *acquireResult();
+
+	/** waits for a result belonging to one of the tickets, setting aside
+	 *  any others for acquireResult()
+	 *  @return nullptr if no results are expected */
+	Result *acquireResult(const std::map<int, size_t> &tickets);
+	
+	/** Result set up for the job, reused from recycleResult() if possible */
+	Result *freshResult(Job *job);
+
+	/** takes back a Result which is no longer needed, instead of calling
+	 *  Result::destroy() */
+	void recycleResult(Result *r);
 	void reset();
 private:
 	void sanityCheckPipeline();
@@ -232,12 +263,19 @@ private:
 	
 	Pool<Job *> _jobPool;
 	ExpectantPool<Result *> _resultPool;
-	Pool<Result *> _recyclePool;
+
+	std::vector<Result *> _spareResults;
+	std::mutex _spareMutex;
+
+	/* arrived while waiting for the results of other tickets */
+	std::list<Result *> _setAside;
+	std::mutex _asideMutex;
 
 	BondSequenceHandler *_sequenceHandler = nullptr;
 	MapTransferHandler *_mapHandler = nullptr;
 	CorrelationHandler *_correlHandler = nullptr;
 	SurfaceAreaHandler *_surfaceHandler = nullptr;
+	float _probeRadius = 1.4;
 	PointStoreHandler *_pointHandler = nullptr;
 	ForceFieldHandler *_ffHandler = nullptr;
 	SolventHandler *_solventHandler = nullptr;
@@ -89,6 +89,8 @@ void BondSequence::generateBlocks()
 	_blocks.reserve(_blocks.size() + incoming.size());
 	_blocks.insert(_blocks.end(), incoming.begin(), incoming.end());
 	_singleSequence = _blocks.size();
+	_packed.clear();
+	_atomIndex.reset();
 	
 	for (size_t i = 0; i < _grapher.programCount(); i++)
 	{
@@ -149,6 +151,7 @@ void BondSequence::multiplyUpBySampleCount()
 {
 	size_t blockCount = _blocks.size();
 	_singleSequence = blockCount;
+	_atomIndex.reset();
 	size_t size = blockCount * _sampleCount;
 
 	std::vector<AtomBlock> copyBlock = _blocks;
@@ -158,6 +161,8 @@ void BondSequence::multiplyUpBySampleCount()
 	{
 		_blocks.insert(_blocks.end(), copyBlock.begin(), copyBlock.end());
 	}
+
+	_packed.clear();
 }
 
 Coord::Interpolate<float> BondSequence::getTorsionFunction(int idx)
@@ -184,8 +189,40 @@ Coord::Interpolate<float> BondSequence::getTorsionFunction(int idx)
 	}
 }
 
+void BondSequence::evaluateTorsions()
+{
+	int revision = torsionBasis()->revision();
+
+	if (_compiled.n != _nCoord || _compiled.revision != revision)
+	{
+		_compiled.usable = torsionBasis()->compile(_compiled, _nCoord);
+		_compiled.n = _nCoord;
+		_compiled.revision = revision;
+	}
+	
+	if (!_compiled.usable)
+	{
+		return;
+	}
+
+	_coords.resize(_nCoord);
+	for (size_t i = 0; i < _nCoord; i++)
+	{
+		_coords[i] = _acquireCoord(i);
+	}
+
+	_sampleTorsions.resize(_compiled.reference.size());
+	_compiled.evaluate(_coords.data(), _sampleTorsions.data());
+}
+
 float BondSequence::fetchTorsion(int idx)
 {
+	if (_compiled.usable)
+	{
+		int tidx = _blocks[idx].torsion_idx;
+		return (tidx >= 0 ? _sampleTorsions[tidx] : 0);
+	}
+
 	auto f = getTorsionFunction(idx);
 	if (f)
 	{
@@ -201,6 +238,9 @@ void BondSequence::wipe()
 	{
 		block.get_torsion = Coord::Interpolate<float>{};
 	}
+
+	_compiled.clear();
+	_lastTorsions.clear();
 }
 
 // ensures that the position sampler can pre-calculate all the necessary atom
@@ -248,6 +288,12 @@ int BondSequence::calculateBlock(int idx)
 	}
 
 	float t = fetchTorsion(idx);
+	return calculateBlock(idx, t);
+}
+
+int BondSequence::calculateBlock(int idx, float t)
+{
+	AtomBlock &b = _blocks[idx];
 	fetchAtomTarget(idx);
 	
 	glm::mat4x4 rot = b.prepareRotation(t);
@@ -304,6 +350,7 @@ void BondSequence::acquireCustomVector(int sampleNum)
 		{
 			return 0;
 		};
+		evaluateTorsions();
 		return;
 	}
 
@@ -315,25 +362,33 @@ void BondSequence::acquireCustomVector(int sampleNum)
 	}
 	
 	CustomVector *custom = &j.custom.vecs[_customIdx];
-	Sampler *sampler = _sampler;
-	float *tensor = custom->tensor;
-	float *vec = custom->mean;
 	_nCoord = custom->size;
 	
-	_acquireCoord = [tensor, vec, sampler, sampleNum](const int idx) -> float
+	if (_sampler && _expandedIdx != _customIdx)
 	{
-		float val = vec[idx];
-		if (sampler)
-		{
-			sampler->add_to_vec_index(val, idx, tensor, sampleNum);
-		}
-		return val;
+		_sampler->expand(custom->mean, custom->tensor, custom->size, 
+		                 _sampleVectors);
+		_expandedIdx = _customIdx;
+	}
+
+	const float *vec = custom->mean;
+	if (_sampler && sampleNum < _sampler->pointCount())
+	{
+		vec = &_sampleVectors[sampleNum * custom->size];
+	}
+	
+	_acquireCoord = [vec](const int idx) -> float
+	{
+		return vec[idx];
 	};
+
+	evaluateTorsions();
 }
 
 void BondSequence::fastCalculate()
 {
 	_customIdx = 0;
+	_expandedIdx = -1;
 
 	int start = _startCalc;
 	int end = _endCalc;
@@ -358,9 +413,6 @@ void BondSequence::fastCalculate()
 	}
 	
 	_fullRecalc = false;
-	
-	signal(SequencePositionsReady);
-
 }
 
 void BondSequence::superpose()
@@ -395,6 +447,7 @@ void BondSequence::superpose()
 
 		pose.superpose();
 		const glm::mat4x4 &trans = pose.transformation();
+		_poses.push_back(trans);
 
 		if (_usingPrograms)
 		{
@@ -418,44 +471,350 @@ void BondSequence::superpose()
 	}
 }
 
-void BondSequence::calculate()
+bool BondSequence::canPackBlocks() const
 {
-	bool extract = true;
-	
-	if (job())
+	/* ring programs, position samplers and partial recalculation all
+	 * need the state of individual AtomBlocks between blocks */
+	bool programs = (_usingPrograms && _programs.size() > 0);
+
+	return (_packBlocks && _sampleCount > 1 && !_skipSections &&
+	        _posSampler == nullptr && !programs);
+}
+
+void BondSequence::packedCalculate()
+{
+	if (!_packed.packed())
 	{
-		extract = (job()->requests & JobExtractPositions);
+		_packed.pack(_blocks, _singleSequence, _sampleCount);
 	}
 
-	if (_skipSections && !_fullRecalc)
+	int sampleNum = 0;
+	acquireCustomVector(sampleNum);
+
+	/* fetched in the same order as calculate() so that custom vectors 
+	 * are switched over at the same blocks */
+	for (size_t i = 0; i < _blocks.size(); i++)
 	{
-		fastCalculate();
-		return;
+		_packed.torsion(i % _singleSequence, i / _singleSequence) 
+		= fetchTorsion(i);
+		
+		if (i % _singleSequence == 0)
+		{
+			acquireCustomVector(sampleNum);
+			sampleNum++;
+		}
 	}
 
-	_customIdx = 0;
+	_packed.loadRoots(_blocks);
+	_packed.calculate();
+	_packed.unpack(_blocks);
+}
+
+bool BondSequence::canSkipUnchanged() const
+{
+	/* targets from position samplers change without any change in 
+	 * torsion */
+	return (_skipUnchanged && _posSampler == nullptr);
+}
+
+void BondSequence::markChildren(int idx)
+{
+	const AtomBlock &b = _blocks[idx];
+
+	for (size_t i = 0; i < 4; i++)
+	{
+		bool write = (b.atom == nullptr ? i == 0 : (int)i < b.nBonds);
+
+		if (write && b.write_locs[i] >= 0)
+		{
+			_dirty[idx + b.write_locs[i]] = true;
+		}
+	}
+}
+
+void BondSequence::markAligned()
+{
+	_aligned.clear();
+	_aligned.resize(_blocks.size(), false);
 	
+	for (size_t i = 0; i < _blocks.size() && _usingPrograms; i++)
+	{
+		if (_blocks[i].program < 0)
+		{
+			continue;
+		}
+
+		RingProgram &prog = _programs[_blocks[i].program];
+
+		for (const int &rel : prog.alignmentIndices())
+		{
+			_aligned[i + rel] = true;
+		}
+	}
+}
+
+bool BondSequence::programChanged(int idx)
+{
+	RingProgram &prog = _programs[_blocks[idx].program];
+	bool changed = false;
+
+	for (const int &rel : prog.alignmentIndices())
+	{
+		if (rel < 0 && _moved[idx + rel])
+		{
+			changed = true;
+		}
+	}
+
+	/* hyper-values fetched in the same way as the program will */
+	std::vector<float> &last = _programValues[idx];
+	last.resize(prog.parameterCount(), NAN);
+
+	for (size_t i = 0; i < prog.parameterCount(); i++)
+	{
+		int tidx = prog.parameterIndex(i);
+		float v = torsionBasis()->valueForParameter(this, tidx, _acquireCoord,
+		                                            _nCoord)(_acquireCoord);
+
+		if (!(v == last[i]))
+		{
+			last[i] = v;
+			changed = true;
+		}
+	}
+
+	return changed;
+}
+
+void BondSequence::prepareProgram(int idx)
+{
+	RingProgram &prog = _programs[_blocks[idx].program];
+
+	/* the program must align to these where they were calculated, not
+	 * where it moved them last time */
+	for (const int &rel : prog.alignmentIndices())
+	{
+		int j = idx + rel;
+
+		if (rel < 0 && !_moved[j])
+		{
+			_blocks[j].basis[3] = _calculated[j];
+		}
+	}
+}
+
+void BondSequence::markProgram(int idx)
+{
+	RingProgram &prog = _programs[_blocks[idx].program];
+
+	for (const int &rel : prog.exitIndices())
+	{
+		markChildren(idx + rel);
+	}
+}
+
+void BondSequence::changedCalculate()
+{
+	bool full = (_fullRecalc || _lastTorsions.size() != _blocks.size());
+
+	if (full)
+	{
+		_lastTorsions.resize(_blocks.size());
+		_lastAnchors.resize(_blocks.size());
+		_unposed.resize(_blocks.size());
+		_dirty.resize(_blocks.size());
+		_moved.resize(_blocks.size());
+		_calculated.resize(_blocks.size());
+		_programValues.clear();
+		markAligned();
+	}
+	else
+	{
+		/* blocks which are not recalculated must not keep the previous
+		 * superposition */
+		for (size_t i = 0; i < _blocks.size(); i++)
+		{
+			if (_blocks[i].atom != nullptr)
+			{
+				_blocks[i].basis[3] = _unposed[i];
+			}
+		}
+	}
+
+	std::fill(_dirty.begin(), _dirty.end(), full);
+
 	int sampleNum = 0;
 	acquireCustomVector(sampleNum);
-	prewarnPositionSampler();
-	
+
+	/* blocks always write to children further down the list, so a single
+	 * pass carries changes down each subtree */
 	for (size_t i = 0; i < _blocks.size(); i++)
 	{
-		calculateBlock(i);
-		
+		AtomBlock &b = _blocks[i];
+		float t = fetchTorsion(i);
+
+		bool changed = _dirty[i] || !(t == _lastTorsions[i]);
+		bool program = (b.program >= 0 && _usingPrograms);
+
+		if (b.atom == nullptr && b.basis != _lastAnchors[i])
+		{
+			changed = true;
+		}
+
+		if (b.silenced && _usingPrograms)
+		{
+			/* placed by the ring program instead */
+			changed = false;
+		}
+		else if (program && programChanged(i))
+		{
+			changed = true;
+		}
+
+		_moved[i] = changed;
+
+		if (changed)
+		{
+			if (_aligned[i] && b.atom != nullptr)
+			{
+				/* unless the parent has just written a fresh basis, this
+				 * still holds the position given by the ring program */
+				if (!_dirty[i])
+				{
+					b.basis[3] = _calculated[i];
+				}
+
+				_calculated[i] = b.basis[3];
+			}
+
+			if (program)
+			{
+				prepareProgram(i);
+			}
+
+			calculateBlock(i, t);
+			markChildren(i);
+			_lastTorsions[i] = t;
+
+			if (program)
+			{
+				markProgram(i);
+			}
+
+			if (b.atom == nullptr)
+			{
+				_lastAnchors[i] = b.basis;
+			}
+		}
+
 		if (i % _singleSequence == 0)
 		{
 			acquireCustomVector(sampleNum);
-			prewarnPositionSampler();
 			sampleNum++;
 		}
 	}
+
+	for (size_t i = 0; i < _blocks.size(); i++)
+	{
+		_unposed[i] = _blocks[i].basis[3];
+	}
+}
+
+void BondSequence::calculate()
+{
+	calculatePositions();
+	signal(SequencePositionsReady);
+}
+
+void BondSequence::calculateBatch(Job *job)
+{
+	Batch &batch = *job->batch;
+	setJob(job);
+
+	CustomVector &cv = job->custom.vecs[0];
+
+	for (size_t i = job->batch_start; i < job->batch_end; i++)
+	{
+		cv.mean = batch.vector(i);
+
+		if (batch.fractions.size() > i)
+		{
+			job->fraction = batch.fractions[i];
+		}
+
+		calculatePositions();
+
+		if (job->requests & JobCalculateDeviations)
+		{
+			batch.deviations[i] = calculateDeviations();
+		}
+
+		if (job->requests & JobDeviationGradient)
+		{
+			batch.gradients[i] = calculateDeviationGradient();
+		}
+
+		if (job->requests & JobPositionVector)
+		{
+			/* positions were sized on submission, as other sequences are
+			 * writing into the same array */
+			const AtomPosList &apl = extractVector();
+			glm::vec3 *dest = &batch.positions[i * batch.atoms];
+
+			for (size_t j = 0; j < apl.size() && j < batch.atoms; j++)
+			{
+				dest[j] = apl[j].wp.ave;
+			}
+		}
+	}
+}
+
+void BondSequence::calculatePositions()
+{
+	_poses.clear();
+
+	/* only packedCalculate() brings the packed positions up to date */
+	_packed.invalidate();
+
+	if (_skipSections && !_fullRecalc)
+	{
+		fastCalculate();
+		return;
+	}
+
+	_customIdx = 0;
+	_expandedIdx = -1;
+	
+	if (canPackBlocks())
+	{
+		packedCalculate();
+	}
+	else if (canSkipUnchanged())
+	{
+		changedCalculate();
+	}
+	else
+	{
+		int sampleNum = 0;
+		acquireCustomVector(sampleNum);
+		prewarnPositionSampler();
+
+		for (size_t i = 0; i < _blocks.size(); i++)
+		{
+			calculateBlock(i);
+
+			if (i % _singleSequence == 0)
+			{
+				acquireCustomVector(sampleNum);
+				prewarnPositionSampler();
+				sampleNum++;
+			}
+		}
+	}
 	
 	_fullRecalc = false;
 	
 	superpose();
-
-	signal(SequencePositionsReady);
 }
 
 double BondSequence::calculateDeviations()
@@ -505,6 +864,117 @@ double BondSequence::calculateDeviations()
 	return sum / count;
 }
 
+std::vector<float> BondSequence::calculateDeviationGradient()
+{
+	std::vector<float> grad;
+	bool programs = (_usingPrograms && _programs.size() > 0);
+
+	if (!_compiled.usable || programs || job() == nullptr)
+	{
+		return grad;
+	}
+
+	/* derivative of each atom's contribution to calculateDeviations() with
+	 * respect to its position */
+	std::vector<glm::vec3> dpos(_blocks.size(), glm::vec3(0.f));
+	double count = 0;
+
+	for (size_t i = _startCalc; i < _blocks.size() && i < _endCalc; i++)
+	{
+		if (_blocks[i].atom == nullptr || !_blocks[i].flag)
+		{
+			continue;
+		}
+		
+		if (_ignoreHydrogens && strcmp(_blocks[i].element, "H") == 0)
+		{
+			continue;
+		}
+
+		glm::vec3 target = _blocks[i].target;
+		float frac = job()->fraction;
+		if (frac > 1e-6)
+		{
+			target += _blocks[i].moving * frac;
+		}
+
+		glm::vec3 diff = _blocks[i].my_position() - target;
+		
+		if (diff.x != diff.x)
+		{
+			continue;
+		}
+		
+		float length = glm::length(diff);
+		if (length > 0)
+		{
+			dpos[i] = diff / length;
+		}
+
+		count++;
+	}
+	
+	grad.resize(_nCoord, 0);
+	if (count == 0)
+	{
+		return grad;
+	}
+
+	/* children are always found at higher indices than their parents, so
+	 * walking backwards gives each block the sum of derivatives over all of
+	 * its descendants, and of their moments about the origin */
+	std::vector<glm::vec3> sums(_blocks.size(), glm::vec3(0.f));
+	std::vector<glm::vec3> moments(_blocks.size(), glm::vec3(0.f));
+
+	for (int i = (int)_blocks.size() - 1; i >= 0; i--)
+	{
+		const AtomBlock &b = _blocks[i];
+
+		for (size_t j = 0; j < 4; j++)
+		{
+			bool write = (b.atom == nullptr ? j == 0 : (int)j < b.nBonds);
+
+			if (!write || b.write_locs[j] < 0)
+			{
+				continue;
+			}
+
+			int n = i + b.write_locs[j];
+			glm::vec3 p = _blocks[n].my_position();
+			sums[i] += sums[n] + dpos[n];
+			moments[i] += moments[n] + glm::cross(p, dpos[n]);
+		}
+
+		if (b.atom == nullptr || b.torsion_idx < 0)
+		{
+			continue;
+		}
+
+		/* the torsion rotates every descendant p about the block's z axis,
+		 * moving it by axis x (p - pivot) per radian */
+		glm::vec3 axis = (_packed.current() ? _packed.axis(i) :
+		                  glm::vec3(b.basis[2]));
+
+		size_t sample = i / _singleSequence;
+		if (sample < _poses.size())
+		{
+			axis = glm::mat3(_poses[sample]) * axis;
+		}
+
+		glm::vec3 pivot = b.my_position();
+		glm::vec3 moment = moments[i] - glm::cross(pivot, sums[i]);
+		float dt = glm::dot(axis, moment) * deg2rad(1.) / count;
+
+		int t = b.torsion_idx;
+		for (int k = _compiled.offsets[t]; k < _compiled.offsets[t + 1]; k++)
+		{
+			grad[_compiled.indices[k]] += _compiled.coefficients[k] * dt;
+		}
+	}
+
+	return grad;
+}
+
 const AtomPosList &BondSequence::extractVector()
 {
 	_posList.clear();
@@ -527,6 +997,21 @@ const AtomPosList &BondSequence::extractVector()
 	return _posList;
 }
 
+size_t BondSequence::vectorSize() const
+{
+	size_t count = 0;
+
+	for (size_t i = _startCalc; i < _blocks.size() && i < _endCalc; i++)
+	{
+		if (_blocks[i].atom != nullptr)
+		{
+			count++;
+		}
+	}
+
+	return count;
+}
+
 const AtomPosMap &BondSequence::extractPositions()
 {
 	for (auto it = _posAtoms.begin(); it != _posAtoms.end(); it++)
@@ -551,6 +1036,85 @@ const AtomPosMap &BondSequence::extractPositions()
 	return _posAtoms;
 }
 
+void BondSequence::prepareAtomIndex()
+{
+	if (_atomIndex)
+	{
+		return;
+	}
+
+	std::vector<Atom *> atoms;
+	std::unordered_map<Atom *, int> appearances;
+	_flatSlots.clear();
+	_flatSamples = 0;
+
+	for (size_t i = _startCalc; i < _blocks.size() && i < _endCalc; i++)
+	{
+		Atom *atom = _blocks[i].atom;
+		if (atom == nullptr)
+		{
+			_flatSlots.push_back(-1);
+			continue;
+		}
+
+		if (appearances.count(atom) == 0)
+		{
+			appearances[atom] = 0;
+			atoms.push_back(atom);
+		}
+
+		int &sample = appearances[atom];
+		_flatSamples = std::max(_flatSamples, (size_t)sample + 1);
+		_flatSlots.push_back(sample);
+		sample++;
+	}
+	
+	AtomIndex *index = new AtomIndex(atoms);
+
+	/* sample numbers become offsets now that the atom count is known */
+	for (size_t i = _startCalc; i < _blocks.size() && i < _endCalc; i++)
+	{
+		int &slot = _flatSlots[i - _startCalc];
+		if (slot >= 0)
+		{
+			int idx = index->indexOf(_blocks[i].atom);
+			slot = (slot * atoms.size() + idx) * 3;
+		}
+	}
+
+	_atomIndex.reset(index);
+}
+
+void BondSequence::extractFlat(FlatPositions &fp)
+{
+	prepareAtomIndex();
+
+	fp.index = _atomIndex;
+	fp.samples = _flatSamples;
+
+	size_t total = _flatSamples * _atomIndex->size() * 3;
+	fp.positions.assign(total, NAN);
+	fp.targets.assign(total, NAN);
+
+	for (size_t i = _startCalc; i < _blocks.size() && i < _endCalc; i++)
+	{
+		int slot = _flatSlots[i - _startCalc];
+		if (slot < 0)
+		{
+			continue;
+		}
+		
+		glm::vec3 mypos = _blocks[i].my_position();
+		const glm::vec3 &target = _blocks[i].target;
+
+		for (size_t k = 0; k < 3; k++)
+		{
+			fp.positions[slot + k] = mypos[k];
+			fp.targets[slot + k] = target[k];
+		}
+	}
+}
+
 std::vector<BondSequence::ElePos> BondSequence::extractForMap()
 {
 	std::vector<ElePos> epos;
@@ -605,6 +1169,7 @@ const size_t BondSequence::flagged() const
 void BondSequence::reflagDepth(int min, int max, int sidemax)
 {
 	_posAtoms.clear();
+	_atomIndex.reset();
 	wipe();
 
 	_startCalc = 0;
@@ -32,6 +32,7 @@
 #include <vagabond/utils/Vec3s.h>
 #include "BondTorsion.h"
 #include "AtomBlock.h"
+#include "PackedBlocks.h"
 #include "Grapher.h"
 #include "TorsionBasis.h"
 #include "AnchorExtension.h"
@@ -83,6 +84,11 @@ public:
 	
 	glm::vec3 positionForPreviousBlock(int i)
 	{
+		if (_packed.current())
+		{
+			return _packed.parentPosition(i);
+		}
+
 		return _blocks[i].parent_position();
 	}
 	
@@ -93,6 +99,11 @@ public:
 	
 	glm::vec3 positionForNextBlock(int i, int j)
 	{
+		if (_packed.current())
+		{
+			return _packed.childPosition(i, j);
+		}
+
 		return _blocks[i].child_position(j);
 	}
 	
@@ -150,9 +161,22 @@ public:
 	}
 
 	void calculate();
+
+	/** calculates the job's share of its batch, from Job::batch_start up
+	 *  to Job::batch_end, one vector after another, and writes the
+	 *  requested results into the batch. Leaves the sequence to be cleaned
+	 *  up to idle by the caller. */
+	void calculateBatch(Job *job);
 	void superpose();
 	const AtomPosMap &extractPositions();
+
+	/** writes positions of the calculated atoms into a result's flat
+	 *  buffers, reusing their capacity */
+	void extractFlat(FlatPositions &fp);
 	const AtomPosList &extractVector();
+
+	/** number of atoms which extractVector() will return */
+	size_t vectorSize() const;
 	
 	struct ElePos
 	{
@@ -163,6 +187,12 @@ public:
 	std::vector<ElePos> extractForMap();
 	double calculateDeviations();
 
+	/** gradient of calculateDeviations() with respect to each element of
+	 *  the custom vector, accumulated backwards over the block tree. The
+	 *  superposition is treated as fixed. Empty if the torsion basis is
+	 *  not linear in the custom vector or ring programs are in use. */
+	std::vector<float> calculateDeviationGradient();
+
 	void setSampleCount(int count)
 	{
 		_sampleCount = count;
@@ -194,15 +224,28 @@ private:
 	void markHydrogenGraphs();
 	
 	std::vector<AtomBlock> _blocks;
+	PackedBlocks _packed;
 
 	void generateBlocks();
 	void acquireCustomVector(int sampleNum);
 	void makeTorsionBasis();
+	void calculatePositions();
 	void fastCalculate();
+	bool canPackBlocks() const;
+	void packedCalculate();
+	bool canSkipUnchanged() const;
+	void changedCalculate();
+	void markAligned();
+	bool programChanged(int idx);
+	void prepareProgram(int idx);
+	void markProgram(int idx);
+	void markChildren(int idx);
 	void prewarnPositionSampler();
 	void prewarnTorsions();
 
 	int calculateBlock(int idx);
+	int calculateBlock(int idx, float torsion);
+	void evaluateTorsions();
 	float fetchTorsion(int idx);
 	void fetchAtomTarget(int idx);
 	Coord::Interpolate<float> getTorsionFunction(int idx);
@@ -233,6 +276,34 @@ private:
 	Coord::Get _acquireCoord;
 	int _nCoord = 0;
 
+	/* current custom vector expanded against every sample point, one row
+	 * of _nCoord values per sample */
+	std::vector<float> _sampleVectors;
+	int _expandedIdx = -1;
+
+	/* flat torsion table from the basis, evaluated once per sample */
+	CompiledTorsions _compiled;
+	std::vector<float> _coords;
+	std::vector<float> _sampleTorsions;
+
+	/* torsions and anchor bases from the previous calculation, and atom
+	 * positions from before they were superposed, per block */
+	std::vector<float> _lastTorsions;
+	std::vector<glm::mat4x4> _lastAnchors;
+	std::vector<glm::vec4> _unposed;
+	std::vector<bool> _dirty;
+	
+	/* blocks recalculated in the current calculation, blocks which ring
+	 * programs align to, their positions before the program moved them, 
+	 * and hyper-values last given to the program of each trigger block */
+	std::vector<bool> _moved;
+	std::vector<bool> _aligned;
+	std::vector<glm::vec4> _calculated;
+	std::map<int, std::vector<float>> _programValues;
+	
+	/* superposition applied to each sample by superpose() */
+	std::vector<glm::mat4x4> _poses;
+
 	Job *_job = nullptr;
 	BondSequenceHandler *_handler = nullptr;
 	TorsionBasis *_torsionBasis = nullptr;
@@ -254,6 +325,14 @@ private:
 	AtomPosMap _posAtoms;
 	AtomPosList _posList;
 	
+	void prepareAtomIndex();
+
+	/* atoms in range of calculation, and for each block in the range, the
+	 * offset of its atom in the flat buffer or -1 */
+	std::shared_ptr<const AtomIndex> _atomIndex;
+	std::vector<int> _flatSlots;
+	size_t _flatSamples = 0;
+	
 	struct Torsioner
 	{
 		Coord::Interpolate<float> get_torsion;
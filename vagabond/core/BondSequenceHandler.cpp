@@ -48,7 +48,7 @@ BondSequenceHandler::~BondSequenceHandler()
 		delete _sequences[i];
 	}
 	
-	std::map<SequenceState, Pool<BondSequence *> >::iterator it;
+	std::map<SequenceState, SequencePool>::iterator it;
 }
 
 void BondSequenceHandler::calculateThreads(int max)
@@ -79,7 +79,7 @@ void BondSequenceHandler::prepareThreads()
 		ExtrWorker *worker = new ExtrWorker(this);
 		worker->setPointStoreHandler(_pointHandler);
 		std::thread *thr = new std::thread(&ExtrWorker::start, worker);
-		Pool<BondSequence *> &pool = _pools[SequencePositionsReady];
+		SequencePool &pool = _pools[SequencePositionsReady];
 
 		pool.addWorker(worker, thr);
 	}
@@ -89,7 +89,7 @@ void BondSequenceHandler::prepareThreads()
 		/* several calculators */
 		CalcWorker *worker = new CalcWorker(this);
 		std::thread *thr = new std::thread(&CalcWorker::start, worker);
-		Pool<BondSequence *> &pool = _pools[SequenceCalculateReady];
+		SequencePool &pool = _pools[SequenceCalculateReady];
 
 		pool.addWorker(worker, thr);
 	}
@@ -101,6 +101,16 @@ void BondSequenceHandler::setup()
 	calculateThreads(_maxThreads);
 	sanityCheckThreads();
 	prepareSequenceBlocks();
+
+#ifndef VERSION_MUTEX_POOLS
+	/* every sequence may end up waiting in the same pool */
+	std::map<SequenceState, SequencePool>::iterator it;
+	for (it = _pools.begin(); it != _pools.end(); it++)
+	{
+		it->second.setCapacity(_sequences.size());
+	}
+#endif
+
 	int dimensions = 0;
 	if (_sampler)
 	{
@@ -172,13 +182,13 @@ void BondSequenceHandler::signalToHandler(BondSequence *seq, SequenceState state
 		_run++;
 	}
 
-	Pool<BondSequence *> &pool = _pools[state];
+	SequencePool &pool = _pools[state];
 	pool.pushObject(seq);
 }
 
 BondSequence *BondSequenceHandler::acquireSequence(SequenceState state)
 {
-	Pool<BondSequence *> &pool = _pools[state];
+	SequencePool &pool = _pools[state];
 	BondSequence *seq = nullptr;
 	
 	pool.acquireObject(seq);
@@ -121,7 +121,14 @@ private:
 
 	TorsionBasis::Type _basisType = TorsionBasis::TypeSimple;
 	
-	std::map<SequenceState, Pool<BondSequence *> > _pools;
+	/* define VERSION_MUTEX_POOLS to go back to the mutex-guarded pools */
+#ifdef VERSION_MUTEX_POOLS
+	typedef Pool<BondSequence *> SequencePool;
+#else
+	typedef RingPool<BondSequence *> SequencePool;
+#endif
+
+	std::map<SequenceState, SequencePool> _pools;
 
 	std::vector<AnchorExtension> _atoms;
 
@@ -0,0 +1,313 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Please email: vagabond @ hginn.co.uk for more details.
+
+#include "CMAESEngine.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+/* learning rates and step size damping follow Hansen's defaults, see
+ * "The CMA Evolution Strategy: A Tutorial" (arXiv:1604.00772) */
+
+using namespace PCA;
+
+CMAESEngine::CMAESEngine(RunsEngine *ref) : Engine(ref)
+{
+	_generator.seed(1);
+}
+
+CMAESEngine::~CMAESEngine()
+{
+	freeSVD(&_svd);
+	freeMatrix(&_cov);
+}
+
+void CMAESEngine::setupStrategy()
+{
+	const int dims = n();
+	int minimum = 4 + floor(3 * log(dims));
+	int lambda = std::max(_lambda, minimum);
+	_mu = lambda / 2;
+
+	_weights.resize(_mu);
+	double sum = 0;
+	for (size_t i = 0; i < _mu; i++)
+	{
+		_weights[i] = log(_mu + 0.5) - log(i + 1.);
+		sum += _weights[i];
+	}
+
+	double sumsq = 0;
+	for (double &w : _weights)
+	{
+		w /= sum;
+		sumsq += w * w;
+	}
+
+	_mueff = 1 / sumsq;
+
+	_cc = (4 + _mueff / dims) / (dims + 4 + 2 * _mueff / dims);
+	_cs = (_mueff + 2) / (dims + _mueff + 5);
+	_c1 = 2 / ((dims + 1.3) * (dims + 1.3) + _mueff);
+	_cmu = 2 * (_mueff - 2 + 1 / _mueff) / ((dims + 2) * (dims + 2) + _mueff);
+	_cmu = std::min(1 - _c1, _cmu);
+	_damps = 1 + 2 * std::max(0., sqrt((_mueff - 1) / (dims + 1)) - 1) + _cs;
+	_chiN = sqrt(dims) * (1 - 1 / (4. * dims) + 1 / (21. * dims * dims));
+
+	_population.resize(lambda);
+	for (Candidate &c : _population)
+	{
+		c.z.resize(dims);
+		c.y.resize(dims);
+	}
+
+	_pathSigma = Vec(dims, 0);
+	_pathC = Vec(dims, 0);
+	_diag = Vec(dims, 1);
+
+	freeSVD(&_svd);
+	freeMatrix(&_cov);
+	setupSVD(&_svd, dims);
+	setupMatrix(&_cov, dims, dims);
+
+	for (size_t i = 0; i < dims; i++)
+	{
+		_cov[i][i] = 1;
+		_svd.u[i][i] = 1;
+	}
+
+	_sigma = _step;
+	_generation = 0;
+	_lastDecomposed = 0;
+}
+
+std::vector<float> CMAESEngine::candidate(const Candidate &c) const
+{
+	std::vector<float> x(_mean.size());
+	for (size_t i = 0; i < _mean.size(); i++)
+	{
+		x[i] = _mean[i] + _sigma * c.y[i];
+	}
+
+	return x;
+}
+
+void CMAESEngine::sendGeneration()
+{
+	const int dims = n();
+	clearResults();
+
+	for (Candidate &c : _population)
+	{
+		for (size_t i = 0; i < dims; i++)
+		{
+			c.z[i] = _normal(_generator);
+		}
+
+		/* y = B D z */
+		for (size_t i = 0; i < dims; i++)
+		{
+			double sum = 0;
+			for (size_t j = 0; j < dims; j++)
+			{
+				sum += _svd.u[i][j] * _diag[j] * c.z[j];
+			}
+			c.y[i] = sum;
+		}
+
+		c.ticket = sendJob(candidate(c));
+	}
+
+	_runs += _population.size();
+}
+
+void CMAESEngine::collectGeneration()
+{
+	getResults();
+
+	for (Candidate &c : _population)
+	{
+		c.score = FLT_MAX;
+
+		if (_scores[c.ticket].received)
+		{
+			c.score = _scores[c.ticket].score;
+		}
+
+		if (c.score != c.score)
+		{
+			c.score = FLT_MAX;
+		}
+	}
+
+	std::stable_sort(_population.begin(), _population.end());
+}
+
+void CMAESEngine::updateDistribution()
+{
+	const int dims = n();
+	Vec yw(dims, 0);
+	Vec zw(dims, 0);
+
+	for (size_t k = 0; k < _mu; k++)
+	{
+		const Candidate &c = _population[k];
+		for (size_t i = 0; i < dims; i++)
+		{
+			yw[i] += _weights[k] * c.y[i];
+			zw[i] += _weights[k] * c.z[i];
+		}
+	}
+
+	for (size_t i = 0; i < dims; i++)
+	{
+		_mean[i] += _sigma * yw[i];
+	}
+
+	/* C^(-1/2) yw = B zw */
+	double ps = sqrt(_cs * (2 - _cs) * _mueff);
+	double psNorm = 0;
+	for (size_t i = 0; i < dims; i++)
+	{
+		double sum = 0;
+		for (size_t j = 0; j < dims; j++)
+		{
+			sum += _svd.u[i][j] * zw[j];
+		}
+
+		_pathSigma[i] = (1 - _cs) * _pathSigma[i] + ps * sum;
+		psNorm += _pathSigma[i] * _pathSigma[i];
+	}
+
+	psNorm = sqrt(psNorm);
+	_generation++;
+
+	double decay = 1 - pow(1 - _cs, 2 * _generation);
+	bool hsig = (psNorm / sqrt(decay) / _chiN < 1.4 + 2. / (dims + 1));
+
+	double pc = sqrt(_cc * (2 - _cc) * _mueff);
+	for (size_t i = 0; i < dims; i++)
+	{
+		_pathC[i] = (1 - _cc) * _pathC[i] + (hsig ? pc * yw[i] : 0);
+	}
+
+	double keep = 1 - _c1 - _cmu;
+	double lost = (hsig ? 0 : _c1 * _cc * (2 - _cc));
+
+	for (size_t i = 0; i < dims; i++)
+	{
+		for (size_t j = 0; j <= i; j++)
+		{
+			double rankMu = 0;
+			for (size_t k = 0; k < _mu; k++)
+			{
+				const Candidate &c = _population[k];
+				rankMu += _weights[k] * c.y[i] * c.y[j];
+			}
+
+			double val = (keep + lost) * _cov[i][j]
+			+ _c1 * _pathC[i] * _pathC[j] + _cmu * rankMu;
+
+			_cov[i][j] = val;
+			_cov[j][i] = val;
+		}
+	}
+
+	_sigma *= exp((_cs / _damps) * (psNorm / _chiN - 1));
+
+	/* decomposition is O(n^3), so is only refreshed once the covariance
+	 * has moved appreciably */
+	double gap = 1 / ((_c1 + _cmu) * dims * 10);
+	if (_generation - _lastDecomposed >= gap)
+	{
+		decompose();
+	}
+}
+
+void CMAESEngine::decompose()
+{
+	const int dims = n();
+	copyMatrix(_svd.u, _cov);
+
+	try
+	{
+		runSVD(&_svd);
+	}
+	catch (std::runtime_error &err)
+	{
+		/* degenerate covariance: start adapting it again from scratch */
+		for (size_t i = 0; i < dims; i++)
+		{
+			for (size_t j = 0; j < dims; j++)
+			{
+				_cov[i][j] = (i == j);
+				_svd.u[i][j] = (i == j);
+			}
+
+			_diag[i] = 1;
+			_pathC[i] = 0;
+		}
+
+		_lastDecomposed = _generation;
+		return;
+	}
+
+	/* covariance is symmetric positive definite, so singular values are
+	 * the eigenvalues and U holds the eigenvectors */
+	for (size_t i = 0; i < dims; i++)
+	{
+		_diag[i] = sqrt(std::max(_svd.w[i], 1e-20));
+	}
+
+	_lastDecomposed = _generation;
+}
+
+void CMAESEngine::run()
+{
+	if (n() == 0)
+	{
+		return;
+	}
+
+	setupStrategy();
+	std::vector<float> start = bestResult();
+	_mean = Vec(start.begin(), start.end());
+	_runs = 0;
+
+	while (_runs < _maxRuns)
+	{
+		sendGeneration();
+		collectGeneration();
+
+		if (_population[0].score >= FLT_MAX)
+		{
+			break;
+		}
+
+		updateDistribution();
+
+		double spread = *std::max_element(_diag.begin(), _diag.end());
+		if (_sigma * spread < _step * 1e-4)
+		{
+			break;
+		}
+	}
+
+	std::vector<float> mean(_mean.begin(), _mean.end());
+	setCurrent(mean);
+}
@@ -0,0 +1,101 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Please email: vagabond @ hginn.co.uk for more details.
+
+#ifndef __vagabond__CMAESEngine__
+#define __vagabond__CMAESEngine__
+
+#include <random>
+#include <vagabond/utils/svd/PCA.h>
+#include "Engine.h"
+
+/** \class CMAESEngine
+ *  covariance matrix adaptation evolution strategy. Each generation sends
+ *  the whole population of candidates before collecting any results, so
+ *  that the RunsEngine can work on all of them at once. The initial spread
+ *  of candidates is the engine's step size. */
+
+class CMAESEngine : public Engine
+{
+public:
+	CMAESEngine(RunsEngine *ref);
+	virtual ~CMAESEngine();
+
+	virtual void run();
+
+	/** number of candidates per generation, best matched to the number of
+	 *  threads available to the RunsEngine. Raised to 4 + 3 ln(n) if
+	 *  smaller, as fewer candidates cannot adapt the covariance reliably */
+	void setPopulation(int lambda)
+	{
+		_lambda = lambda;
+	}
+private:
+	typedef std::vector<double> Vec;
+
+	struct Candidate
+	{
+		Vec z;
+		Vec y;
+		int ticket;
+		float score;
+
+		bool operator<(const Candidate &other) const
+		{
+			return score < other.score;
+		}
+	};
+
+	void setupStrategy();
+	void sendGeneration();
+	void collectGeneration();
+	void updateDistribution();
+	void decompose();
+
+	std::vector<float> candidate(const Candidate &c) const;
+
+	std::mt19937 _generator;
+	std::normal_distribution<double> _normal;
+
+	std::vector<Candidate> _population;
+	Vec _weights;
+	Vec _mean;
+	Vec _pathSigma;
+	Vec _pathC;
+
+	/* covariance and its eigendecomposition C = B D^2 B' */
+	PCA::SVD _svd{};
+	PCA::Matrix _cov{};
+	Vec _diag;
+
+	int _lambda = 0;
+	int _mu = 0;
+	int _generation = 0;
+	int _lastDecomposed = 0;
+	int _runs = 0;
+
+	double _sigma = 1;
+	double _mueff = 1;
+	double _cc = 0;
+	double _cs = 0;
+	double _c1 = 0;
+	double _cmu = 0;
+	double _damps = 1;
+	double _chiN = 1;
+};
+
+#endif
@@ -41,7 +41,13 @@ public:
 		if (i == 2) return _c;
 		return nullptr;
 	}
-	
+
+	/** @returns sign of chiral volume for atoms in the order given */
+	const int &sign() const
+	{
+		return _sign;
+	}
+
 	/** get chirality signature for four atoms of which three must be
 	 * members of the Chirality assignment. The fourth superfluous atom pointer
 	 * will be set to nullptr. 
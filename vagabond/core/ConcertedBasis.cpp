@@ -20,6 +20,7 @@
 #include "ConcertedBasis.h"
 #include "Parameter.h"
 #include "Polymer.h"
+#include <typeinfo>
 
 ConcertedBasis::ConcertedBasis() : TorsionBasis()
 {
@@ -116,7 +117,7 @@ void ConcertedBasis::setupAngleList()
 
 	freeSVD(&_svd);
 	setupSVD(&_svd, _nActive, _dims);
-
+	_revision++;
 }
 
 void ConcertedBasis::prepareSVD()
@@ -191,6 +192,8 @@ bool ConcertedBasis::reverseLookup(Instance *inst, int axis,
 		}
 	}
 
+	_revision++;
+
 	return changed;
 }
 
@@ -231,6 +234,8 @@ bool ConcertedBasis::fillFromInstanceList(Instance *instance, int axis,
 		_svd.u[idx][axis] = value;
 	}
 	
+	_revision++;
+	
 	for (size_t i = 0; i < found.size(); i++)
 	{
 		if (!found[i])
@@ -288,6 +293,53 @@ ConcertedBasis::fullContribution(BondSequence *seq, int tidx,
 
 }
 
+bool ConcertedBasis::compile(CompiledTorsions &ct, int n) const
+{
+	/* subclasses take contributions from paths or networks, not _svd */
+	if (typeid(*this) != typeid(ConcertedBasis))
+	{
+		return false;
+	}
+
+	if (_angles.size() != _params.size() || _idxs.size() != _params.size())
+	{
+		return false;
+	}
+
+	ct.start();
+
+	for (size_t i = 0; i < _angles.size(); i++)
+	{
+		const TorsionAngle &ta = _angles[i];
+		float reference = ta.angle;
+		int contr_idx = _idxs[i];
+
+		if (n > 0 && ta.mask)
+		{
+			if (contr_idx < 0 || contr_idx >= _svd.u.rows)
+			{
+				reference = 0;
+			}
+			else
+			{
+				/* zero contributions do not change the sum */
+				for (int axis = 0; axis < n && axis < _svd.u.cols; axis++)
+				{
+					double svd = _svd.u[contr_idx][axis];
+					if (svd != 0)
+					{
+						ct.addTerm(axis, svd);
+					}
+				}
+			}
+		}
+
+		ct.finishTorsion(reference);
+	}
+
+	return true;
+}
+
 float ConcertedBasis::contributionForAxis(BondSequence *seq, 
                                     int tidx, int axis, 
                                     const Coord::Get &coord) const
@@ -36,6 +36,7 @@ public:
 	float parameterForVector(BondSequence *seq, int idx,
 	                         const Coord::Get &coord, int n);
 	virtual void prepare(int dims = 0);
+	virtual bool compile(CompiledTorsions &ct, int n) const;
 
 	virtual Coord::Interpolate<float> valueForParameter(BondSequence *seq, 
 	                                                    int tidx,
@@ -19,6 +19,7 @@
 #include "ElementLibrary.h"
 #include "ScatterFactors.h"
 #include "../utils/FileReader.h"
+#include <sstream>
 
 ElementLibrary ElementLibrary::_library;
 
@@ -31,6 +32,29 @@ ElementLibrary::ElementLibrary()
 	addElement("s", ScatterFactors::sScatter);
 	addElement("p", ScatterFactors::pScatter);
 	addElement("f", ScatterFactors::fScatter);
+
+	addRadius("h", 1.20);
+	addRadius("d", 1.20);
+	addRadius("c", 1.70);
+	addRadius("n", 1.55);
+	addRadius("o", 1.52);
+	addRadius("s", 1.80);
+	addRadius("p", 1.80);
+	addRadius("f", 1.47);
+	addRadius("cl", 1.75);
+	addRadius("br", 1.85);
+	addRadius("i", 1.98);
+	addRadius("se", 1.90);
+	addRadius("na", 2.27);
+	addRadius("mg", 1.73);
+	addRadius("k", 2.75);
+	addRadius("zn", 1.39);
+}
+
+void ElementLibrary::addRadius(std::string element, float radius)
+{
+	to_lower(element);
+	_radiusMap[element] = radius;
 }
 
 void ElementLibrary::addElement(std::string element, const float *scatter)
@@ -78,3 +102,39 @@ const float *ElementLibrary::getElementFactors(std::string element) const
 
 	return _elementMap.at(element);
 }
+
+float ElementLibrary::vdwRadius(std::string element) const
+{
+	to_lower(element);
+	std::map<std::string, float>::const_iterator it = _radiusMap.find(element);
+
+	if (it != _radiusMap.end())
+	{
+		return it->second;
+	}
+
+	/* called from surface area worker threads */
+	std::unique_lock<std::mutex> lock(_warnMutex);
+	if (_warnedRadius.count(element) == 0)
+	{
+		_warnedRadius.insert(element);
+		std::ostringstream ss;
+		ss << "Warning: element " << element << " not in Van der Waals "
+		"radius dictionary, using " << DEFAULT_VDW_RADIUS << " Angstroms";
+		_warnings.push_back(ss.str());
+	}
+
+	return DEFAULT_VDW_RADIUS;
+}
+
+std::string ElementLibrary::warning(int i) const
+{
+	std::unique_lock<std::mutex> lock(_warnMutex);
+	return _warnings[i];
+}
+
+size_t ElementLibrary::warningCount() const
+{
+	std::unique_lock<std::mutex> lock(_warnMutex);
+	return _warnings.size();
+}
@@ -20,7 +20,13 @@
 #define __vagabond__ElementLibrary__
 
 #include <map>
+#include <set>
+#include <mutex>
 #include <string>
+#include <vector>
+
+/* Bondi's radius for atoms he did not list, close to carbon */
+#define DEFAULT_VDW_RADIUS 1.80
 
 class ElementLibrary
 {
@@ -38,10 +44,24 @@ public:
 	float valueForResolution(float res, const float *scatter) const;
 
 	const float *getElementFactors(std::string element) const;
+
+	/** Van der Waals radius in Angstroms (Bondi, 1964). Elements outside
+	 *  the table get DEFAULT_VDW_RADIUS, and a warning is added the first
+	 *  time each one is asked for. */
+	float vdwRadius(std::string element) const;
+	
+	std::string warning(int i) const;
+	size_t warningCount() const;
 private:
 	void addElement(std::string element, const float *scatter);
+	void addRadius(std::string element, float radius);
 
 	std::map<std::string, const float *> _elementMap;
+	std::map<std::string, float> _radiusMap;
+
+	mutable std::set<std::string> _warnedRadius;
+	mutable std::vector<std::string> _warnings;
+	mutable std::mutex _warnMutex;
 	static ElementLibrary _library;
 
 };
@@ -18,6 +18,16 @@
 
 #include "ElementSegment.h"
 #include "ElementLibrary.h"
+#include <algorithm>
+
+/* kernel is cut off beyond where it falls below this fraction of its peak */
+#define KERNEL_CUTOFF (0.005)
+#define KERNEL_MAX_REACH (6)
+
+/* rough costs relative to a kernel multiply-add: writing one voxel of the
+ * splatted block into the map, and n log2(n) for a pair of real FFTs */
+#define BLOCK_COST (2.)
+#define FOURIER_COST (1.)
 
 ElementSegment::ElementSegment()
 : CubicGrid<VoxelElement>(0, 0, 0)
@@ -54,6 +64,299 @@ void ElementSegment::setElement(std::string element)
 			}
 		}
 	}
+
+	calculateKernel();
+}
+
+void ElementSegment::calculateKernel()
+{
+	_kernel.clear();
+	_block.clear();
+
+	if (nn() == 0)
+	{
+		return;
+	}
+
+	const int ns[3] = {nx(), ny(), nz()};
+	int reach[3];
+	std::vector<float> cosines[3];
+
+	/* the kernel is even along each axis, so only the octant up to the
+	 * maximum reach is needed: transform one axis at a time with cosines */
+	for (int a = 0; a < 3; a++)
+	{
+		reach[a] = std::min(KERNEL_MAX_REACH, (ns[a] - 1) / 2);
+		cosines[a].resize((reach[a] + 1) * ns[a]);
+
+		for (int r = 0; r <= reach[a]; r++)
+		{
+			for (int i = 0; i < ns[a]; i++)
+			{
+				double angle = 2 * M_PI * r * i / (double)ns[a];
+				cosines[a][r * ns[a] + i] = cos(angle);
+			}
+		}
+	}
+
+	const int mx = reach[0] + 1;
+	const int my = reach[1] + 1;
+	const int mz = reach[2] + 1;
+
+	std::vector<float> xs(mx * ns[1] * ns[2]);
+	for (int k = 0; k < ns[2]; k++)
+	{
+		for (int j = 0; j < ns[1]; j++)
+		{
+			for (int x = 0; x < mx; x++)
+			{
+				const float *c = &cosines[0][x * ns[0]];
+				double sum = 0;
+				for (int i = 0; i < ns[0]; i++)
+				{
+					sum += _data[index(i, j, k)].scatter * c[i];
+				}
+
+				xs[(k * ns[1] + j) * mx + x] = sum;
+			}
+		}
+	}
+
+	std::vector<float> ys(mx * my * ns[2]);
+	for (int k = 0; k < ns[2]; k++)
+	{
+		for (int y = 0; y < my; y++)
+		{
+			const float *c = &cosines[1][y * ns[1]];
+			for (int x = 0; x < mx; x++)
+			{
+				double sum = 0;
+				for (int j = 0; j < ns[1]; j++)
+				{
+					sum += xs[(k * ns[1] + j) * mx + x] * c[j];
+				}
+
+				ys[(k * my + y) * mx + x] = sum;
+			}
+		}
+	}
+
+	std::vector<float> octant(mx * my * mz);
+	for (int z = 0; z < mz; z++)
+	{
+		const float *c = &cosines[2][z * ns[2]];
+		for (int y = 0; y < my; y++)
+		{
+			for (int x = 0; x < mx; x++)
+			{
+				double sum = 0;
+				for (int k = 0; k < ns[2]; k++)
+				{
+					sum += ys[(k * my + y) * mx + x] * c[k];
+				}
+
+				octant[(z * my + y) * mx + x] = sum / (double)nn();
+			}
+		}
+	}
+
+	/* only keep as far as the kernel remains significant */
+	const float peak = fabs(octant[0]);
+	for (int a = 0; a < 3; a++)
+	{
+		_reach[a] = 0;
+	}
+
+	for (int z = 0; z < mz; z++)
+	{
+		for (int y = 0; y < my; y++)
+		{
+			for (int x = 0; x < mx; x++)
+			{
+				if (fabs(octant[(z * my + y) * mx + x]) > KERNEL_CUTOFF * peak)
+				{
+					_reach[0] = std::max(_reach[0], x);
+					_reach[1] = std::max(_reach[1], y);
+					_reach[2] = std::max(_reach[2], z);
+				}
+			}
+		}
+	}
+
+	const int kx = 2 * _reach[0] + 1;
+	const int ky = 2 * _reach[1] + 1;
+	const int kz = 2 * _reach[2] + 1;
+	_kernel.resize(kx * ky * kz);
+
+	double total = 0;
+	for (int k = 0; k < kz; k++)
+	{
+		for (int j = 0; j < ky; j++)
+		{
+			for (int i = 0; i < kx; i++)
+			{
+				int x = abs(i - _reach[0]);
+				int y = abs(j - _reach[1]);
+				int z = abs(k - _reach[2]);
+
+				float val = octant[(z * my + y) * mx + x];
+				_kernel[(k * ky + j) * kx + i] = val;
+				total += val;
+			}
+		}
+	}
+
+	/* truncation loses a little of the tail, so restore the electron
+	 * count carried by the zero-frequency term */
+	if (total > 0)
+	{
+		float scale = _data[0].scatter / total;
+		for (size_t i = 0; i < _kernel.size(); i++)
+		{
+			_kernel[i] *= scale;
+		}
+	}
+
+	_block.resize((kx + 1) * (ky + 1) * (kz + 1));
+}
+
+bool ElementSegment::preferDirect(size_t atoms) const
+{
+	if (_kernel.size() == 0)
+	{
+		return false;
+	}
+
+	double n = nn();
+	double per_atom = 8 * _kernel.size() + BLOCK_COST * _block.size();
+	double direct = (double)atoms * per_atom;
+	double fourier = 8 * (double)atoms + FOURIER_COST * n * log2(n);
+
+	return direct < fourier;
+}
+
+void ElementSegment::addAtoms(const std::vector<glm::vec3> &positions)
+{
+	bool direct = _route == Direct || 
+	(_route == Automatic && preferDirect(positions.size()));
+	
+	if (_kernel.size() == 0)
+	{
+		direct = false;
+	}
+
+	for (const glm::vec3 &pos : positions)
+	{
+		if (direct)
+		{
+			splatDensity(pos, 1);
+		}
+		else
+		{
+			addDensity(pos, 1);
+		}
+	}
+}
+
+void ElementSegment::splatDensity(glm::vec3 real, float density)
+{
+	real2Voxel(real);
+	collapse(real);
+
+	if (_splats.size() != nn())
+	{
+		_splats.assign(nn(), 0.f);
+	}
+
+	_splatted = true;
+
+	const int kx = 2 * _reach[0] + 1;
+	const int ky = 2 * _reach[1] + 1;
+	const int kz = 2 * _reach[2] + 1;
+	const int bx = kx + 1;
+	const int by = ky + 1;
+	const int bz = kz + 1;
+
+	int corner[3];
+	float fracs[3];
+	for (int i = 0; i < 3; i++)
+	{
+		corner[i] = (int)floor(real[i]);
+		fracs[i] = real[i] - corner[i];
+	}
+
+	const float *kernel = &_kernel[0];
+	float *block = &_block[0];
+	std::fill(_block.begin(), _block.end(), 0.f);
+
+	/* same split over the eight surrounding voxels as addDensity(), each
+	 * share spreading a copy of the kernel into the block. Rows of kernel
+	 * and block are contiguous so the innermost loop vectorises. */
+	for (int r = 0; r < 2; r++)
+	{
+		for (int q = 0; q < 2; q++)
+		{
+			for (int p = 0; p < 2; p++)
+			{
+				float w = (p ? fracs[0] : 1 - fracs[0]) *
+				(q ? fracs[1] : 1 - fracs[1]) *
+				(r ? fracs[2] : 1 - fracs[2]) * density;
+
+				if (w == 0)
+				{
+					continue;
+				}
+
+				for (int k = 0; k < kz; k++)
+				{
+					for (int j = 0; j < ky; j++)
+					{
+						const float *src = &kernel[(k * ky + j) * kx];
+						float *dest = &block[((k + r) * by + j + q) * bx + p];
+
+						for (int i = 0; i < kx; i++)
+						{
+							dest[i] += w * src[i];
+						}
+					}
+				}
+			}
+		}
+	}
+
+	/* block begins a reach away from the corner voxel, wrapped into the
+	 * unit cell */
+	const int ns[3] = {nx(), ny(), nz()};
+	int starts[3];
+	for (int i = 0; i < 3; i++)
+	{
+		starts[i] = corner[i] - _reach[i];
+		starts[i] = ((starts[i] % ns[i]) + ns[i]) % ns[i];
+	}
+
+	for (int k = 0; k < bz; k++)
+	{
+		int z = (starts[2] + k) % ns[2];
+
+		for (int j = 0; j < by; j++)
+		{
+			int y = (starts[1] + j) % ns[1];
+			float *row = &_splats[index(0, y, z)];
+			const float *src = &block[(k * by + j) * bx];
+			int x = starts[0];
+
+			for (int i = 0; i < bx; i++)
+			{
+				row[x] += src[i];
+				x++;
+
+				if (x == ns[0])
+				{
+					x = 0;
+				}
+			}
+		}
+	}
 }
 
 void ElementSegment::populatePlan(FFT<VoxelElement>::PlanDims &dims)
@@ -84,11 +387,27 @@ void ElementSegment::populatePlan(FFT<VoxelElement>::PlanDims &dims)
 	                                          &_data[0].value[1], 
 	                                          &_data[0].value[0], flags);
 
+	/* density is real, so only half of reciprocal space is needed */
+	dims.real_forward = fftwf_plan_guru_split_dft_r2c(rank, rankdims, 0, 
+	                                                  nullptr,
+	                                                  &_data[0].value[0], 
+	                                                  &_data[0].value[0], 
+	                                                  &_data[0].value[1], 
+	                                                  flags);
+
+	dims.real_backward = fftwf_plan_guru_split_dft_c2r(rank, rankdims, 0, 
+	                                                   nullptr,
+	                                                   &_data[0].value[0], 
+	                                                   &_data[0].value[1], 
+	                                                   &_data[0].value[0], 
+	                                                   flags);
+
 	_planStart = &_data[0].value;
 }
 
 void ElementSegment::addDensity(glm::vec3 real, float density)
 {
+	_deposited = true;
 	real2Voxel(real);
 
 	collapse(real);
@@ -144,15 +463,66 @@ void ElementSegment::addDensity(glm::vec3 real, float density)
 
 void ElementSegment::calculateMap()
 {
-	fft();
+	/* splatted density is already convolved with the kernel */
+	if (_deposited || !_splatted)
+	{
+		convolve();
+	}
+
+	if (_splatted)
+	{
+		for (size_t i = 0; i < nn(); i++)
+		{
+			_data[i].value[0] += _splats[i];
+		}
+
+		std::fill(_splats.begin(), _splats.end(), 0.f);
+	}
+
+	_splatted = false;
+	_deposited = false;
+}
+
+void ElementSegment::convolve()
+{
+	if (!hasRealPlan())
+	{
+		fft();
+
+		for (size_t i = 0; i < nn(); i++)
+		{
+			_data[i].value[0] *= _data[i].scatter;
+			_data[i].value[1] *= _data[i].scatter;
+		}
+
+		fft();
+		return;
+	}
+
+	realFFT();
 	
-	for (size_t i = 0; i < nn(); i++)
+	const int half = halfX();
+	for (int k = 0; k < nz(); k++)
 	{
-		_data[i].value[0] *= _data[i].scatter;
-		_data[i].value[1] *= _data[i].scatter;
+		for (int j = 0; j < ny(); j++)
+		{
+			long start = index(0, j, k);
+
+			for (long i = start; i <= start + half; i++)
+			{
+				_data[i].value[0] *= _data[i].scatter;
+				_data[i].value[1] *= _data[i].scatter;
+			}
+		}
 	}
 
-	fft();
+	realFFT();
+
+	/* imaginary components are left over from the Hermitian half */
+	for (size_t i = 0; i < nn(); i++)
+	{
+		_data[i].value[1] = 0;
+	}
 }
 
 void ElementSegment::printMap()
@@ -237,6 +607,14 @@ float ElementSegment::density(int i, int j)
 
 void ElementSegment::clear()
 {
+	if (_splatted)
+	{
+		std::fill(_splats.begin(), _splats.end(), 0.f);
+	}
+
+	_splatted = false;
+	_deposited = false;
+
 	for (size_t i = 0; i < nn(); i++)
 	{
 		element(i).value[0] = 0;
@@ -20,6 +20,7 @@
 #define __vagabond__ElementSegment__
 
 #include "FFTCubicGrid.h"
+#include <vector>
 
 class AtomGroup;
 struct Job;
@@ -34,6 +35,22 @@ class ElementSegment : public FFTCubicGrid<VoxelElement>
 {
 public:
 	ElementSegment();
+
+	/** route from atom positions to density: Fourier deposits atoms over
+	 * neighbouring voxels and convolves with the scattering factors by FFT,
+	 * Direct writes a truncated real-space kernel around each atom.
+	 * Automatic picks whichever is expected to be cheaper. */
+	enum Route
+	{
+		Automatic,
+		Fourier,
+		Direct,
+	};
+	
+	void setRoute(Route route)
+	{
+		_route = route;
+	}
 	
 	/** set the periodic table element symbol
 	 * @param element upper case element symbol e.g. CA for calcium. */
@@ -56,6 +73,26 @@ public:
 
 	virtual void populatePlan(FFT<VoxelElement>::PlanDims &dims);
 	void addDensity(glm::vec3 real, float density);
+
+	/** adds density for all positions by the chosen route. Follow with
+	 * calculateMap(), which skips the convolution if everything so far
+	 * was splatted directly. */
+	void addAtoms(const std::vector<glm::vec3> &positions);
+
+	/** writes the element's truncated real-space kernel around the
+	 * position into a grid of its own, so that it is not convolved again
+	 * with any Fourier deposits. calculateMap() adds it to the map. */
+	void splatDensity(glm::vec3 real, float density);
+	
+	/** whether direct splatting of this many atoms should beat the FFT */
+	bool preferDirect(size_t atoms) const;
+
+	/** furthest extent of the real-space kernel from its centre in voxels
+	 * along the x, y or z axis */
+	int kernelReach(int axis) const
+	{
+		return _reach[axis];
+	}
 	float density(int i, int j);
 	void printMap();
 	void clear();
@@ -75,9 +112,28 @@ public:
 protected:
 
 private:
+	void calculateKernel();
+	void convolve();
+
 	Job *_job;
 	std::string _elementSymbol;
 
+	Route _route = Automatic;
+	bool _splatted = false;
+	bool _deposited = false;
+
+	/* density splatted since the last calculateMap(), added to the map
+	 * only after any Fourier deposits have been convolved */
+	std::vector<float> _splats;
+
+	/* density from an atom on a voxel, spanning -reach to +reach voxels
+	 * in each direction, with x fastest */
+	std::vector<float> _kernel;
+	int _reach[3] = {0, 0, 0};
+
+	/* scratch space covering the kernel plus one voxel in each direction */
+	std::vector<float> _block;
+
 };
 
 #endif
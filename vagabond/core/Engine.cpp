@@ -117,6 +117,21 @@ int Engine::sendJob(const std::vector<float> &all)
 	return ticket;
 }
 
+std::vector<int> Engine::sendJobs(const std::vector<std::vector<float>> &all)
+{
+	std::vector<int> tickets = _ref->sendJobs(all);
+
+	for (size_t i = 0; i < tickets.size(); i++)
+	{
+		TicketScore ts{};
+		ts.vals = all[i];
+
+		_scores[tickets[i]] = ts;
+	}
+
+	return tickets;
+}
+
 std::vector<float> Engine::difference_from(std::vector<float> &other)
 {
 	std::vector<float> ret = _current;
@@ -31,6 +31,22 @@ public:
 	virtual size_t parameterCount() = 0;
 	virtual int sendJob(const std::vector<float> &all) = 0;
 
+	/** override to evaluate several parameter vectors together. Scores are
+	 *  collected through getResult() as usual.
+	 *  @returns tickets in the same order as the vectors */
+	virtual std::vector<int> sendJobs(const std::vector<std::vector<float>> 
+	                                  &all)
+	{
+		std::vector<int> tickets;
+
+		for (const std::vector<float> &one : all)
+		{
+			tickets.push_back(sendJob(one));
+		}
+
+		return tickets;
+	}
+
 	virtual float getResult(int *job_id)
 	{
 		if (_scores.size() == 0)
@@ -50,6 +66,48 @@ public:
 	{
 		_ticket = 0;
 		_scores.clear();
+		_gradients.clear();
+	}
+	
+	/** override to return true if this object has been supplying the 
+	 *  gradient of the score with respect to each parameter, for tickets
+	 *  sent while gradientsWanted() is true */
+	virtual bool returnsGradients()
+	{
+		return false;
+	}
+	
+	void setGradientsWanted(bool wanted)
+	{
+		_gradientsWanted = wanted;
+	}
+	
+	const bool &gradientsWanted() const
+	{
+		return _gradientsWanted;
+	}
+
+	/** forgets gradients which were supplied but never collected */
+	void clearGradients()
+	{
+		_gradients.clear();
+	}
+
+	/** moves the gradient for the ticket into grad, if it was supplied
+	 * 	@returns true if a gradient was available */
+	bool gradientForTicket(int ticket, std::vector<float> &grad)
+	{
+		std::map<int, std::vector<float>>::iterator it;
+		it = _gradients.find(ticket);
+
+		if (it == _gradients.end())
+		{
+			return false;
+		}
+		
+		grad.swap(it->second);
+		_gradients.erase(it);
+		return true;
 	}
 protected:
 	int getNextTicket()
@@ -67,14 +125,29 @@ protected:
 	{
 		_scores[ticket] = score;
 	}
+	
+	void setGradientForTicket(int ticket, const std::vector<float> &grad)
+	{
+		_gradients[ticket] = grad;
+	}
 private:
 	int _ticket = 0;
+	bool _gradientsWanted = false;
 	std::map<int, double> _scores;
+	std::map<int, std::vector<float>> _gradients;
 };
 
 class Engine
 {
 public:
+	enum Type
+	{
+		TypeSimplex,
+		TypeChemotaxis,
+		TypeLBFGS,
+		TypeCMAES,
+	};
+
 	Engine(RunsEngine *ref);
 	virtual ~Engine() {};
 	
@@ -119,8 +192,24 @@ private:
 	};
 protected:
 	int sendJob(const std::vector<float> &all);
+	std::vector<int> sendJobs(const std::vector<std::vector<float>> &all);
 	std::vector<float> findBestResult(float *score);
 	
+	bool gradientsAvailable()
+	{
+		return _ref->returnsGradients();
+	}
+	
+	bool gradientForTicket(int ticket, std::vector<float> &grad)
+	{
+		return _ref->gradientForTicket(ticket, grad);
+	}
+	
+	void setGradientsWanted(bool wanted)
+	{
+		_ref->setGradientsWanted(wanted);
+	}
+	
 	void getResults();
 	
 	const std::vector<float> &current() const
@@ -133,6 +222,7 @@ protected:
 	void clearResults()
 	{
 		_scores.clear();
+		_ref->clearGradients();
 	}
 	
 	void setCurrent(const std::vector<float> &chosen)
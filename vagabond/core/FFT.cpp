@@ -27,13 +27,13 @@ std::vector<typename FFT<T>::PlanDims> FFT<T>::_plans;
 template <class T>
 FFT<T>::FFT(int nx, int ny, int nz) : Grid<T>(nx, ny, nz)
 {
-	makePlans();
+
 }
 
 template <class T>
 FFT<T>::FFT() : Grid<T>()
 {
-	makePlans();
+
 }
 
 template <class T>
@@ -74,25 +74,78 @@ void FFT<T>::doFFT(int dir)
 	}
 }
 
+template <class T>
+void FFT<T>::realFFT()
+{
+	if (!hasRealPlan())
+	{
+		throw std::runtime_error("Real FFT requested but no plan available");
+	}
+
+	/* plans may have been made on another array, so must be given the
+	 * real and imaginary starts for this one */
+	float *re = &this->_planStart[0][0];
+	float *im = &this->_planStart[0][1];
+
+	if (_status == Real)
+	{
+		fftwf_execute_split_dft_r2c(_plan.real_forward, re, re, im);
+		_status = Reciprocal;
+	}
+	else if (_status == Reciprocal)
+	{
+		fftwf_execute_split_dft_c2r(_plan.real_backward, re, im, re);
+		this->multiply(1 / (float)this->nn());
+		_status = Real;
+	}
+	else
+	{
+		throw std::runtime_error("FFT status is Empty but asked to transform");
+	}
+}
+
+template <class T>
+int FFT<T>::alignment() const
+{
+	if (this->_data == nullptr)
+	{
+		return -1;
+	}
+
+	return fftwf_alignment_of((float *)this->_data);
+}
+
 template <class T>
 void FFT<T>::createNewPlan()
 {
+	FFTPlanner::importWisdom();
+
 	PlanDims plan{};
 	plan.nx = this->nx();
 	plan.ny = this->ny();
 	plan.nz = this->nz();
+	plan.align = alignment();
 
 	populatePlan(plan);
 	
 	_plan = plan;
+	
+	/* subclasses without a populatePlan() leave nothing to keep */
+	if (plan.forward != nullptr && plan.backward != nullptr)
+	{
+		_plans.push_back(plan);
+		FFTPlanner::exportWisdom();
+	}
 }
 
 template <class T>
-typename FFT<T>::PlanDims *FFT<T>::findPlan(int nx, int ny, int nz) const
+typename FFT<T>::PlanDims *FFT<T>::findPlan(int nx, int ny, int nz,
+                                            int align) const
 {
 	for (size_t i = 0; i < _plans.size(); i++)
 	{
-		if (_plans[i].nx == nx && _plans[i].ny == ny && _plans[i].nz == nz)
+		if (_plans[i].nx == nx && _plans[i].ny == ny && _plans[i].nz == nz
+		    && _plans[i].align == align)
 		{
 			return &_plans[i];
 		}
@@ -104,11 +157,18 @@ typename FFT<T>::PlanDims *FFT<T>::findPlan(int nx, int ny, int nz) const
 template <class T>
 void FFT<T>::makePlans()
 {
-	PlanDims *plan = findPlan(this->nx(), this->ny(), this->nz());
+	std::unique_lock<std::mutex> lock(FFTPlanner::mutex());
+
+	int align = alignment();
+	PlanDims *plan = findPlan(this->nx(), this->ny(), this->nz(), align);
 
 	if (plan != nullptr)
 	{
 		_plan = *plan;
+
+		/* the complex value comes first in every voxel type, so the data
+		 * can be handed to fftwf_execute_dft() directly */
+		_planStart = reinterpret_cast<fftwf_complex *>(this->_data);
 	}
 	else
 	{
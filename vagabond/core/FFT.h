@@ -21,6 +21,7 @@
 
 #include <fftw3.h>
 #include "TransformedGrid.h"
+#include "FFTPlanner.h"
 
 template <class T>
 class FFT : public virtual Grid<T>
@@ -30,6 +31,11 @@ public:
 	FFT(int nx, int ny, int nz);
 
 	virtual void fft();
+	
+	/** transform of purely real density, storing only the Hermitian half
+	 * of reciprocal space (x from 0 to nx / 2 inclusive) in the voxels with
+	 * the same indices. The remaining voxels are left untouched. */
+	void realFFT();
 	void makePlans();
 	
 	enum Status
@@ -51,26 +57,50 @@ public:
 
 	void doFFT(int dir);
 
+	/** Plans are cached per voxel type T, which fixes the stride layout,
+	 *  and re-used on new arrays of the same dimensions and alignment */
 	struct PlanDims
 	{
 		int nx;
 		int ny;
 		int nz;
+		int align;
 		fftwf_plan forward;
 		fftwf_plan backward;
+		fftwf_plan real_forward;
+		fftwf_plan real_backward;
 	};
 	
-	PlanDims *findPlan(int nx, int ny, int nz) const;
+	/** call with FFTPlanner::mutex() held */
+	PlanDims *findPlan(int nx, int ny, int nz, int align) const;
+
+	/** plan in use by this grid, after makePlans() */
+	const PlanDims &plan() const
+	{
+		return _plan;
+	}
 
 	virtual void populatePlan(PlanDims &dims) {};
+	
+	bool hasRealPlan() const
+	{
+		return _plan.real_forward != nullptr && _plan.real_backward != nullptr;
+	}
+
+	/** highest x index (inclusive) stored after realFFT() */
+	int halfX() const
+	{
+		return this->nx() / 2;
+	}
 protected:
 	fftwf_complex *_planStart = nullptr;
-	PlanDims _plan;
+	PlanDims _plan{};
 
 private:
 	Status _status = Empty;
 
 	void createNewPlan();
+	int alignment() const;
 	
 	static std::vector<PlanDims> _plans;
 	
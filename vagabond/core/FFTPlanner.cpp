@@ -0,0 +1,80 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// Please email: vagabond @ hginn.co.uk for more details.
+
+#include <fftw3.h>
+#include <iostream>
+#include "FFTPlanner.h"
+#include "../utils/FileReader.h"
+
+std::mutex FFTPlanner::_mutex;
+std::string FFTPlanner::_filename;
+bool FFTPlanner::_imported = false;
+bool FFTPlanner::_chosen = false;
+
+const std::string &FFTPlanner::wisdomFile()
+{
+	if (!_chosen)
+	{
+		std::string dir = user_cache_directory();
+		_filename = (dir.length() ? dir + "/rope.fftw_wisdom" : "");
+		_chosen = true;
+	}
+
+	return _filename;
+}
+
+bool FFTPlanner::importWisdom()
+{
+#ifndef __EMSCRIPTEN__
+	if (_imported)
+	{
+		return false;
+	}
+
+	_imported = true;
+	const std::string &filename = wisdomFile();
+
+	if (filename.length() == 0 || !file_exists(filename))
+	{
+		return false;
+	}
+
+	if (!fftwf_import_wisdom_from_filename(filename.c_str()))
+	{
+		std::cout << "Could not read FFTW wisdom from " << filename 
+		<< ", will measure plans again." << std::endl;
+		return false;
+	}
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+void FFTPlanner::exportWisdom()
+{
+#ifndef __EMSCRIPTEN__
+	const std::string &filename = wisdomFile();
+
+	if (filename.length() > 0)
+	{
+		fftwf_export_wisdom_to_filename(filename.c_str());
+	}
+#endif
+}
@@ -0,0 +1,64 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// Please email: vagabond @ hginn.co.uk for more details.
+
+#ifndef __vagabond__FFTPlanner__
+#define __vagabond__FFTPlanner__
+
+#include <mutex>
+#include <string>
+
+/** \class FFTPlanner
+ *  Process-wide state shared by all FFT<T> plan caches. FFTW's planner is
+ *  not thread-safe, so all planning happens under a single lock, and the
+ *  accumulated wisdom is kept in a file in the user's cache directory so
+ *  that later runs do not have to measure plans again. */
+
+class FFTPlanner
+{
+public:
+	/** hold whilst creating FFTW plans or touching any plan cache */
+	static std::mutex &mutex()
+	{
+		return _mutex;
+	}
+	
+	/** file to read/write wisdom, by default rope.fftw_wisdom in 
+	 *  user_cache_directory(). Wisdom is not kept if empty. */
+	static void setWisdomFile(std::string filename)
+	{
+		_filename = filename;
+		_chosen = true;
+		_imported = false;
+	}
+
+	static const std::string &wisdomFile();
+	
+	/** load wisdom from file, only once per file. Call with lock held.
+	 * @returns true if wisdom was read from the file on this call */
+	static bool importWisdom();
+
+	/** write out all wisdom gathered so far. Call with lock held. */
+	static void exportWisdom();
+private:
+	static std::mutex _mutex;
+	static std::string _filename;
+	static bool _imported;
+	static bool _chosen;
+};
+
+#endif
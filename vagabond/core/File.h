@@ -181,13 +181,16 @@ public:
 	}
 	
 	virtual void write(std::string filename) {}
+
+	/** @returns path to file, resolved against the data and user
+	 *  directories if it cannot be found as given */
+	static std::string toFilename(std::string filename);
 protected:
 
 	static bool compare_file_ending(const std::string &filename, 
 	                                const std::string &comp, File::Flavour result);
 
 	static Flavour flavour(std::string filename);
-	static std::string toFilename(std::string filename);
 	std::string _code;
 
 	void changeFilename(std::string filename);
@@ -0,0 +1,175 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Please email: vagabond @ hginn.co.uk for more details.
+
+#ifndef __vagabond__GeometryHash__
+#define __vagabond__GeometryHash__
+
+#include <vector>
+#include <cstdint>
+
+/** key for a geometry restraint: the residue code (or link group) it
+ *  belongs to, followed by up to four atom names, all as interned ids.
+ *  Unused atom slots are -1. */
+
+struct GeometryKey
+{
+	int map;
+	int ids[4];
+
+	GeometryKey(int m = -1, int p = -1, int q = -1, int r = -1, int s = -1)
+	{
+		map = m;
+		ids[0] = p;
+		ids[1] = q;
+		ids[2] = r;
+		ids[3] = s;
+	}
+
+	bool operator==(const GeometryKey &other) const
+	{
+		return (map == other.map && ids[0] == other.ids[0] &&
+		        ids[1] == other.ids[1] && ids[2] == other.ids[2] &&
+		        ids[3] == other.ids[3]);
+	}
+
+	size_t hash() const
+	{
+		uint64_t h = 1469598103934665603ULL;
+		h = (h ^ (uint32_t)map) * 1099511628211ULL;
+		for (size_t i = 0; i < 4; i++)
+		{
+			h = (h ^ (uint32_t)ids[i]) * 1099511628211ULL;
+		}
+
+		return h ^ (h >> 29);
+	}
+};
+
+/** \class GeometryHash
+ *  open-addressing hash table from GeometryKey to a value, with linear
+ *  probing. Entries are never removed. Reading is safe from several threads
+ *  as long as nothing is being added. */
+
+template <class V>
+class GeometryHash
+{
+public:
+	const V *find(const GeometryKey &key) const
+	{
+		if (_count == 0)
+		{
+			return nullptr;
+		}
+
+		size_t mask = _keys.size() - 1;
+		for (size_t i = key.hash() & mask; ; i = (i + 1) & mask)
+		{
+			if (!_used[i])
+			{
+				return nullptr;
+			}
+
+			if (_keys[i] == key)
+			{
+				return &_values[i];
+			}
+		}
+	}
+
+	/** adds the entry, or replaces the value of an existing one */
+	void set(const GeometryKey &key, const V &value)
+	{
+		if ((_count + 1) * 2 > _keys.size())
+		{
+			grow();
+		}
+
+		size_t mask = _keys.size() - 1;
+		size_t i = key.hash() & mask;
+		while (_used[i] && !(_keys[i] == key))
+		{
+			i = (i + 1) & mask;
+		}
+
+		if (!_used[i])
+		{
+			_used[i] = true;
+			_keys[i] = key;
+			_count++;
+		}
+
+		_values[i] = value;
+	}
+
+	size_t size() const
+	{
+		return _count;
+	}
+
+	/** number of slots, for iterating with used(), key() and value() */
+	size_t capacity() const
+	{
+		return _keys.size();
+	}
+
+	bool used(size_t i) const
+	{
+		return _used[i];
+	}
+
+	const GeometryKey &key(size_t i) const
+	{
+		return _keys[i];
+	}
+
+	const V &value(size_t i) const
+	{
+		return _values[i];
+	}
+private:
+	void grow()
+	{
+		std::vector<GeometryKey> keys;
+		std::vector<V> values;
+		std::vector<char> used;
+		keys.swap(_keys);
+		values.swap(_values);
+		used.swap(_used);
+
+		size_t size = (keys.size() == 0 ? 64 : keys.size() * 2);
+		_keys.resize(size);
+		_values.resize(size);
+		_used.resize(size, false);
+		_count = 0;
+
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			if (used[i])
+			{
+				set(keys[i], values[i]);
+			}
+		}
+	}
+
+	std::vector<GeometryKey> _keys;
+	std::vector<V> _values;
+	std::vector<char> _used;
+	size_t _count = 0;
+};
+
+#endif
@@ -25,6 +25,10 @@
 #include <vagabond/utils/FileReader.h>
 #include <vagabond/utils/version.h>
 #include <iostream>
+#include <algorithm>
+#include <exception>
+#include <atomic>
+#include <thread>
 
 GeometryTable GeometryTable::_loadedGeometry;
 
@@ -32,26 +36,76 @@ GeometryTable::GeometryTable()
 {
 	_mutex = new std::mutex();
 
+	_all = intern(".");
+	_n = intern("N");
+	_c = intern("C");
 }
 
 void GeometryTable::loadExtraGeometries(std::set<std::string> &files)
 {
 	std::unique_lock<std::mutex> lock(*_mutex);
 	
+	std::vector<std::string> todo;
 	for (const std::string &file : files)
 	{
-		if (_loadedFiles.count(file))
+		if (_loadedFiles.count(file) == 0)
 		{
-			continue;
+			todo.push_back(file);
+		}
+	}
+	
+	/* each file is read into a table of its own, and these are absorbed in
+	 * the original order so that later files still take precedence */
+	std::vector<GeometryTable> tables(todo.size());
+	std::vector<std::exception_ptr> errors(todo.size());
+	std::atomic<size_t> next{0};
+
+	auto work = [&todo, &tables, &errors, &next]()
+	{
+		size_t i;
+		while ((i = next++) < todo.size())
+		{
+			try
+			{
+				CifFile cf(todo[i]);
+				cf.setAutomaticKnot(File::KnotNone);
+				cf.setGeometryTable(&tables[i]);
+				cf.parse();
+			}
+			catch (...)
+			{
+				errors[i] = std::current_exception();
+			}
 		}
+	};
 
-		CifFile cf(file);
-		cf.setGeometryTable(this);
-		cf.parse();
-		_loadedFiles.insert(file);
+	size_t threads = std::max(1u, std::thread::hardware_concurrency());
+	threads = std::min(threads, todo.size());
+
+	std::vector<std::thread> workers;
+	for (size_t t = 1; t < threads; t++)
+	{
+		workers.push_back(std::thread(work));
 	}
-}
 
+	work();
+
+	for (std::thread &w : workers)
+	{
+		w.join();
+	}
+
+	for (size_t i = 0; i < todo.size(); i++)
+	{
+		if (errors[i])
+		{
+			std::rethrow_exception(errors[i]);
+		}
+
+		absorb(tables[i]);
+		_loadedFiles.insert(todo[i]);
+	}
+}
 
 GeometryTable &GeometryTable::getAllGeometry()
 {
@@ -63,8 +117,130 @@ GeometryTable &GeometryTable::getAllGeometry()
 	return _loadedGeometry;
 }
 
-void GeometryTable::addGeometryLength(std::string code, std::string pName,
-                                      std::string qName, double mean, 
+int GeometryTable::intern(const std::string &name)
+{
+	std::unordered_map<std::string, int>::iterator it = _ids.find(name);
+	if (it != _ids.end())
+	{
+		return it->second;
+	}
+
+	int id = _names.size();
+	_names.push_back(name);
+	_ids[name] = id;
+	return id;
+}
+
+int GeometryTable::id(const std::string &name) const
+{
+	std::unordered_map<std::string, int>::const_iterator it = _ids.find(name);
+	return (it == _ids.end() ? -1 : it->second);
+}
+
+int GeometryTable::addCode(const std::string &code)
+{
+	int id = intern(code);
+	_codes.insert(id);
+	return id;
+}
+
+void GeometryTable::addLinkRule(const std::string &link)
+{
+	if (_links.count(link))
+	{
+		return;
+	}
+
+	LinkRule rule{};
+	rule.map = intern(link);
+	rule.any = (link == ".");
+	rule.negate = (!rule.any && link.rfind("NOT", 0) != std::string::npos);
+
+	if (!rule.any)
+	{
+		std::vector<std::string> opts = split(link, ' ');
+
+		for (size_t i = (rule.negate ? 1 : 0); i < opts.size(); i++)
+		{
+			rule.codes.push_back(intern(opts[i]));
+		}
+	}
+
+	_links[link] = rule;
+}
+
+bool GeometryTable::linkMatches(const LinkRule &rule, int code) const
+{
+	if (rule.any)
+	{
+		return true;
+	}
+
+	bool listed = (std::find(rule.codes.begin(), rule.codes.end(), code)
+	               != rule.codes.end());
+
+	return (rule.negate ? !listed : listed);
+}
+
+template <class V>
+void GeometryTable::absorbHash(GeometryHash<V> &mine, 
+                               const GeometryHash<V> &theirs,
+                               const std::vector<int> &ids)
+{
+	for (size_t i = 0; i < theirs.capacity(); i++)
+	{
+		if (!theirs.used(i))
+		{
+			continue;
+		}
+
+		GeometryKey key = theirs.key(i);
+		key.map = ids[key.map];
+
+		for (size_t j = 0; j < 4; j++)
+		{
+			key.ids[j] = (key.ids[j] < 0 ? -1 : ids[key.ids[j]]);
+		}
+
+		mine.set(key, theirs.value(i));
+	}
+}
+
+void GeometryTable::absorb(const GeometryTable &other)
+{
+	std::vector<int> ids(other._names.size());
+	for (size_t i = 0; i < other._names.size(); i++)
+	{
+		ids[i] = intern(other._names[i]);
+	}
+
+	for (const int &code : other._codes)
+	{
+		_codes.insert(ids[code]);
+	}
+
+	for (auto it = other._atomNames.begin(); it != other._atomNames.end(); it++)
+	{
+		std::set<std::string> &names = _atomNames[ids[it->first]];
+		names.insert(it->second.begin(), it->second.end());
+	}
+
+	for (auto it = other._links.begin(); it != other._links.end(); it++)
+	{
+		addLinkRule(it->first);
+	}
+
+	absorbHash(_lengths, other._lengths, ids);
+	absorbHash(_angles, other._angles, ids);
+	absorbHash(_torsions, other._torsions, ids);
+	absorbHash(_chirals, other._chirals, ids);
+	absorbHash(_linkLengths, other._linkLengths, ids);
+	absorbHash(_linkAngles, other._linkAngles, ids);
+}
+
+void GeometryTable::addGeometryLength(const std::string &code, 
+                                      const std::string &pName,
+                                      const std::string &qName, double mean, 
                                       double stdev, bool link)
 {
 #ifndef VERSION_PROLINE
@@ -75,75 +251,85 @@ void GeometryTable::addGeometryLength(std::string code, std::string pName,
 	}
 #endif
 
-	GeometryMap &map = _codes[code];
+	int c = addCode(code);
+	int p = intern(pName);
+	int q = intern(qName);
 	
 	Value value = {mean, stdev};
-	AtomPair pair = {pName, qName};
 	
 	if (link)
 	{
-		_links[code].lengths[pair] = value;
+		addLinkRule(code);
+		_linkLengths.set(GeometryKey(c, p, q), value);
 		return;
 	}
 
-	map.lengths[pair] = value;
-	_codes["."].lengths[pair] = value;
+	/* any non-link geometry is also available as a fallback for all codes */
+	_codes.insert(_all);
 
-	pair = {qName, pName};
-	map.lengths[pair] = value;
-	_codes["."].lengths[pair] = value;
+	for (const int &m : {c, _all})
+	{
+		_lengths.set(GeometryKey(m, p, q), value);
+		_lengths.set(GeometryKey(m, q, p), value);
+
+		_atomNames[m].insert(pName);
+		_atomNames[m].insert(qName);
+	}
 }
 
-void GeometryTable::addGeometryAngle(std::string code, std::string pName, 
-                                     std::string qName, std::string rName, 
+void GeometryTable::addGeometryAngle(const std::string &code, 
+                                     const std::string &pName, 
+                                     const std::string &qName, 
+                                     const std::string &rName, 
                                      double mean, double stdev, bool link)
 {
-	GeometryMap &map = _codes[code];
+	int c = addCode(code);
+	int p = intern(pName);
+	int q = intern(qName);
+	int r = intern(rName);
 	
 	Value value = {mean, stdev};
-	AtomTriplet trio = {pName, qName, rName};
 	
 	if (link)
 	{
-		_links[code].angles[trio] = value;
-	}
-	else
-	{
-		map.angles[trio] = value;
-		_codes["."].angles[trio] = value;
+		addLinkRule(code);
+		_linkAngles.set(GeometryKey(c, p, q, r), value);
+		_linkAngles.set(GeometryKey(c, r, q, p), value);
+		return;
 	}
 
-	trio = {rName, qName, pName};
+	_codes.insert(_all);
 
-	if (link)
+	for (const int &m : {c, _all})
 	{
-		_links[code].angles[trio] = value;
-	}
-	else
-	{
-		map.angles[trio] = value;
-		_codes["."].angles[trio] = value;
+		_angles.set(GeometryKey(m, p, q, r), value);
+		_angles.set(GeometryKey(m, r, q, p), value);
 	}
 }
 
-void GeometryTable::addGeometryTorsion(std::string code, std::string pName, 
-                                       std::string qName, std::string rName, 
-                                       std::string sName, double mean, 
+void GeometryTable::addGeometryTorsion(const std::string &code, 
+                                       const std::string &pName, 
+                                       const std::string &qName, 
+                                       const std::string &rName, 
+                                       const std::string &sName, double mean, 
                                        double stdev, int period)
 {
-	GeometryMap &map = _codes[code];
+	int c = addCode(code);
+	int p = intern(pName);
+	int q = intern(qName);
+	int r = intern(rName);
+	int s = intern(sName);
 	
 	Value value = {mean, stdev};
-	AtomQuartet quartet = {pName, qName, rName, sName};
-	map.torsions[quartet] = value;
-
-	quartet = {sName, rName, qName, pName};
-	map.torsions[quartet] = value;
+	_torsions.set(GeometryKey(c, p, q, r, s), value);
+	_torsions.set(GeometryKey(c, s, r, q, p), value);
 }
 
-void GeometryTable::addGeometryChiral(std::string code, std::string centre,
-                                      std::string pName, std::string qName, 
-                                      std::string rName, int sign)
+void GeometryTable::addGeometryChiral(const std::string &code, 
+                                      const std::string &centre,
+                                      const std::string &pName, 
+                                      const std::string &qName, 
+                                      const std::string &rName, int sign)
 {
 #ifndef VERSION_PROLINE
 	if (code == "PRO" && centre == "N")
@@ -153,63 +339,58 @@ void GeometryTable::addGeometryChiral(std::string code, std::string centre,
 	}
 #endif
 
-	GeometryMap &map = _codes[code];
+	int c = addCode(code);
+	int o = intern(centre);
+	int p = intern(pName);
+	int q = intern(qName);
+	int r = intern(rName);
 	
 	/* in the same direction as described */
-	AtomQuartet quartet = {centre, pName, qName, rName};
-	map.chirals[quartet] = sign;
-
-	quartet = {centre, rName, pName, qName};
-	map.chirals[quartet] = sign;
-
-	quartet = {centre, qName, rName, pName};
-	map.chirals[quartet] = sign;
+	_chirals.set(GeometryKey(c, o, p, q, r), sign);
+	_chirals.set(GeometryKey(c, o, r, p, q), sign);
+	_chirals.set(GeometryKey(c, o, q, r, p), sign);
 
 	/* reverse signs in case the lookup event comes in reverse */
-	quartet = {centre, qName, pName, rName};
-	map.chirals[quartet] = -sign;
-
-	quartet = {centre, pName, rName, qName};
-	map.chirals[quartet] = -sign;
-
-	quartet = {centre, rName, qName, pName};
-	map.chirals[quartet] = -sign;
+	_chirals.set(GeometryKey(c, o, q, p, r), -sign);
+	_chirals.set(GeometryKey(c, o, p, r, q), -sign);
+	_chirals.set(GeometryKey(c, o, r, q, p), -sign);
 }
 
-
-bool GeometryTable::lengthExists(std::string code, std::string pName,
-                                 std::string qName)
+double GeometryTable::mean(const GeometryHash<Value> &hash, 
+                           const GeometryKey &key, double missing) const
 {
-	GeometryMap &map = _codes[code];
-
-	AtomPair pair = {pName, qName};
-	return (map.lengths.count(pair) > 0);
+	const Value *v = hash.find(key);
+	return (v == nullptr ? missing : v->mean);
 }
 
-double GeometryTable::length(const GeometryMap &map, std::string pName, 
-                             std::string qName) const
+double GeometryTable::stdev(const GeometryHash<Value> &hash, 
+                            const GeometryKey &key, double missing) const
 {
-	AtomPair pair = {pName, qName};
-	if (map.lengths.count(pair) == 0)
-	{
-		return -1;
-	}
+	const Value *v = hash.find(key);
+	return (v == nullptr ? missing : v->stdev);
+}
 
-	const Value &v = map.lengths.at(pair);
+bool GeometryTable::lengthExists(const std::string &code, 
+                                 const std::string &pName,
+                                 const std::string &qName) const
+{
+	GeometryKey key(id(code), id(pName), id(qName));
+	return (_lengths.find(key) != nullptr);
+}
 
-	return v.mean;
+double GeometryTable::length(const std::string &code, const std::string &pName,
+                             const std::string &qName, bool links) const
+{
+	return length(id(code), id(pName), id(qName), links);
 }
 
-double GeometryTable::length(std::string code, std::string pName,
-                             std::string qName, bool links) 
+double GeometryTable::length(int code, int p, int q, bool links) const
 {
 	if (_codes.count(code))
 	{
-		const GeometryMap &map = _codes.at(code);
-
 		if (!links)
 		{
-			double l = length(map, pName, qName);
+			double l = mean(_lengths, GeometryKey(code, p, q));
 
 			if (l >= 0)
 			{
@@ -218,156 +399,116 @@ double GeometryTable::length(std::string code, std::string pName,
 		}
 		else
 		{
-			double l = checkLengthLinks(code, pName, qName);
+			double l = checkLengthLinks(code, p, q);
 			return l;
 		}
 	}
 
-	if (_codes.count(".") == 0)
+	if (_codes.count(_all) == 0)
 	{
 		return -1;
 	}
 
 	double l = -1;
 	if (_filterPeptides && 
-	    (!(pName == "N" && qName == "C") && 
-	     !(pName == "C" && qName == "N")))
+	    (!(p == _n && q == _c) && !(p == _c && q == _n)))
 	{
-		l = length(_codes.at("."), pName, qName);
+		l = mean(_lengths, GeometryKey(_all, p, q));
 	}
 	return l;
 }
 
-double GeometryTable::length_stdev(std::string code, std::string pName,
-                                   std::string qName)
+double GeometryTable::length_stdev(const std::string &code, 
+                                   const std::string &pName,
+                                   const std::string &qName) const
 {
-	GeometryMap &map = _codes[code];
-
-	AtomPair pair = {pName, qName};
-	Value &v = map.lengths[pair];
-
-	return v.stdev;
+	GeometryKey key(id(code), id(pName), id(qName));
+	return stdev(_lengths, key, 0);
 }
 
-bool GeometryTable::angleExists(std::string code, std::string pName,
-                                std::string qName, std::string rName)
+bool GeometryTable::angleExists(const std::string &code, 
+                                const std::string &pName,
+                                const std::string &qName, 
+                                const std::string &rName) const
 {
 	return angle(code, pName, qName, rName) >= 0;
 }
 
-double GeometryTable::angle(const GeometryMap &map, std::string pName,
-                            std::string qName, std::string rName) const
+double GeometryTable::angle(const std::string &code, const std::string &pName,
+                            const std::string &qName, const std::string &rName,
+                            bool links) const
 {
-	AtomTriplet trio = {pName, qName, rName};
-	if (map.angles.count(trio) == 0)
-	{
-		return -1;
-	}
-
-	const Value &v = map.angles.at(trio);
-
-	return v.mean;
+	return angle(id(code), id(pName), id(qName), id(rName), links);
 }
 
-double GeometryTable::angle(std::string code, std::string pName,
-                            std::string qName, std::string rName,
-                            bool links)
+double GeometryTable::angle(int code, int p, int q, int r, bool links) const
 {
-	AtomTriplet trio = {pName, qName, rName};
-
 	if (!links)
 	{
-		double a = angle(_codes[code], pName, qName, rName);
+		double a = mean(_angles, GeometryKey(code, p, q, r));
 
 		if (a < 0)
 		{
-			a = angle(_codes["."], pName, qName, rName);
+			a = mean(_angles, GeometryKey(_all, p, q, r));
 		}
 		
 		return a;
 	}
 	else
 	{
-		return checkAngleLinks(code, pName, qName, rName);
+		return checkAngleLinks(code, p, q, r);
 	}
 }
 
-double GeometryTable::angle_stdev(std::string code, std::string pName,
-                                  std::string qName, std::string rName)
+double GeometryTable::angle_stdev(const std::string &code, 
+                                  const std::string &pName, 
+                                  const std::string &qName, 
+                                  const std::string &rName) const
 {
-	GeometryMap &map = _codes[code];
-
-	AtomTriplet trio = {pName, qName, rName};
-	if (map.angles.count(trio) == 0)
-	{
-		return -1;
-	}
-
-	Value &v = map.angles[trio];
-
-	return v.stdev;
+	GeometryKey key(id(code), id(pName), id(qName), id(rName));
+	return stdev(_angles, key);
 }
 
-
-bool GeometryTable::torsionExists(std::string code, std::string pName,
-                                  std::string qName, std::string rName,
-                                  std::string sName)
+bool GeometryTable::torsionExists(const std::string &code, 
+                                  const std::string &pName,
+                                  const std::string &qName, 
+                                  const std::string &rName,
+                                  const std::string &sName) const
 {
-	GeometryMap &map = _codes[code];
-	
-	AtomQuartet quartet = {pName, qName, rName, sName};
-	return (map.torsions.count(quartet) > 0);
+	GeometryKey key(id(code), id(pName), id(qName), id(rName), id(sName));
+	return (_torsions.find(key) != nullptr);
 }
 
-double GeometryTable::torsion(std::string code, std::string pName,
-                              std::string qName, std::string rName,
-                              std::string sName)
+double GeometryTable::torsion(const std::string &code, 
+                              const std::string &pName,
+                              const std::string &qName, 
+                              const std::string &rName,
+                              const std::string &sName) const
 {
-	GeometryMap &map = _codes[code];
-
-	AtomQuartet quartet = {pName, qName, rName, sName};
-	if (map.torsions.count(quartet) == 0)
-	{
-		return -1;
-	}
-
-	Value &v = map.torsions[quartet];
-
-	return v.mean;
+	GeometryKey key(id(code), id(pName), id(qName), id(rName), id(sName));
+	return mean(_torsions, key);
 }
 
-double GeometryTable::torsion_stdev(std::string code, std::string pName,
-                                    std::string qName, std::string rName,
-                                    std::string sName)
+double GeometryTable::torsion_stdev(const std::string &code, 
+                                    const std::string &pName,
+                                    const std::string &qName, 
+                                    const std::string &rName,
+                                    const std::string &sName) const
 {
-	GeometryMap &map = _codes[code];
-
-	AtomQuartet quartet = {pName, qName, rName, sName};
-	if (map.torsions.count(quartet) == 0)
-	{
-		return -1;
-	}
-
-	Value &v = map.torsions[quartet];
-
-	return v.stdev;
+	GeometryKey key(id(code), id(pName), id(qName), id(rName), id(sName));
+	return stdev(_torsions, key);
 }
 
-int GeometryTable::chirality(std::string code, std::string centre,
-                             std::string pName, std::string qName, 
-                             std::string rName)
+int GeometryTable::chirality(const std::string &code, 
+                             const std::string &centre,
+                             const std::string &pName, 
+                             const std::string &qName, 
+                             const std::string &rName) const
 {
-	GeometryMap &map = _codes[code];
-
-	AtomQuartet quartet = {centre, pName, qName, rName};
-	if (map.chirals.count(quartet) == 0)
-	{
-		return 0;
-	}
-
-	int &v = map.chirals[quartet];
+	GeometryKey key(id(code), id(centre), id(pName), id(qName), id(rName));
+	const int *v = _chirals.find(key);
 
-	return v;
+	return (v == nullptr ? 0 : *v);
 }
 
 const size_t GeometryTable::codeEntries() const
@@ -375,64 +516,19 @@ const size_t GeometryTable::codeEntries() const
 	return _codes.size();
 }
 
-bool GeometryTable::linkCodeMatches(std::string code, std::string query) const
+double GeometryTable::checkAngleLinks(int code, int p, int q, int r) const
 {
-	if (query == ".")
-	{
-		return true;
-	}
-	else if (query.rfind("NOT", 0) != std::string::npos)
-	{
-		std::vector<std::string> opts = split(query, ' ');
-
-		bool ok = true;
-		for (size_t i = 1; i < opts.size(); i++)
-		{
-			if (code == opts[i])
-			{
-				ok = false;
-				break;
-			}
-		}
-
-		if (ok)
-		{
-			return ok;
-		}
-	}
-	else /* does not start with NOT */
-	{
-		std::vector<std::string> opts = split(query, ' ');
-
-		for (size_t i = 0; i < opts.size(); i++)
-		{
-			if (code == opts[i])
-			{
-				return true;
-			}
-		}
-	}
-
-	return false;
-}
-
-double GeometryTable::checkAngleLinks(std::string code, std::string pName,
-                                      std::string qName, std::string rName) const
-{
-	std::map<std::string, GeometryMap>::const_iterator it;
+	std::map<std::string, LinkRule>::const_iterator it;
 	
 	for (it = _links.cbegin(); it != _links.cend(); it++)
 	{
-		std::string q = it->first;
-		bool match = linkCodeMatches(code, q);
-		
-		if (!match)
+		const LinkRule &rule = it->second;
+		if (!linkMatches(rule, code))
 		{
 			continue;
 		}
 		
-		const GeometryMap &map = it->second;
-		double a = angle(map, pName, qName, rName);
+		double a = mean(_linkAngles, GeometryKey(rule.map, p, q, r));
 
 		if (a >= 0)
 		{
@@ -443,23 +539,19 @@ double GeometryTable::checkAngleLinks(std::string code, std::string pName,
 	return -1;
 }
 
-double GeometryTable::checkLengthLinks(std::string code, std::string pName,
-                                      std::string qName) const
+double GeometryTable::checkLengthLinks(int code, int p, int q) const
 {
-	std::map<std::string, GeometryMap>::const_iterator it;
+	std::map<std::string, LinkRule>::const_iterator it;
 	
 	for (it = _links.cbegin(); it != _links.cend(); it++)
 	{
-		std::string q = it->first;
-		bool match = linkCodeMatches(code, q);
-		
-		if (!match)
+		const LinkRule &rule = it->second;
+		if (!linkMatches(rule, code))
 		{
 			continue;
 		}
 		
-		const GeometryMap &map = it->second;
-		double l = length(map, pName, qName);
+		double l = mean(_linkLengths, GeometryKey(rule.map, p, q));
 
 		if (l >= 0)
 		{
@@ -472,18 +564,15 @@ double GeometryTable::checkLengthLinks(std::string code, std::string pName,
 
 std::set<std::string> GeometryTable::allAtomNames(std::string &code)
 {
-	std::set<std::string> atoms;
-	
-	const GeometryMap &map = _codes[code];
-	
-	for (auto it = map.lengths.begin(); it != map.lengths.end(); it++)
+	std::map<int, std::set<std::string> >::const_iterator it;
+	it = _atomNames.find(id(code));
+
+	if (it == _atomNames.end())
 	{
-		const AtomPair &ap = it->first;
-		atoms.insert(ap.p);
-		atoms.insert(ap.q);
+		return std::set<std::string>();
 	}
 	
-	return atoms;
+	return it->second;
 }
 
 AtomGroup *GeometryTable::constructResidue(std::string code, 
@@ -24,10 +24,19 @@
 #include <mutex>
 #include <set>
 #include <map>
+#include <unordered_map>
+#include "GeometryHash.h"
 
 struct ResidueId;
 class AtomGroup;
 
+/** \class GeometryTable
+ *  dictionary of standard bond lengths, angles, torsions and chiralities by
+ *  residue code and atom names. Codes and names are interned to small
+ *  integer ids as geometry is added, and restraints are stored in hash
+ *  tables keyed on these ids. Lookups by id() avoid hashing strings; the
+ *  string versions convert and call these. */
+
 class GeometryTable
 {
 public:
@@ -40,46 +49,60 @@ public:
 	
 	static GeometryTable &getAllGeometry();
 
-	void addGeometryLength(std::string code, std::string pName,
-	                       std::string qName, double mean, double stdev, 
-	                       bool link = false);
+	void addGeometryLength(const std::string &code, const std::string &pName,
+	                       const std::string &qName, double mean, 
+	                       double stdev, bool link = false);
 
-	void addGeometryAngle(std::string code, std::string pName, 
-	                      std::string qName, std::string rName, 
+	void addGeometryAngle(const std::string &code, const std::string &pName, 
+	                      const std::string &qName, const std::string &rName, 
 	                      double mean, double stdev, bool link = false);
 
-	void addGeometryTorsion(std::string code, std::string pName, 
-	                        std::string qName, std::string rName, 
-	                        std::string sName, double mean, 
+	void addGeometryTorsion(const std::string &code, const std::string &pName, 
+	                        const std::string &qName, const std::string &rName, 
+	                        const std::string &sName, double mean, 
 	                        double stdev, int period);
 
-	void addGeometryChiral(std::string code, std::string centre,
-	                        std::string pName, std::string qName, 
-	                       std::string rName, int sign);
-
-	bool lengthExists(std::string code, std::string pName, std::string qName);
-
-	double length(std::string code, std::string pName, std::string qName, 
-	              bool links = false);
-
-	double length_stdev(std::string code, std::string pName, std::string qName);
-
-	bool angleExists(std::string code, std::string pName, std::string qName,
-	                 std::string rName);
-	double angle(std::string code, std::string pName, std::string qName,
-	                 std::string rName, bool links = false);
-	double angle_stdev(std::string code, std::string pName, std::string qName,
-	                 std::string rName);
-
-	bool torsionExists(std::string code, std::string pName, std::string qName,
-	                   std::string rName, std::string sName);
-	double torsion(std::string code, std::string pName, std::string qName,
-	               std::string rName, std::string sName);
-	double torsion_stdev(std::string code, std::string pName, std::string qName,
-	                     std::string rName, std::string sName);
-
-	int chirality(std::string code, std::string centre, std::string pName,
-	              std::string qName, std::string rName);
+	void addGeometryChiral(const std::string &code, const std::string &centre,
+	                       const std::string &pName, const std::string &qName, 
+	                       const std::string &rName, int sign);
+
+	/** interned id of a residue code or atom name, or -1 if the table has
+	 *  never been given it, in which case no lookup will find it either */
+	int id(const std::string &name) const;
+
+	bool lengthExists(const std::string &code, const std::string &pName, 
+	                  const std::string &qName) const;
+
+	double length(const std::string &code, const std::string &pName, 
+	              const std::string &qName, bool links = false) const;
+	double length(int code, int p, int q, bool links = false) const;
+
+	double length_stdev(const std::string &code, const std::string &pName, 
+	                    const std::string &qName) const;
+
+	bool angleExists(const std::string &code, const std::string &pName, 
+	                 const std::string &qName, const std::string &rName) const;
+	double angle(const std::string &code, const std::string &pName, 
+	             const std::string &qName, const std::string &rName, 
+	             bool links = false) const;
+	double angle(int code, int p, int q, int r, bool links = false) const;
+	double angle_stdev(const std::string &code, const std::string &pName, 
+	                   const std::string &qName, 
+	                   const std::string &rName) const;
+
+	bool torsionExists(const std::string &code, const std::string &pName, 
+	                   const std::string &qName, const std::string &rName, 
+	                   const std::string &sName) const;
+	double torsion(const std::string &code, const std::string &pName, 
+	               const std::string &qName, const std::string &rName, 
+	               const std::string &sName) const;
+	double torsion_stdev(const std::string &code, const std::string &pName, 
+	                     const std::string &qName, const std::string &rName, 
+	                     const std::string &sName) const;
+
+	int chirality(const std::string &code, const std::string &centre, 
+	              const std::string &pName, const std::string &qName, 
+	              const std::string &rName) const;
 
 	void filterPeptides(bool filter)
 	{
@@ -92,115 +115,62 @@ public:
 	                            int *atomNum, int terminal = 0);
 private:
 	void loadExtraGeometries(std::set<std::string> &files);
+	void absorb(const GeometryTable &other);
+
 	struct Value
 	{
 		double mean;
 		double stdev;
 	};
 
-	struct AtomPair
+	/* which residue codes a link group applies to */
+	struct LinkRule
 	{
-		std::string p;
-		std::string q;
-		
-		bool operator<(const AtomPair &b) const
-		{
-			if (this->p == b.p)
-			{
-				return this->q < b.q;
-			}
-			else
-			{
-				return this->p < b.p;
-			}
-		}
+		int map;
+		bool any;
+		bool negate;
+		std::vector<int> codes;
 	};
 
-	struct AtomTriplet
-	{
-		std::string p;
-		std::string q;
-		std::string r;
-		
-		bool operator<(const AtomTriplet &b) const
-		{
-			if (this->p == b.p)
-			{
-				if (this->q == b.q)
-				{
-					return this->r < b.r;
-				}
-				else
-				{
-					return this->q < b.q;
-				}
-			}
-			else
-			{
-				return this->p < b.p;
-			}
-		}
-	};
-
-	struct AtomQuartet
-	{
-		std::string p;
-		std::string q;
-		std::string r;
-		std::string s;
-		
-		bool operator<(const AtomQuartet &b) const
-		{
-			if (this->p == b.p)
-			{
-				if (this->q == b.q)
-				{
-					if (this->r == b.r)
-					{
-						return this->s < b.s;
-					}
-					else
-					{
-						return this->r < b.r;
-					}
-				}
-				else
-				{
-					return this->q < b.q;
-				}
-			}
-			else
-			{
-				return this->p < b.p;
-			}
-		}
-	};
+	int intern(const std::string &name);
+	int addCode(const std::string &code);
+	void addLinkRule(const std::string &link);
+	bool linkMatches(const LinkRule &rule, int code) const;
 
-	struct GeometryMap
-	{
-		std::map<AtomPair, Value> lengths;
-		std::map<AtomTriplet, Value> angles;
-		std::map<AtomQuartet, Value> torsions;
-		std::map<AtomQuartet, int> chirals;
-	};
+	template <class V>
+	void absorbHash(GeometryHash<V> &mine, const GeometryHash<V> &theirs,
+	                const std::vector<int> &ids);
 
 	std::set<std::string> allAtomNames(std::string &code);
 
-	double length(const GeometryMap &map, std::string pName, 
-	              std::string qName) const;
-
-	double checkLengthLinks(std::string code, std::string pName,
-	                        std::string qName) const;
-
-	double checkAngleLinks(std::string code, std::string pName,
-	                       std::string qName, std::string rName) const;
+	double checkLengthLinks(int code, int p, int q) const;
+	double checkAngleLinks(int code, int p, int q, int r) const;
 
-	bool linkCodeMatches(std::string code, std::string query) const;
-	double angle(const GeometryMap &map, std::string pName,
-	             std::string qName, std::string rName) const;
+	double mean(const GeometryHash<Value> &hash, const GeometryKey &key, 
+	            double missing = -1) const;
+	double stdev(const GeometryHash<Value> &hash, const GeometryKey &key,
+	             double missing = -1) const;
 	
-	std::map<std::string, GeometryMap> _codes;
-	std::map<std::string, GeometryMap> _links;
+	std::unordered_map<std::string, int> _ids;
+	std::vector<std::string> _names;
+
+	/* ids of residue codes with any geometry, including "." for all */
+	std::set<int> _codes;
+	std::map<int, std::set<std::string> > _atomNames;
+
+	/* in order of link group name, as the first matching group is used */
+	std::map<std::string, LinkRule> _links;
+
+	GeometryHash<Value> _lengths;
+	GeometryHash<Value> _angles;
+	GeometryHash<Value> _torsions;
+	GeometryHash<int> _chirals;
+	GeometryHash<Value> _linkLengths;
+	GeometryHash<Value> _linkAngles;
+
+	int _all = -1;
+	int _n = -1;
+	int _c = -1;
 	
 	static GeometryTable _loadedGeometry;
 	std::set<std::string> _loadedFiles;
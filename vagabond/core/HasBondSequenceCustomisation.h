@@ -48,6 +48,24 @@ public:
 		_skipSections = skipSections;
 	}
 
+	/** set whether BondSequences calculate all samples at once from 
+	 *  packed copies of their blocks, where possible. This takes priority
+	 *  over skipping unchanged blocks for more than one sample without
+	 *  ring programs. Ignored after setup() is called. */
+	void setPackBlocks(bool pack)
+	{
+		_packBlocks = pack;
+	}
+
+	/** set whether BondSequences only recalculate blocks downstream of
+	 *  torsions which changed since the previous job, where possible.
+	 *  Packed blocks are used instead if they are available, so turn off
+	 *  setPackBlocks() to skip blocks for many samples. */
+	void setSkipUnchanged(bool skip)
+	{
+		_skipUnchanged = skip;
+	}
+
 	/** set whether BondSequences should include hydrogen atoms.
 	 *  Ignored after setup() is called. */
 	void setIgnoreHydrogens(bool ignore)
@@ -62,6 +80,11 @@ public:
 		_maxThreads = max;
 	}
 	
+	const size_t &maxSimultaneousThreads() const
+	{
+		return _maxThreads;
+	}
+	
 	void setThreads(size_t threads)
 	{
 		_threads = threads;
@@ -81,6 +104,8 @@ public:
 	{
 		other->_ignoreHydrogens = _ignoreHydrogens;
 		other->_skipSections = _skipSections;
+		other->_packBlocks = _packBlocks;
+		other->_skipUnchanged = _skipUnchanged;
 		other->_totalSamples = _totalSamples;
 		other->_inSequence = _inSequence;
 		other->_maxThreads = _maxThreads;
@@ -107,6 +132,8 @@ public:
 protected:
 	bool _ignoreHydrogens = false;
 	bool _skipSections = false;
+	bool _packBlocks = true;
+	bool _skipUnchanged = true;
 	bool _inSequence = false;
 	bool _superpose = true;
 	size_t _loopCount = 1;
@@ -26,6 +26,7 @@
 #include "Environment.h"
 #include "ModelManager.h"
 #include "EntityManager.h"
+#include <algorithm>
 
 Instance::Instance()
 {
@@ -34,38 +35,56 @@ Instance::Instance()
 
 void Instance::addToInterface(Instance *other, Interface *face, 
                               double max, bool derived)
+{
+	findContacts(other, face, max, derived);
+	unload();
+}
+
+void Instance::findContacts(Instance *other, Interface *face, 
+                            double max, bool derived)
 {
 	AtomGroup *left = other->currentAtoms();
 	AtomGroup *right = currentAtoms();
+	
+	const AtomVector &rights = right->atomVector();
+	std::vector<glm::vec3> positions(rights.size());
+
+	for (size_t i = 0; i < rights.size(); i++)
+	{
+		Atom *r = rights[i];
+		positions[i] = derived ? r->derivedPosition() : r->initialPosition();
+	}
+	
+	if (_sheet.cellSize() != max)
+	{
+		_sheet.setCellSize(max);
+	}
+
+	_sheet.updateSheet(rights, positions);
+	std::vector<int> near;
 
 	for (Atom *l : left->atomVector())
 	{
-		if (right->hasAtom(l))
+		glm::vec3 lv = derived ? l->derivedPosition() : l->initialPosition();
+		near = _sheet.atomsNear(lv, max);
+
+		if (near.size() == 0 || right->hasAtom(l))
 		{
 			continue;
 		}
+		
+		/* same order as a search through all of the right atoms */
+		std::sort(near.begin(), near.end());
 
-		glm::vec3 lv = derived ? l->derivedPosition() : l->initialPosition();
-
-		for (Atom *r : right->atomVector())
+		for (const int &j : near)
 		{
-			glm::vec3 rv = derived ? r->derivedPosition() : r->initialPosition();
-			glm::vec3 diff = rv - lv;
-
-			float length = glm::length(diff);
-			
-			if (length > max)
-			{
-				continue;
-			}
+			glm::vec3 diff = positions[j] - lv;
 			
-			Interaction ia(l, r);
-			ia.setValue(length);
+			Interaction ia(l, rights[j]);
+			ia.setValue(sqrt(glm::dot(diff, diff)));
 			face->addInteraction(ia);
 		}
 	}
-	
-	unload();
 }
 
 void Instance::load()
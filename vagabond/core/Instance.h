@@ -26,6 +26,7 @@
 #include "RopeTypes.h"
 #include "HasMetadata.h"
 #include "MetadataGroup.h"
+#include "engine/ContactSheet.h"
 #include <vagabond/utils/glm_json.h>
 #include <vagabond/c4x/Angular.h>
 #include <vagabond/c4x/Posular.h>
@@ -82,6 +83,13 @@ public:
 	void addToInterface(Instance *other, Interface *face, 
 	                    double max, bool derived);
 
+	/** as addToInterface() but leaves the model loaded, for searching
+	 *  several instances in a row. This instance's atoms are binned into
+	 *  a contact sheet, which is only rebuilt once they have moved further
+	 *  than its skin distance since the previous search */
+	void findContacts(Instance *other, Interface *face, 
+	                  double max, bool derived);
+
 	/* gets atoms from MY atoms corresponding to other's atom */
 	Atom *equivalentForAtom(Instance *other, Atom *atom);
 	virtual Atom *equivalentForAtom(Polymer *other, Atom *atom)
@@ -214,6 +222,8 @@ private:
 
 	bool _refined = false;
 	std::map<std::string, glm::mat4x4> _transforms;
+
+	ContactSheet _sheet;
 };
 
 #endif
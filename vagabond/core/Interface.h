@@ -19,7 +19,7 @@
 #ifndef __vagabond__Interface__
 #define __vagabond__Interface__
 
-#include <list>
+#include <vector>
 #include "Interaction.h"
 #include "Instance.h"
 
@@ -34,9 +34,14 @@ public:
 	void addInteraction(Interaction &ia);
 	std::string desc();
 	
+	size_t interactionCount() const
+	{
+		return _interactions.size();
+	}
+	
 	void loadModel();
 private:
-	std::list<Interaction> _interactions;
+	std::vector<Interaction> _interactions;
 
 	Instance *_left = nullptr;
 	Instance *_right = nullptr;
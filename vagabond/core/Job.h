@@ -31,6 +31,7 @@ class PositionSampler;
 class BondSequence;
 class MapTransfer;
 struct Result;
+struct Batch;
 
 enum SequenceState
 {
@@ -54,6 +55,7 @@ enum JobType
 	JobSolventSurfaceArea =      1 << 6,
 	JobSolventMask =      		 1 << 7,
 	JobPositionVector =          1 << 8,
+	JobDeviationGradient =       1 << 9,
 };
 
 struct CustomVector
@@ -144,9 +146,22 @@ struct Job
 
 	Result *result = nullptr;
 	
+	/* custom vectors point into memory owned elsewhere, e.g. a Batch */
+	bool borrowed = false;
+	
+	/* if set, the vectors of the batch from batch_start up to batch_end
+	 * are calculated in turn on the sequence which picks up this job */
+	Batch *batch = nullptr;
+	size_t batch_start = 0;
+	size_t batch_end = 0;
+	
 	void destroy()
 	{
-		custom.destroy_vectors();
+		if (!borrowed)
+		{
+			custom.destroy_vectors();
+		}
+
 		delete this;
 	}
 };
@@ -157,12 +172,17 @@ struct Result
 {
 	int ticket;
 	JobType requests;
-	AtomPosMap aps{};
+	FlatPositions flat{};
 	AtomPosList apl{};
-	double deviation;
-	double score;
-	double correlation;
-	float surface_area;
+
+	/* filled from flat positions by atomPosMap() */
+	AtomPosMap aps{};
+	double deviation = 0;
+	double score = 0;
+	double correlation = 0;
+	float surface_area = 0;
+	std::vector<float> gradient{};
+	std::unordered_map<Atom *, float> areas{};
 	AtomMap *map = nullptr;
 
 	std::mutex handout;
@@ -174,10 +194,23 @@ struct Result
 		job->result = this;
 	}
 	
+	/** per-atom map of positions for older consumers, converted from the
+	 *  flat positions on first use */
+	AtomPosMap &atomPosMap()
+	{
+		if (aps.size() == 0 && !flat.empty())
+		{
+			flat.toAtomPosMap(aps);
+		}
+
+		return aps;
+	}
+	
 	void transplantColours()
 	{
+		AtomPosMap &map = atomPosMap();
 		AtomPosMap::iterator it;
-		for (it = aps.begin(); it != aps.end(); it++)
+		for (it = map.begin(); it != map.end(); it++)
 		{
 			it->first->setAddedColour(it->second.colour);
 		}
@@ -192,25 +225,112 @@ struct Result
 				awp.atom->setDerivedPosition(awp.wp.ave);
 			}
 		}
-		else if (aps.size() > 0)
+		else if (!flat.empty())
 		{
-			AtomPosMap::iterator it;
-			for (it = aps.begin(); it != aps.end(); it++)
+			WithPos wp{};
+			for (size_t i = 0; i < flat.atomCount(); i++)
 			{
-				it->second.ave /= (float)it->second.samples.size();
-				it->first->setDerivedPositions(it->second);
+				size_t count = flat.withPos(i, wp);
+				if (count == 0)
+				{
+					continue;
+				}
+
+				wp.ave /= (float)count;
+				flat.index->atoms[i]->setDerivedPositions(wp);
 			}
 		}
 	}
 	
-	void destroy()
+	/** clear out calculations so the Result can be reused */
+	void reset()
 	{
+		flat.clear();
 		aps.clear();
 		apl.clear();
+		areas.clear();
+		gradient.clear();
 		delete map;
+		map = nullptr;
 
+		deviation = 0;
+		score = 0;
+		correlation = 0;
+		surface_area = 0;
+	}
+	
+	void destroy()
+	{
+		reset();
 		delete this;
 	}
 };
 
+/** \class Batch
+ *  set of parameter vectors sent through BondCalculator::submitBatch() 
+ *  together, and their results gathered by BondCalculator::retrieveBatch()
+ *  in matching order. If only deviations, gradients or position vectors
+ *  are requested, the batch is split into one chunk per BondSequence and
+ *  each chunk is calculated in a loop, with a single job and result for
+ *  the chunk. */
+
+struct Batch
+{
+	/** requests made for every vector in the batch */
+	JobType requests = JobNotSpecified;
+
+	/** number of parameter vectors */
+	size_t count = 0;
+
+	/** length of each parameter vector */
+	size_t size = 0;
+
+	/** count x size parameters, one vector after another */
+	std::vector<float> params;
+
+	/** optional Job::fraction for each vector */
+	std::vector<float> fractions;
+	
+	/** samples per vector, as for CustomInfo::allocate_vectors */
+	int samples = 0;
+
+	/** one entry per vector, filled on retrieval */
+	std::vector<double> deviations;
+	std::vector<double> scores;
+	std::vector<double> correlations;
+
+	/** for JobPositionVector, count x atoms positions, one block of atoms
+	 * per vector in the same order as Result::apl */
+	std::vector<glm::vec3> positions;
+	size_t atoms = 0;
+	
+	/** for JobDeviationGradient, one gradient per vector, left empty where
+	 *  none could be calculated */
+	std::vector<std::vector<float>> gradients;
+	
+	/** maps tickets of submitted jobs onto vector indices, or onto the
+	 *  first vector of each chunk if looped */
+	std::map<int, size_t> tickets;
+	
+	/** true if submitted as chunks, each calculated in a loop */
+	bool looped = false;
+
+	void allocate(size_t n, size_t s)
+	{
+		count = n;
+		size = s;
+		params.resize(n * s);
+	}
+	
+	float *vector(size_t i)
+	{
+		return &params[i * size];
+	}
+	
+	const glm::vec3 &position(size_t i, size_t atom) const
+	{
+		return positions[i * atoms + atom];
+	}
+};
+
 #endif
@@ -27,6 +27,13 @@
 #include "Atom.h"
 #include "programs/RingProgrammer.h"
 #include "GeometryTable.h"
+#include "engine/ContactSheet.h"
+#include <unordered_map>
+#include <algorithm>
+
+/* atoms further apart than this along any axis are never checked for a
+ * bond against the geometry table */
+#define BOND_CUTOFF (3.f)
 
 Knotter::Knotter(AtomGroup *group, GeometryTable *table) 
 : _programmers(*RingProgrammer::allProgrammers())
@@ -45,15 +52,17 @@ Knotter::~Knotter()
 
 }
 
-void Knotter::checkAtoms(Atom *atom, int start)
+void Knotter::checkAtoms(Atom *atom, const std::vector<Atom *> &others)
 {
-	AtomGroup &group = *_group;
 	glm::vec3 pos = atom->derivedPosition();
-	const float cutoff = 3;
+	bool water = (atom->code() == "HOH");
+
+	/* look up names once rather than for every neighbour */
+	int code = _table->id(atom->code());
+	int orig = _table->id(atom->atomName());
 
-	for (size_t i = start; i < group.size(); i++)
+	for (Atom *other : others)
 	{
-		Atom *other = group[i];
 		if (other == atom)
 		{
 			continue;
@@ -64,7 +73,7 @@ void Knotter::checkAtoms(Atom *atom, int start)
 		bool skip = false;
 		for (size_t j = 0; j < 3; j++)
 		{
-			if (fabs(diff[j]) > cutoff)
+			if (fabs(diff[j]) > BOND_CUTOFF)
 			{
 				skip = true;
 			}
@@ -75,20 +84,14 @@ void Knotter::checkAtoms(Atom *atom, int start)
 			continue;
 		}
 
-		std::string code = atom->code();
-		std::string other_code = other->code();
-
-		std::string orig = atom->atomName();
-		std::string compare = other->atomName();
-		
-		double standard = -1;
-		
-		if ((atom->code() == "HOH" && other->code() != "HOH") ||
-		    (atom->code() != "HOH" && other->code() == "HOH"))
+		if (water != (other->code() == "HOH"))
 		{
 			continue;
 		}
 
+		int compare = _table->id(other->atomName());
+		double standard = -1;
+
 		if (atom->residueId() == other->residueId()
 		    && atom->chain() == other->chain())
 		{
@@ -100,7 +103,8 @@ void Knotter::checkAtoms(Atom *atom, int start)
 
 			if (standard < 0)
 			{
-				standard = _table->length(other->code(), compare, orig, true);
+				int other_code = _table->id(other->code());
+				standard = _table->length(other_code, compare, orig, true);
 			}
 		}
 
@@ -206,12 +210,44 @@ void Knotter::createHyperValues(Atom *atom, RingProgrammer *programmer)
 void Knotter::findBondTorsions()
 {
 	AtomGroup &group = *_group;
+	
+	/* a torsion needs the central atom of each angle to be a terminal
+	 * atom of the other, so only angles centred on one of the first angle's
+	 * terminal atoms need to be checked */
+	typedef std::unordered_map<const Atom *, std::vector<int> > AngleMap;
+	AngleMap centred;
+	for (size_t i = 0; i < group.bondAngleCount(); i++)
+	{
+		centred[group.bondAngle(i)->atom(1)].push_back(i);
+	}
+
+	std::vector<int> candidates;
 
 	for (int i = 0; i < (int)group.bondAngleCount() - 1; i++)
 	{
 		BondAngle *first = group.bondAngle(i);
+		candidates.clear();
+
+		for (size_t k = 0; k < 3; k += 2)
+		{
+			AngleMap::const_iterator found = centred.find(first->atom(k));
+			if (found == centred.end())
+			{
+				continue;
+			}
+
+			const std::vector<int> &list = found->second;
+			std::vector<int>::const_iterator it;
+			it = std::upper_bound(list.begin(), list.end(), i);
+			candidates.insert(candidates.end(), it, list.end());
+		}
 		
-		for (int j = i + 1; j < (int)group.bondAngleCount(); j++)
+		/* keep the order of a search over all later angles */
+		std::sort(candidates.begin(), candidates.end());
+		candidates.erase(std::unique(candidates.begin(), candidates.end()),
+		                 candidates.end());
+		
+		for (const int &j : candidates)
 		{
 			BondAngle *second = group.bondAngle(j);
 			
@@ -262,10 +298,58 @@ void Knotter::findHyperValues()
 void Knotter::findBondLengths()
 {
 	AtomGroup &group = *_group;
+
+	/* atoms without positions never pass the distance check, and stay out
+	 * of the sheet */
+	std::vector<Atom *> atoms;
+	std::vector<glm::vec3> positions;
+	std::vector<int> order;
+
 	for (size_t i = 0; i < group.size(); i++)
 	{
-		Atom *atom = group[i];
-		checkAtoms(atom, i + 1);
+		glm::vec3 pos = group[i]->derivedPosition();
+		if (pos.x != pos.x || pos.y != pos.y || pos.z != pos.z)
+		{
+			continue;
+		}
+		
+		atoms.push_back(group[i]);
+		positions.push_back(pos);
+		order.push_back(i);
+	}
+
+	/* sphere around the box of the cutoff, with room for rounding */
+	const float radius = BOND_CUTOFF * sqrt(3.f) + 0.01;
+	ContactSheet sheet;
+	sheet.setCellSize(radius);
+	sheet.updateSheet(atoms, positions);
+
+	std::vector<int> later;
+	std::vector<Atom *> others;
+
+	for (size_t n = 0; n < atoms.size(); n++)
+	{
+		const std::vector<int> &near = sheet.atomsNear(positions[n], radius);
+		later.clear();
+
+		for (const int &k : near)
+		{
+			if (order[k] > order[n])
+			{
+				later.push_back(order[k]);
+			}
+		}
+
+		/* same order as a search over the rest of the group */
+		std::sort(later.begin(), later.end());
+
+		others.clear();
+		for (const int &j : later)
+		{
+			others.push_back(group[j]);
+		}
+
+		checkAtoms(atoms[n], others);
 	}
 }
 
@@ -69,7 +69,7 @@ private:
 	void createBondAngles(Atom *atom);
 	void createBondTorsion(BondAngle *first, BondAngle *second);
 	void checkAtomChirality(Atom *atom, bool use_dictionary);
-	void checkAtoms(Atom *atom, int start);
+	void checkAtoms(Atom *atom, const std::vector<Atom *> &others);
 	void createHyperValues(Atom *atom, RingProgrammer *programmer);
 
 	AtomGroup *_group;
@@ -0,0 +1,269 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Please email: vagabond @ hginn.co.uk for more details.
+
+#include "LBFGSEngine.h"
+#include <cmath>
+
+/* sufficient decrease required of each line search step */
+#define ARMIJO 1e-4
+
+/* central difference step, as a fraction of the engine step size */
+#define DIFFERENCE_STEP 1e-2
+
+static float dot(const std::vector<float> &a, const std::vector<float> &b)
+{
+	double sum = 0;
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		sum += a[i] * b[i];
+	}
+
+	return sum;
+}
+
+LBFGSEngine::LBFGSEngine(RunsEngine *ref) : Engine(ref)
+{
+	setGradientsWanted(true);
+}
+
+LBFGSEngine::~LBFGSEngine()
+{
+	setGradientsWanted(false);
+}
+
+bool LBFGSEngine::differences(const Vec &x, Vec &grad)
+{
+	float h = _step * DIFFERENCE_STEP;
+	std::vector<int> tickets(2 * n());
+
+	for (size_t i = 0; i < n(); i++)
+	{
+		Vec probe = x;
+		probe[i] = x[i] + h;
+		tickets[2 * i] = sendJob(probe);
+		probe[i] = x[i] - h;
+		tickets[2 * i + 1] = sendJob(probe);
+	}
+
+	getResults();
+	_runs += 2 * n();
+	grad.resize(n());
+
+	for (size_t i = 0; i < n(); i++)
+	{
+		const int &plus = tickets[2 * i];
+		const int &minus = tickets[2 * i + 1];
+
+		if (!_scores[plus].received || !_scores[minus].received)
+		{
+			return false;
+		}
+
+		grad[i] = (_scores[plus].score - _scores[minus].score) / (2 * h);
+	}
+
+	return true;
+}
+
+bool LBFGSEngine::evaluate(const Vec &x, float *score, Vec *grad)
+{
+	clearResults();
+
+	int ticket = sendJob(x);
+	getResults();
+	_runs++;
+
+	if (!_scores[ticket].received)
+	{
+		return false;
+	}
+
+	*score = _scores[ticket].score;
+	if (*score != *score)
+	{
+		return false;
+	}
+
+	if (grad == nullptr)
+	{
+		return true;
+	}
+
+	/* gradients may not have been produced for this job after all */
+	if (gradientsAvailable() && gradientForTicket(ticket, *grad) && 
+	    grad->size() == n())
+	{
+		return true;
+	}
+
+	return differences(x, *grad);
+}
+
+/* two-loop recursion, returns -H.grad for the remembered corrections */
+void LBFGSEngine::searchDirection(const Vec &grad, Vec &dir)
+{
+	dir = grad;
+	std::vector<float> alphas(_corrections.size());
+
+	for (int i = (int)_corrections.size() - 1; i >= 0; i--)
+	{
+		const Correction &c = _corrections[i];
+		alphas[i] = c.rho * dot(c.s, dir);
+
+		for (size_t j = 0; j < dir.size(); j++)
+		{
+			dir[j] -= alphas[i] * c.y[j];
+		}
+	}
+
+	if (_corrections.size())
+	{
+		const Correction &last = _corrections.back();
+		float gamma = dot(last.s, last.y) / dot(last.y, last.y);
+
+		for (float &d : dir)
+		{
+			d *= gamma;
+		}
+	}
+
+	for (size_t i = 0; i < _corrections.size(); i++)
+	{
+		const Correction &c = _corrections[i];
+		float beta = c.rho * dot(c.y, dir);
+
+		for (size_t j = 0; j < dir.size(); j++)
+		{
+			dir[j] += (alphas[i] - beta) * c.s[j];
+		}
+	}
+
+	for (float &d : dir)
+	{
+		d = -d;
+	}
+}
+
+void LBFGSEngine::remember(const Vec &s, const Vec &y)
+{
+	float sy = dot(s, y);
+
+	/* curvature condition, otherwise the update is not positive definite */
+	if (sy <= 1e-10)
+	{
+		return;
+	}
+
+	Correction c{s, y, 1 / sy};
+	_corrections.push_back(c);
+
+	while (_corrections.size() > _memory)
+	{
+		_corrections.pop_front();
+	}
+}
+
+void LBFGSEngine::run()
+{
+	_runs = 0;
+	_corrections.clear();
+
+	Vec x = bestResult();
+	Vec g, dir;
+	float f = FLT_MAX;
+
+	if (!evaluate(x, &f, &g))
+	{
+		return;
+	}
+
+	while (_runs < _maxRuns)
+	{
+		searchDirection(g, dir);
+		float slope = dot(g, dir);
+
+		if (slope >= 0)
+		{
+			/* lost positive definiteness, restart from steepest descent */
+			_corrections.clear();
+			searchDirection(g, dir);
+			slope = dot(g, dir);
+		}
+
+		float length = sqrt(dot(dir, dir));
+		if (length <= 0 || slope >= 0)
+		{
+			break;
+		}
+
+		float alpha = 1;
+		if (_corrections.size() == 0)
+		{
+			alpha = _step / length;
+		}
+
+		bool accepted = false;
+		Vec trial(n());
+		float ft = FLT_MAX;
+
+		while (_runs < _maxRuns && alpha * length > _step * 1e-4)
+		{
+			for (size_t i = 0; i < n(); i++)
+			{
+				trial[i] = x[i] + alpha * dir[i];
+			}
+
+			/* finite differences are only worth sending for an accepted
+			 * point, analytic gradients come with the score */
+			bool analytic = gradientsAvailable();
+			Vec old = g;
+			bool ok = evaluate(trial, &ft, analytic ? &g : nullptr);
+
+			if (ok && ft <= f + ARMIJO * alpha * slope)
+			{
+				accepted = (analytic || differences(trial, g));
+			}
+
+			if (accepted)
+			{
+				Vec s(n()), y(n());
+				for (size_t i = 0; i < n(); i++)
+				{
+					s[i] = trial[i] - x[i];
+					y[i] = g[i] - old[i];
+				}
+
+				remember(s, y);
+				break;
+			}
+
+			g = old;
+			alpha /= 2;
+		}
+
+		if (!accepted)
+		{
+			break;
+		}
+
+		x = trial;
+		f = ft;
+	}
+
+	setCurrent(x);
+}
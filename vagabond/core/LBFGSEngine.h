@@ -0,0 +1,64 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Please email: vagabond @ hginn.co.uk for more details.
+
+#ifndef __vagabond__LBFGSEngine__
+#define __vagabond__LBFGSEngine__
+
+#include <deque>
+#include "Engine.h"
+
+/** \class LBFGSEngine
+ *  limited-memory BFGS minimiser with a backtracking line search. Uses the
+ *  gradients supplied by the RunsEngine if it returnsGradients(), otherwise
+ *  estimates them by central differences, sending two jobs per parameter
+ *  at once. The first step is scaled to the engine's step size. */
+
+class LBFGSEngine : public Engine
+{
+public:
+	LBFGSEngine(RunsEngine *ref);
+	virtual ~LBFGSEngine();
+
+	virtual void run();
+
+	/** number of previous steps used to approximate the inverse Hessian */
+	void setMemory(int memory)
+	{
+		_memory = memory;
+	}
+private:
+	typedef std::vector<float> Vec;
+
+	bool evaluate(const Vec &x, float *score, Vec *grad);
+	bool differences(const Vec &x, Vec &grad);
+	void searchDirection(const Vec &grad, Vec &dir);
+	void remember(const Vec &s, const Vec &y);
+
+	struct Correction
+	{
+		Vec s;
+		Vec y;
+		float rho;
+	};
+
+	std::deque<Correction> _corrections;
+	int _memory = 6;
+	int _runs = 0;
+};
+
+#endif
@@ -23,11 +23,15 @@
 #include "Polymer.h"
 #include "Chain.h"
 #include "File.h"
+#include "AtomSnapshot.h"
 #include "AtomContent.h"
 #include "Environment.h"
 #include "EntityManager.h"
 #include "SequenceComparison.h"
 #include "../utils/FileReader.h"
+#include "Interface.h"
+#include <atomic>
+#include <thread>
 
 Model::Model()
 {
@@ -127,6 +131,37 @@ void Model::write(std::string filename)
 	{
 		_currentFile->write(filename);
 	}
+	else if (_currentAtoms)
+	{
+		writeFromSource(filename);
+	}
+}
+
+void Model::writeFromSource(std::string filename)
+{
+	/* loaded from a snapshot, so reopen the original file to keep everything
+	 * other than the atom positions as it was */
+	File *file = File::openUnknown(_filename);
+	file->setAutomaticKnot(File::KnotNone);
+	file->parse();
+	AtomContent *source = file->atoms();
+
+	for (size_t i = 0; i < source->size(); i++)
+	{
+		Atom *a = (*source)[i];
+		Atom *current = _currentAtoms->atomByIdName(a->residueId(), 
+		                                            a->atomName(), a->chain());
+
+		if (current != nullptr)
+		{
+			a->setDerivedPosition(current->derivedPosition());
+		}
+	}
+
+	file->write(filename);
+
+	delete file;
+	delete source;
 }
 
 void Model::reload()
@@ -516,10 +551,73 @@ void Model::housekeeping()
 
 void Model::findInteractions()
 {
-	if (_ligands.size() > 0 && _polymers.size() > 0)
+	_interfaces.clear();
+
+	if (_ligands.size() == 0 || _polymers.size() == 0)
 	{
-		_ligands.front().interfaceWithOther(&_polymers.front());
+		return;
+	}
+
+	load();
+
+	/* atom subsets are made before any threads can ask for them */
+	std::vector<Ligand *> ligands;
+	for (Ligand &l : _ligands)
+	{
+		l.currentAtoms();
+		ligands.push_back(&l);
 	}
+
+	for (Polymer &p : _polymers)
+	{
+		p.currentAtoms();
+	}
+
+	/* each ligand's contact sheet is used by one thread only, and shared
+	 * between all the polymers */
+	std::vector<std::vector<Interface> > faces(ligands.size());
+	std::atomic<size_t> next{0};
+
+	auto work = [this, &ligands, &faces, &next]()
+	{
+		size_t i;
+		while ((i = next++) < ligands.size())
+		{
+			for (Polymer &p : _polymers)
+			{
+				Interface face(&p, ligands[i]);
+				ligands[i]->findContacts(&p, &face, 4, false);
+
+				if (face.interactionCount() > 0)
+				{
+					faces[i].push_back(face);
+				}
+			}
+		}
+	};
+
+	size_t threads = std::max(1u, std::thread::hardware_concurrency());
+	threads = std::min(threads, ligands.size());
+
+	std::vector<std::thread> workers;
+	for (size_t t = 1; t < threads; t++)
+	{
+		workers.push_back(std::thread(work));
+	}
+
+	work();
+
+	for (std::thread &w : workers)
+	{
+		w.join();
+	}
+
+	for (std::vector<Interface> &list : faces)
+	{
+		_interfaces.insert(_interfaces.end(), list.begin(), list.end());
+	}
+	
+	unload();
 }
 
 void Model::insertTorsions()
@@ -556,19 +654,31 @@ void Model::load(LoadOptions opts)
 		return;
 	}
 
-	_currentFile = File::openUnknown(_filename);
+	File::KnotLevel level = File::KnotTorsions;
 	
 	if (opts == NoGeometry)
 	{
-		_currentFile->setAutomaticKnot(File::KnotNone);
+		level = File::KnotNone;
 	}
 	else if (opts == NoAngles)
 	{
-		_currentFile->setAutomaticKnot(File::KnotLengths);
+		level = File::KnotLengths;
+	}
+
+	/* models are loaded and unloaded often, so keep the knotted atoms
+	 * rather than parsing the same file again each time */
+	AtomSnapshot snapshot(_filename, level);
+	_currentAtoms = snapshot.load();
+
+	if (_currentAtoms == nullptr)
+	{
+		_currentFile = File::openUnknown(_filename);
+		_currentFile->setAutomaticKnot(level);
+		_currentFile->parse();
+		_currentAtoms = _currentFile->atoms();
+		snapshot.save(_currentAtoms);
 	}
 
-	_currentFile->parse();
-	_currentAtoms = _currentFile->atoms();
 	_currentAtoms->setResponder(this);
 	
 	if (opts == Everything)
@@ -29,6 +29,7 @@
 
 #include "Polymer.h"
 #include "Ligand.h"
+#include "Interface.h"
 #include "Responder.h"
 #include "AtomGroup.h"
 #include "AtomRecall.h"
@@ -158,7 +159,17 @@ public:
 	virtual const Metadata::KeyValues metadata() const;
 	
 	void clickTicker();
+
+	/** finds contacts between every ligand and every polymer, keeping
+	 *  those interfaces which have any interactions */
 	void findInteractions();
+	
+	/** @returns interfaces found by the last call to findInteractions() */
+	const std::vector<Interface> &interfaces() const
+	{
+		return _interfaces;
+	}
+
 	void finishedRefinement();
 	void write(std::string filename);
 	
@@ -184,6 +195,8 @@ private:
 
 	void extractTorsions();
 	void insertTorsions();
+	/* reparses the original file to write out positions of snapshot atoms */
+	void writeFromSource(std::string filename);
 	std::string _filename;
 	std::string _dataFile;
 	std::string _name;
@@ -193,6 +206,7 @@ private:
 
 	std::list<Polymer> _polymers;
 	std::list<Ligand> _ligands;
+	std::vector<Interface> _interfaces;
 
 	int _loadCounter = 0;
 	std::mutex *_loadMutex = nullptr;
@@ -178,7 +178,7 @@ void MolRefiner::retrieveJobs()
 				setScoreForTicket(g, -cc);
 			}
 			
-			r->destroy();
+			calc->recycleResult(r);
 		}
 	}
 	
@@ -57,15 +57,20 @@ float OriginGrid<T>::interpolate(glm::vec3 real) const
 		}
 	}
 
-	int vox000x = vox000.x + central[0];
-	int vox000y = vox000.y + central[1];
-	int vox000z = vox000.z + central[2];
-	int vox000xm = vox000.x + next[0];
-	int vox000ym = vox000.y + next[1];
-	int vox000zm = vox000.z + next[2];
-	int vox000xn = vox000.x + extra[0];
-	int vox000yn = vox000.y + extra[1];
-	int vox000zn = vox000.z + extra[2];
+	/* offsets are added to whole voxels, as truncating (vox - 1) towards
+	 * zero would otherwise give the wrong neighbour below the first voxel */
+	int base[3] = {(int)floor(vox000.x), (int)floor(vox000.y),
+	               (int)floor(vox000.z)};
+
+	int vox000x = base[0] + central[0];
+	int vox000y = base[1] + central[1];
+	int vox000z = base[2] + central[2];
+	int vox000xm = base[0] + next[0];
+	int vox000ym = base[1] + next[1];
+	int vox000zm = base[2] + next[2];
+	int vox000xn = base[0] + extra[0];
+	int vox000yn = base[1] + extra[1];
+	int vox000zn = base[2] + extra[2];
 
 	this->collapse(vox000x, vox000y, vox000z);
 	this->collapse(vox000xm, vox000ym, vox000zm);
@@ -125,4 +130,92 @@ float OriginGrid<T>::interpolate(glm::vec3 real) const
 	return p11value;
 }
 
+/* same eleven points as interpolate(), with the interpolation written out
+ * as one weight per voxel */
+template <class T>
+void OriginGrid<T>::interpolationWeights(glm::vec3 real, long *indices,
+                                         float *weights) const
+{
+	real2Voxel(real);
+	glm::vec3 &vox000 = real;
+	this->collapse(vox000);
+	
+	glm::vec3 uvw = glm::vec3(vox000.x - floor(vox000.x),
+	                          vox000.y - floor(vox000.y),
+	                          vox000.z - floor(vox000.z));
+
+	int extra[3] = {-1, -1, -1};
+	int central[3] = {0, 0, 0};
+	int next[3] = {1, 1, 1};
+	
+	for (int i = 0; i < 3; i++)
+	{
+		if (*(&uvw.x + i) > 0.5)
+		{
+			extra[i] = 2;
+			central[i] = 1;
+			next[i] = 0;
+			*(&uvw.x + i) = 1 - *(&uvw.x + i);
+		}
+	}
+
+	int c[3], n[3], e[3];
+	const int base[3] = {(int)floor(vox000.x), (int)floor(vox000.y),
+	                     (int)floor(vox000.z)};
+
+	for (int i = 0; i < 3; i++)
+	{
+		c[i] = base[i] + central[i];
+		n[i] = base[i] + next[i];
+		e[i] = base[i] + extra[i];
+	}
+
+	this->collapse(c[0], c[1], c[2]);
+	this->collapse(n[0], n[1], n[2]);
+	this->collapse(e[0], e[1], e[2]);
+
+	long cs[3], ns[3], es[3];
+	const long steps[3] = {1, this->nx(), this->nx() * this->ny()};
+
+	for (int i = 0; i < 3; i++)
+	{
+		cs[i] = c[i] * steps[i];
+		ns[i] = n[i] * steps[i];
+		es[i] = e[i] * steps[i];
+	}
+
+	indices[0] = cs[0] + cs[1] + cs[2];
+	indices[1] = ns[0] + cs[1] + cs[2];
+	indices[2] = cs[0] + ns[1] + cs[2];
+	indices[3] = ns[0] + ns[1] + cs[2];
+	indices[4] = cs[0] + cs[1] + ns[2];
+	indices[5] = ns[0] + cs[1] + ns[2];
+	indices[6] = cs[0] + ns[1] + ns[2];
+	indices[7] = ns[0] + ns[1] + ns[2];
+	indices[8] = es[0] + cs[1] + cs[2];
+	indices[9] = cs[0] + es[1] + cs[2];
+	indices[10] = cs[0] + cs[1] + es[2];
+
+	const float u = uvw.x;
+	const float v = uvw.y;
+	const float w = uvw.z;
+
+	/* curvature corrections of the 11-point scheme */
+	const float mu = 0.4 * (u - u * u);
+	const float mv = 0.4 * (v - v * v);
+	const float mw = 0.4 * (w - w * w);
+
+	weights[0] = (1 - u) * (1 - v) * (1 - w) + mu + mv + mw;
+	weights[1] = u * (1 - v) * (1 - w) - 0.5 * mu;
+	weights[2] = (1 - u) * v * (1 - w) - 0.5 * mv;
+	weights[3] = u * v * (1 - w);
+	weights[4] = (1 - u) * (1 - v) * w - 0.5 * mw;
+	weights[5] = u * (1 - v) * w;
+	weights[6] = (1 - u) * v * w;
+	weights[7] = u * v * w;
+	weights[8] = -0.5 * mu;
+	weights[9] = -0.5 * mv;
+	weights[10] = -0.5 * mw;
+}
+
 #endif
@@ -39,6 +39,14 @@ public:
 	virtual glm::vec3 maxBound() const = 0;
 
 	float interpolate(glm::vec3 real) const;
+
+	/** finds the eleven voxels and their weights which interpolate() sums
+	 * over for this real-space position, so the same value can be had
+	 * again later without repeating the lookup.
+	 * @param indices array of 11 voxel indices to fill
+	 * @param weights array of 11 corresponding weights to fill */
+	void interpolationWeights(glm::vec3 real, long *indices, 
+	                          float *weights) const;
 	virtual float resolution(int i, int j, int k) const = 0;
 	virtual glm::vec3 reciprocal(int h, int k, int l) const = 0;
 	virtual void real2Voxel(glm::vec3 &real) const = 0;
@@ -0,0 +1,387 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Please email: vagabond @ hginn.co.uk for more details.
+
+#include "PackedBlocks.h"
+#include <cstring>
+
+/* all arithmetic below is written out in the same order as the glm
+ * operations in AtomBlock and torsion_basis(), so that each lane reproduces
+ * the result of the block-by-block calculation exactly. */
+
+PackedBlocks::PackedBlocks()
+{
+
+}
+
+void PackedBlocks::clear()
+{
+	_single = 0;
+	_lanes = 0;
+	_current = false;
+	_links.clear();
+	_coordination.clear();
+	_basis.clear();
+	_wip.clear();
+	_inherit.clear();
+	_torsions.clear();
+}
+
+void PackedBlocks::pack(const std::vector<AtomBlock> &blocks, size_t single,
+                        size_t samples)
+{
+	clear();
+
+	if (single == 0 || samples == 0 || blocks.size() < single * samples)
+	{
+		return;
+	}
+
+	_single = single;
+	_lanes = samples;
+
+	const size_t L = _lanes;
+
+	_links.resize(_single);
+	_coordination.resize(_single * 16);
+	_basis.resize(_single * 16 * L);
+	_wip.resize(_single * 12 * L);
+	_inherit.resize(_single * 3 * L);
+	_torsions.resize(_single * L);
+
+	_sin.resize(L);
+	_cos.resize(L);
+	_rotated.resize(8 * L);
+
+	for (size_t i = 0; i < _single; i++)
+	{
+		_links[i].root = true;
+	}
+
+	for (size_t i = 0; i < _single; i++)
+	{
+		const AtomBlock &b = blocks[i];
+		Links &l = _links[i];
+		l.anchor = (b.atom == nullptr);
+		l.nBonds = b.nBonds;
+
+		for (size_t j = 0; j < 4; j++)
+		{
+			l.children[j] = -1;
+			bool write = (l.anchor ? j == 0 : (int)j < b.nBonds);
+
+			if (write && b.write_locs[j] >= 0)
+			{
+				l.children[j] = i + b.write_locs[j];
+				_links[l.children[j]].root = false;
+			}
+		}
+
+		for (size_t c = 0; c < 4; c++)
+		{
+			for (size_t r = 0; r < 4; r++)
+			{
+				_coordination[i * 16 + c * 4 + r] = b.coordination[c][r];
+			}
+		}
+	}
+}
+
+void PackedBlocks::loadRoots(const std::vector<AtomBlock> &blocks)
+{
+	const size_t L = _lanes;
+
+	for (size_t i = 0; i < _single; i++)
+	{
+		if (!_links[i].root)
+		{
+			continue;
+		}
+
+		float *basis = &_basis[i * 16 * L];
+		float *inherit = &_inherit[i * 3 * L];
+
+		for (size_t s = 0; s < L; s++)
+		{
+			const AtomBlock &b = blocks[s * _single + i];
+
+			for (size_t c = 0; c < 4; c++)
+			{
+				for (size_t r = 0; r < 4; r++)
+				{
+					basis[(c * 4 + r) * L + s] = b.basis[c][r];
+				}
+			}
+
+			for (size_t r = 0; r < 3; r++)
+			{
+				inherit[r * L + s] = b.inherit[r];
+			}
+		}
+	}
+}
+
+void PackedBlocks::calculate()
+{
+	for (size_t i = 0; i < _single; i++)
+	{
+		calculateBlock(i);
+
+		if (_links[i].anchor)
+		{
+			writeFromAnchor(i);
+		}
+		else
+		{
+			writeToChildren(i);
+		}
+	}
+
+	_current = true;
+}
+
+void PackedBlocks::calculateBlock(size_t idx)
+{
+	const size_t L = _lanes;
+	const float *t = &_torsions[idx * L];
+	float *sint = &_sin[0];
+	float *cost = &_cos[0];
+
+	for (size_t s = 0; s < L; s++)
+	{
+		float rad = deg2rad(t[s]);
+		sint[s] = sin(rad);
+		cost[s] = cos(rad);
+	}
+
+	/* basis * rot only alters the first two columns of the basis */
+	const float *b = &_basis[idx * 16 * L];
+	float *rot = &_rotated[0];
+
+	for (size_t r = 0; r < 4; r++)
+	{
+		const float *b0 = &b[r * L];
+		const float *b1 = &b[(4 + r) * L];
+		float *r0 = &rot[r * L];
+		float *r1 = &rot[(4 + r) * L];
+
+		for (size_t s = 0; s < L; s++)
+		{
+			r0[s] = b0[s] * cost[s] + b1[s] * sint[s];
+			r1[s] = b0[s] * -sint[s] + b1[s] * cost[s];
+		}
+	}
+
+	/* (basis * rot) * coordination, only xyz of each column is kept */
+	const float *coord = &_coordination[idx * 16];
+	float *wip = &_wip[idx * 12 * L];
+
+	for (size_t c = 0; c < 4; c++)
+	{
+		const float c0 = coord[c * 4 + 0];
+		const float c1 = coord[c * 4 + 1];
+		const float c2 = coord[c * 4 + 2];
+		const float c3 = coord[c * 4 + 3];
+
+		for (size_t r = 0; r < 3; r++)
+		{
+			const float *r0 = &rot[r * L];
+			const float *r1 = &rot[(4 + r) * L];
+			const float *b2 = &b[(8 + r) * L];
+			const float *b3 = &b[(12 + r) * L];
+			float *out = &wip[(c * 3 + r) * L];
+
+			for (size_t s = 0; s < L; s++)
+			{
+				out[s] = r0[s] * c0 + r1[s] * c1 + b2[s] * c2 + b3[s] * c3;
+			}
+		}
+	}
+}
+
+void PackedBlocks::writeToChildren(size_t idx)
+{
+	const size_t L = _lanes;
+	const Links &l = _links[idx];
+
+	const float *self = &_basis[(idx * 16 + 12) * L];
+	const float *prev = &_inherit[idx * 3 * L];
+
+	for (int i = 0; i < l.nBonds && i < 4; i++)
+	{
+		int n = l.children[i];
+		if (n < 0)
+		{
+			continue;
+		}
+
+		const float *next = &_wip[(idx * 12 + i * 3) * L];
+		float *target = &_basis[n * 16 * L];
+		float *inherit = &_inherit[n * 3 * L];
+
+		for (size_t s = 0; s < L; s++)
+		{
+			const float sx = self[s];
+			const float sy = self[L + s];
+			const float sz = self[2 * L + s];
+
+			const float nx = next[s];
+			const float ny = next[L + s];
+			const float nz = next[2 * L + s];
+
+			/* previous bond direction */
+			const float px = prev[s] - sx;
+			const float py = prev[L + s] - sy;
+			const float pz = prev[2 * L + s] - sz;
+
+			/* current bond direction becomes new Z direction */
+			float cx = nx - sx;
+			float cy = ny - sy;
+			float cz = nz - sz;
+			float inv = 1.f / sqrt(cx * cx + cy * cy + cz * cz);
+			cx *= inv; cy *= inv; cz *= inv;
+
+			/* new Y direction */
+			float yx = cy * pz - py * cz;
+			float yy = cz * px - pz * cx;
+			float yz = cx * py - px * cy;
+			inv = 1.f / sqrt(yx * yx + yy * yy + yz * yz);
+			yx *= inv; yy *= inv; yz *= inv;
+
+			/* new X direction */
+			const float xx = cy * yz - yy * cz;
+			const float xy = cz * yx - yz * cx;
+			const float xz = cx * yy - yx * cy;
+
+			target[0 * L + s] = xx;
+			target[1 * L + s] = xy;
+			target[2 * L + s] = xz;
+			target[3 * L + s] = 0;
+			target[4 * L + s] = -yx;
+			target[5 * L + s] = -yy;
+			target[6 * L + s] = -yz;
+			target[7 * L + s] = 0;
+			target[8 * L + s] = cx;
+			target[9 * L + s] = cy;
+			target[10 * L + s] = cz;
+			target[11 * L + s] = 0;
+			target[12 * L + s] = nx;
+			target[13 * L + s] = ny;
+			target[14 * L + s] = nz;
+			target[15 * L + s] = 1;
+
+			inherit[s] = sx;
+			inherit[L + s] = sy;
+			inherit[2 * L + s] = sz;
+		}
+	}
+}
+
+void PackedBlocks::writeFromAnchor(size_t idx)
+{
+	const size_t L = _lanes;
+	const Links &l = _links[idx];
+	int n = l.children[0];
+
+	if (n < 0)
+	{
+		return;
+	}
+
+	const float *b = &_basis[idx * 16 * L];
+	float *target = &_basis[n * 16 * L];
+	memcpy(target, b, sizeof(float) * 16 * L);
+
+	/* child's inherited position from its own coordination */
+	int col = (l.nBonds == 1 ? 1 : 0);
+	const float *coord = &_coordination[n * 16 + col * 4];
+	float *inherit = &_inherit[n * 3 * L];
+
+	for (size_t r = 0; r < 3; r++)
+	{
+		const float *b0 = &b[r * L];
+		const float *b1 = &b[(4 + r) * L];
+		const float *b2 = &b[(8 + r) * L];
+		const float *b3 = &b[(12 + r) * L];
+		float *out = &inherit[r * L];
+
+		for (size_t s = 0; s < L; s++)
+		{
+			out[s] = b0[s] * coord[0] + b1[s] * coord[1] +
+			b2[s] * coord[2] + b3[s] * coord[3];
+		}
+	}
+}
+
+void PackedBlocks::unpack(std::vector<AtomBlock> &blocks) const
+{
+	const size_t L = _lanes;
+
+	for (size_t i = 0; i < _single; i++)
+	{
+		const float *pos = &_basis[(i * 16 + 12) * L];
+
+		for (size_t s = 0; s < L; s++)
+		{
+			glm::vec4 &dest = blocks[s * _single + i].basis[3];
+			dest.x = pos[s];
+			dest.y = pos[L + s];
+			dest.z = pos[2 * L + s];
+			dest.w = pos[3 * L + s];
+		}
+	}
+}
+
+glm::vec3 PackedBlocks::position(size_t idx) const
+{
+	const size_t L = _lanes;
+	size_t i = idx % _single;
+	size_t s = idx / _single;
+	const float *pos = &_basis[(i * 16 + 12) * L];
+
+	return glm::vec3(pos[s], pos[L + s], pos[2 * L + s]);
+}
+
+glm::vec3 PackedBlocks::parentPosition(size_t idx) const
+{
+	const size_t L = _lanes;
+	size_t i = idx % _single;
+	size_t s = idx / _single;
+	const float *inherit = &_inherit[i * 3 * L];
+
+	return glm::vec3(inherit[s], inherit[L + s], inherit[2 * L + s]);
+}
+
+glm::vec3 PackedBlocks::childPosition(size_t idx, int c) const
+{
+	const size_t L = _lanes;
+	size_t i = idx % _single;
+	size_t s = idx / _single;
+	const float *wip = &_wip[(i * 12 + c * 3) * L];
+
+	return glm::vec3(wip[s], wip[L + s], wip[2 * L + s]);
+}
+
+glm::vec3 PackedBlocks::axis(size_t idx) const
+{
+	const size_t L = _lanes;
+	size_t i = idx % _single;
+	size_t s = idx / _single;
+	const float *z = &_basis[(i * 16 + 8) * L];
+
+	return glm::vec3(z[s], z[L + s], z[2 * L + s]);
+}
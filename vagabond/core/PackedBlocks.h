@@ -0,0 +1,137 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Please email: vagabond @ hginn.co.uk for more details.
+
+#ifndef __vagabond__PackedBlocks__
+#define __vagabond__PackedBlocks__
+
+#include <vector>
+#include <vagabond/utils/glm_import.h>
+#include "AtomBlock.h"
+
+/** \class PackedBlocks
+ *  Structure-of-arrays copy of the AtomBlocks of a BondSequence, used to
+ *  walk the blocks of every sample at once. Each sample occupies one lane:
+ *  every matrix element of every block is stored as a contiguous run of
+ *  lanes, so the inner loops run over samples and can be vectorised.
+ *  Results are identical to AtomBlock-by-AtomBlock calculation. */
+
+class PackedBlocks
+{
+public:
+	PackedBlocks();
+
+	/** copies the static parts of the blocks (coordination and write
+	 *  locations) into packed arrays.
+	 * 	@param blocks blocks of the sequence, including all samples
+	 * 	@param single number of blocks for a single sample
+	 * 	@param samples number of samples, each becoming one lane */
+	void pack(const std::vector<AtomBlock> &blocks, size_t single,
+	          size_t samples);
+
+	void clear();
+
+	bool packed() const
+	{
+		return _single > 0;
+	}
+
+	/** true if packed and the positions come from the latest
+	 *  calculation, rather than one made before the blocks were last
+	 *  calculated one by one */
+	bool current() const
+	{
+		return packed() && _current;
+	}
+
+	/** marks the packed positions as stale, e.g. once the blocks have
+	 *  been calculated without them */
+	void invalidate()
+	{
+		_current = false;
+	}
+
+	size_t lanes() const
+	{
+		return _lanes;
+	}
+
+	/** torsion angle (degrees) for block idx within a single sample, for
+	 *  sample number lane */
+	float &torsion(size_t idx, size_t lane)
+	{
+		return _torsions[idx * _lanes + lane];
+	}
+
+	/** refresh basis and inherited position of blocks which are not
+	 * written to by any parent (i.e. anchors) */
+	void loadRoots(const std::vector<AtomBlock> &blocks);
+
+	/** walk all blocks for all lanes, requires torsions to be filled */
+	void calculate();
+
+	/** write calculated atom positions back into the sequence's blocks */
+	void unpack(std::vector<AtomBlock> &blocks) const;
+
+	/** @param idx block index within full sequence (all samples) */
+	glm::vec3 position(size_t idx) const;
+	glm::vec3 parentPosition(size_t idx) const;
+	glm::vec3 childPosition(size_t idx, int i) const;
+
+	/** torsion axis (z column of the basis) of the block */
+	glm::vec3 axis(size_t idx) const;
+private:
+	void calculateBlock(size_t idx);
+	void writeToChildren(size_t idx);
+	void writeFromAnchor(size_t idx);
+
+	struct Links
+	{
+		int children[4];
+		int nBonds;
+		bool anchor;
+		bool root;
+	};
+
+	size_t _single = 0;
+	size_t _lanes = 0;
+	bool _current = false;
+
+	std::vector<Links> _links;
+
+	/* 16 per block, column-major as for glm, shared by all lanes */
+	std::vector<float> _coordination;
+
+	/* 16 lane runs per block */
+	std::vector<float> _basis;
+
+	/* 4 columns of 3 lane runs per block */
+	std::vector<float> _wip;
+
+	/* 3 lane runs per block */
+	std::vector<float> _inherit;
+
+	/* 1 lane run per block */
+	std::vector<float> _torsions;
+
+	/* scratch space for a single block */
+	std::vector<float> _sin;
+	std::vector<float> _cos;
+	std::vector<float> _rotated;
+};
+
+#endif
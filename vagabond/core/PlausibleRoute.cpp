@@ -74,6 +74,11 @@ float PlausibleRoute::routeScore(int steps, bool forceField)
 	calculateProgression(steps);
 	clearTickets();
 
+	if (!forceField)
+	{
+		submitBatchAndRetrieve();
+	}
+
 	float cumulative = 0;
 	for (size_t i = 0; i < pointCount(); i++)
 	{
@@ -83,7 +88,11 @@ float PlausibleRoute::routeScore(int steps, bool forceField)
 
 		if (!forceField)
 		{
-			submitJob(i, rnd < 0.01);
+			/* deviations are already in, only occasionally update atoms */
+			if (rnd < 0.01)
+			{
+				submitJob(i, true);
+			}
 		}
 		else
 		{
@@ -181,13 +190,11 @@ int PlausibleRoute::countTorsions()
 
 void PlausibleRoute::prepareAnglesForRefinement(std::vector<int> &idxs)
 {
-	if (_simplex)
+	if (_engine)
 	{
-		delete _simplex;
-		_simplex = nullptr;
+		delete _engine;
+		_engine = nullptr;
 	}
-	
-	_simplex = new SimplexEngine(this);
 
 	_activeTorsions = idxs;
 	_paramPtrs.clear();
@@ -217,8 +224,21 @@ void PlausibleRoute::prepareAnglesForRefinement(std::vector<int> &idxs)
 		}
 	}
 	
-	_simplex->setMaxRuns(20);
-	_simplex->chooseStepSizes(steps);
+	if (_engineType == Engine::TypeCMAES)
+	{
+		CMAESEngine *cmaes = new CMAESEngine(this);
+		cmaes->setPopulation(_threads);
+		cmaes->setStepSize(_stepSize);
+		cmaes->setMaxRuns(20 * steps.size());
+		_engine = cmaes;
+	}
+	else
+	{
+		SimplexEngine *simplex = new SimplexEngine(this);
+		simplex->setMaxRuns(20);
+		simplex->chooseStepSizes(steps);
+		_engine = simplex;
+	}
 }
 
 size_t PlausibleRoute::parameterCount()
@@ -238,11 +258,11 @@ bool PlausibleRoute::simplexCycle(std::vector<int> torsionIdxs)
 	activateWaypoints(true);
 	_bestScore = routeScore(_nudgeCount);
 
-	_simplex->start();
+	_engine->start();
 
 	bool changed = false;
 
-	float bs = _simplex->bestScore();
+	float bs = _engine->bestScore();
 	if (bs < _bestScore - 1e-3)
 	{
 		_bestScore = bs;
@@ -22,6 +22,7 @@
 #include "Route.h"
 #include "Progressor.h"
 #include "SimplexEngine.h"
+#include "CMAESEngine.h"
 #include <vagabond/c4x/Angular.h>
 
 class Path;
@@ -44,6 +45,12 @@ public:
 		_minimumMagnitude = mag;
 	}
 	
+	/** engine used to refine waypoints, simplex or CMA-ES */
+	void setEngineType(Engine::Type type)
+	{
+		_engineType = type;
+	}
+	
 	const float &bestScore() const
 	{
 		return _bestScore;
@@ -132,7 +139,8 @@ private:
 	int _jobNum = 0;
 	std::map<int, float> _results;
 	
-	SimplexEngine *_simplex = nullptr;
+	Engine *_engine = nullptr;
+	Engine::Type _engineType = Engine::TypeSimplex;
 	
 	std::vector<float> _xPolys, _yPolys;
 };
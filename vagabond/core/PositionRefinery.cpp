@@ -25,6 +25,10 @@
 #include "TorsionBasis.h"
 #include "SimplexEngine.h"
 #include "ChemotaxisEngine.h"
+#include "LBFGSEngine.h"
+#include "CMAESEngine.h"
+#include <algorithm>
+#include <thread>
 
 PositionRefinery::PositionRefinery(AtomGroup *group)
 {
@@ -162,16 +166,21 @@ bool PositionRefinery::refineBetween(int start, int end, int side_max)
 	}
 
 	reallocateEngine(Positions);
-	SimplexEngine *se = static_cast<SimplexEngine *>(_engine);
-	se->setStepSize(_step);
-	se->setMaxJobsPerVertex(1);
-	se->start();
+	_engine->setStepSize(_step);
 
-	bool improved = se->improved();
+	SimplexEngine *se = dynamic_cast<SimplexEngine *>(_engine);
+	if (se != nullptr)
+	{
+		se->setMaxJobsPerVertex(1);
+	}
+
+	_engine->start();
+
+	bool improved = _engine->improved();
 
 	if (improved)
 	{
-		const std::vector<float> &trial = se->bestResult();
+		const std::vector<float> &trial = _engine->bestResult();
 		std::vector<float> best = expandPoint(trial);
 		Coord::Get get = acquireFromVector(best);
 		TorsionBasis *basis = _calculator->sequenceHandler()->torsionBasis();
@@ -314,8 +323,16 @@ void PositionRefinery::setupCalculator(AtomGroup *group, bool loopy,
 	}
 
 	_calculator = new BondCalculator();
+	_gradientsSupplied = false;
 	_calculator->setPipelineType(BondCalculator::PipelineAtomPositions);
-	_calculator->setMaxSimultaneousThreads(1);
+	/* a population of candidates can be calculated side by side */
+	int threads = 1;
+	if (_engineType == Engine::TypeCMAES)
+	{
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	_calculator->setMaxSimultaneousThreads(threads);
 	_calculator->setTotalSamples(1);
 	_calculator->setMaximumLoopCount(loopy ? 2 : 1);
 
@@ -351,8 +368,35 @@ void PositionRefinery::refine(AtomGroup *group)
 	
 }
 
+void PositionRefinery::storeGradient(int ticket, std::vector<float> &full)
+{
+	if (full.size() != _mask.size())
+	{
+		return;
+	}
+
+	_gradientsSupplied = true;
+	std::vector<float> grad;
+	for (size_t i = 0; i < _mask.size(); i++)
+	{
+		if (_mask[i])
+		{
+			grad.push_back(full[i]);
+		}
+	}
+
+	setGradientForTicket(ticket, grad);
+}
+
 float PositionRefinery::getResult(int *job_id)
 {
+	/* scores from batches are already waiting */
+	float score = RunsEngine::getResult(job_id);
+	if (*job_id >= 0)
+	{
+		return score;
+	}
+
 	Result *result = _calculator->acquireResult();
 	if (result == nullptr)
 	{
@@ -365,9 +409,13 @@ float PositionRefinery::getResult(int *job_id)
 		result->transplantPositions();
 	}
 
-	float score = result->deviation;
-	*job_id = result->ticket;
-	result->destroy();
+	score = result->deviation;
+	*job_id = _engineTickets[result->ticket];
+	_engineTickets.erase(result->ticket);
+
+	storeGradient(*job_id, result->gradient);
+
+	_calculator->recycleResult(result);
 	return score;
 }
 
@@ -403,6 +451,12 @@ int PositionRefinery::sendJob(const std::vector<float> &trial)
 	}
 	_ncalls++;
 
+	if (_stage == Positions && gradientsWanted())
+	{
+		job.requests = static_cast<JobType>(job.requests | 
+		                                    JobDeviationGradient);
+	}
+
 	if (_stage == Positions)
 	{
 		std::vector<float> expanded = expandPoint(trial);
@@ -413,10 +467,65 @@ int PositionRefinery::sendJob(const std::vector<float> &trial)
 		}
 	}
 	
-	int ticket = _calculator->submitJob(job);
+	int ticket = getNextTicket();
+	_engineTickets[_calculator->submitJob(job)] = ticket;
 	return ticket;
 }
 
+std::vector<int> 
+PositionRefinery::sendJobs(const std::vector<std::vector<float>> &all)
+{
+	std::vector<int> tickets(all.size(), -1);
+	std::vector<size_t> batched;
+
+	for (size_t i = 0; i < all.size(); i++)
+	{
+		if (_ncalls % 200 == 0)
+		{
+			/* sent alone to pick up positions as sendJob() always has */
+			tickets[i] = sendJob(all[i]);
+			continue;
+		}
+
+		_ncalls++;
+		batched.push_back(i);
+	}
+
+	if (batched.size() == 0)
+	{
+		return tickets;
+	}
+
+	Batch batch;
+	batch.requests = JobCalculateDeviations;
+	batch.allocate(batched.size(), _mask.size());
+
+	if (_stage == Positions && gradientsWanted())
+	{
+		batch.requests = static_cast<JobType>(batch.requests | 
+		                                      JobDeviationGradient);
+	}
+
+	for (size_t i = 0; i < batched.size() && _stage == Positions; i++)
+	{
+		std::vector<float> expanded = expandPoint(all[batched[i]]);
+		std::copy(expanded.begin(), expanded.end(), batch.vector(i));
+	}
+
+	_calculator->submitBatch(batch);
+	_calculator->retrieveBatch(batch);
+
+	for (size_t i = 0; i < batched.size(); i++)
+	{
+		int ticket = getNextTicket();
+		setScoreForTicket(ticket, batch.deviations[i]);
+		storeGradient(ticket, batch.gradients[i]);
+		tickets[batched[i]] = ticket;
+	}
+
+	return tickets;
+}
+
 void PositionRefinery::finish()
 {
 	_finish = true;
@@ -470,7 +579,19 @@ void PositionRefinery::reallocateEngine(RefinementStage stage)
 		return;
 	}
 
-	if (stage == Positions || _stage == CarefulLoopy)
+	if (stage == Positions && _engineType == Engine::TypeLBFGS)
+	{
+		_engine = new LBFGSEngine(this);
+		_engine->setStepSize(_step);
+	}
+	else if (stage == Positions && _engineType == Engine::TypeCMAES)
+	{
+		CMAESEngine *cmaes = new CMAESEngine(this);
+		cmaes->setPopulation(_calculator->maxSimultaneousThreads());
+		_engine = cmaes;
+		_engine->setStepSize(_step);
+	}
+	else if (stage == Positions || _stage == CarefulLoopy)
 	{
 		_engine = new SimplexEngine(this);
 		_engine->setStepSize(_step);
@@ -49,6 +49,13 @@ public:
 	{
 		_thorough = th;
 	}
+	
+	/** engine used to refine positions: simplex by default, L-BFGS to use
+	 *  analytic gradients, or CMA-ES to keep every calculator thread busy */
+	void setEngineType(Engine::Type type)
+	{
+		_engineType = type;
+	}
 	virtual void finish();
 	
 	static void backgroundRefine(PositionRefinery *ref);
@@ -65,7 +72,17 @@ public:
 protected:
 	virtual size_t parameterCount();
 	virtual int sendJob(const std::vector<float> &all);
+
+	/** evaluates the vectors as one batch and waits for their scores, so 
+	 *  no results of single jobs may be outstanding */
+	virtual std::vector<int> sendJobs(const std::vector<std::vector<float>> 
+	                                  &all);
 	virtual float getResult(int *job_id);
+
+	virtual bool returnsGradients()
+	{
+		return _stage == Positions && _gradientsSupplied;
+	}
 private:
 	std::function<float(int idx)> acquireFromVector(const std::vector<float> &all);
 	void fullSizeVector(const std::vector<float> &all, float *dest);
@@ -75,6 +92,7 @@ private:
 
 	void wiggleBond(const Parameter *t);
 
+	void storeGradient(int ticket, std::vector<float> &full);
 	void setupCalculator(AtomGroup *group, bool loopy, int jointLimit = -1);
 	bool refineBetween(int start, int end, int side_max = INT_MAX);
 	double fullResidual();
@@ -108,6 +126,7 @@ private:
 	std::atomic<bool> _done{false};
 	
 	TorsionBasis::Type _type = TorsionBasis::TypeSimple;
+	Engine::Type _engineType = Engine::TypeSimplex;
 	Engine *_engine = nullptr;
 	
 	enum RefinementStage
@@ -124,6 +143,14 @@ private:
 	RefinementStage _stage = None;
 	int _count = 0;
 	
+	/* calculator tickets for single jobs onto tickets handed to the engine,
+	 * which are shared with batched vectors */
+	std::map<int, int> _engineTickets;
+	
+	/* calculator has produced a gradient, which it does not do while
+	 * ring programs are in use */
+	bool _gradientsSupplied = false;
+
 	std::set<int> _activeIndices;
 	std::set<Parameter *> _parameters;
 	std::vector<bool> _mask;
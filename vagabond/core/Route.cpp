@@ -74,6 +74,66 @@ float Route::submitJobAndRetrieve(int idx, bool show, bool forces)
 	return _point2Score[idx].scores;
 }
 
+void Route::submitBatchAndRetrieve()
+{
+	std::vector<Batch> batches(_calculators.size());
+
+	for (size_t c = 0; c < _calculators.size(); c++)
+	{
+		BondCalculator *calc = _calculators[c];
+		std::vector<int> &dest = _calc2Destination[calc];
+		Batch &batch = batches[c];
+
+		batch.requests = JobCalculateDeviations;
+		batch.samples = _num;
+		batch.allocate(pointCount(), dest.size());
+
+		for (size_t idx = 0; idx < pointCount(); idx++)
+		{
+			batch.fractions.push_back(idx / (float)(pointCount() - 1));
+			float *vec = batch.vector(idx);
+
+			for (size_t i = 0; i < dest.size(); i++)
+			{
+				int calc_idx = dest[i];
+
+				if (calc_idx >= 0 && _points[idx].size() > calc_idx)
+				{
+					vec[i] = _points[idx][calc_idx];
+				}
+			}
+		}
+
+		calc->submitBatch(batch);
+	}
+
+	for (size_t c = 0; c < _calculators.size(); c++)
+	{
+		Batch &batch = batches[c];
+		_calculators[c]->retrieveBatch(batch);
+
+		for (size_t idx = 0; idx < batch.count; idx++)
+		{
+			Score &score = _point2Score[idx];
+			double dev = batch.deviations[idx];
+
+			if (dev == dev)
+			{
+				score.deviations += dev;
+				score.divs++;
+			}
+		}
+	}
+
+	for (size_t idx = 0; idx < pointCount(); idx++)
+	{
+		Score &score = _point2Score[idx];
+		score.deviations /= score.divs;
+		score.divs = 1;
+		score.sc_num = 1;
+	}
+}
+
 void Route::submitJob(int idx, bool show, bool forces)
 {
 	if ((idx > 0 && idx >= _points.size()) || idx < 0)
@@ -53,6 +53,11 @@ public:
 	void submitJob(int idx, bool show = true, bool forces = false);
 
 	float submitJobAndRetrieve(int idx, bool show = true, bool forces = false);
+
+	/** calculates the deviation for every point, each calculator running
+	 *  through all the points as one batch. Scores are left as by 
+	 *  retrieve(). */
+	void submitBatchAndRetrieve();
 	
 	/** total number of points in the system */
 	size_t pointCount()
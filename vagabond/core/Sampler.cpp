@@ -22,6 +22,11 @@
 #include <vagabond/utils/Hypersphere.h>
 #include <cmath>
 #include <iostream>
+#include <algorithm>
+
+/* samples per block when expanding, so that the tensor stays in cache
+ * while each block of sample points is run through it */
+#define SAMPLE_TILE (64)
 
 Sampler::Sampler(int n, int dims)
 {
@@ -202,25 +207,64 @@ float Sampler::gamma()
 	return result;
 }
 
-void Sampler::add_to_vec_index(float &value, const int &idx, 
-                               const float *tensor, const int sample_num) const
+void Sampler::expand(const float *mean, const float *tensor, int size,
+                     std::vector<float> &out) const
 {
-	float mean = _points[sample_num][idx];
-	float result = 0;
-	
-	if (tensor != nullptr)
+	const int samples = _points.rows;
+	const int axes = std::min(size, _dims);
+	out.resize(samples * size);
+
+	for (int s = 0; s < samples; s++)
 	{
-		for (size_t j = 0; j < _dims; j++)
+		memcpy(&out[s * size], mean, size * sizeof(float));
+	}
+
+	if (tensor == nullptr)
+	{
+		for (int s = 0; s < samples; s++)
 		{
-			result += tensor[idx * _dims + j] * mean;
+			for (int i = 0; i < axes; i++)
+			{
+				out[s * size + i] += _points[s][i];
+			}
 		}
+
+		return;
 	}
-	else
+
+	/* out = mean + points * tensor', one tile of samples at a time */
+	std::vector<float> tile(SAMPLE_TILE * _dims);
+
+	for (int start = 0; start < samples; start += SAMPLE_TILE)
 	{
-		result = mean;
+		int end = std::min(start + SAMPLE_TILE, samples);
+
+		for (int s = start; s < end; s++)
+		{
+			for (int j = 0; j < _dims; j++)
+			{
+				tile[(s - start) * _dims + j] = _points[s][j];
+			}
+		}
+
+		for (int i = 0; i < axes; i++)
+		{
+			const float *axis = &tensor[i * _dims];
+
+			for (int s = start; s < end; s++)
+			{
+				const float *point = &tile[(s - start) * _dims];
+				float sum = 0;
+
+				for (int j = 0; j < _dims; j++)
+				{
+					sum += axis[j] * point[j];
+				}
+
+				out[s * size + i] += sum;
+			}
+		}
 	}
-	
-	value += result;
 }
 
 void Sampler::addToVec(float *&vec, float *tensor, int sample_num)
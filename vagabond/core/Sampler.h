@@ -35,8 +35,14 @@ public:
 	float hypersphereVolume(float radius);
 	
 	void addToVec(float *&vec, float *tensor, int num);
-	void add_to_vec_index(float &value, const int &idx, 
-	                      const float *tensor, const int sample_num) const;
+
+	/** expands a custom vector against every sample point at once.
+	 * @param mean vector of length size added to every sample
+	 * @param tensor dims x dims row-major axes for the sample points, or
+	 * nullptr to add the sample points directly
+	 * @param out filled with pointCount() rows of length size */
+	void expand(const float *mean, const float *tensor, int size,
+	            std::vector<float> &out) const;
 	
 	int dims()
 	{
@@ -70,6 +70,30 @@ float SimpleBasis::parameterForVector(BondSequence *seq, int idx,
 	return ta.angle;
 }
 
+bool SimpleBasis::compile(CompiledTorsions &ct, int n) const
+{
+	if (_angles.size() != _params.size())
+	{
+		return false;
+	}
+
+	ct.start();
+
+	for (size_t i = 0; i < _angles.size(); i++)
+	{
+		const TorsionAngle &ta = _angles[i];
+
+		if (ta.mask && i < n)
+		{
+			ct.addTerm(i, 1);
+		}
+
+		ct.finishTorsion(ta.angle);
+	}
+
+	return true;
+}
+
 void SimpleBasis::prepare(int dims)
 {
 	_angles.clear();
@@ -81,5 +105,7 @@ void SimpleBasis::prepare(int dims)
 		TorsionAngle ta = {start, mask};
 		_angles.push_back(ta);
 	}
+
+	_revision++;
 }
 
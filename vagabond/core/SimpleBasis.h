@@ -33,6 +33,8 @@ public:
 
 	virtual float parameterForVector(BondSequence *seq, int tidx, 
 	                                 const Coord::Get &coord, int n);
+
+	virtual bool compile(CompiledTorsions &ct, int n) const;
 	virtual void prepare(int dims = 0);
 private:
 
@@ -203,11 +203,18 @@ void SimplexEngine::pickUpResults()
 
 void SimplexEngine::shrink()
 {
+	std::vector<SPoint> trials;
+
 	for (size_t i = 0; i < _points.size(); i++)
 	{
-		SPoint trial = scaleThrough(_points[i].vertex, _centroid.vertex, 0.8);
-		int ticket = sendJob(trial);
-		_points[i].tickets[ticket] = trial;
+		trials.push_back(scaleThrough(_points[i].vertex, _centroid.vertex, 0.8));
+	}
+	
+	std::vector<int> tickets = sendJobs(trials);
+
+	for (size_t i = 0; i < tickets.size(); i++)
+	{
+		_points[i].tickets[tickets[i]] = trials[i];
 	}
 	
 	getResults();
@@ -324,6 +331,8 @@ bool SimplexEngine::classifyResults()
 
 void SimplexEngine::sendStartingJobs()
 {
+	std::vector<SPoint> trials;
+
 	for (size_t i = 0; i < _points.size(); i++)
 	{
 		SPoint trial;
@@ -335,15 +344,20 @@ void SimplexEngine::sendStartingJobs()
 			trial[j] = val;
 		}
 		
-		int ticket = sendJob(trial);
-		
-		if (ticket < 0)
+		trials.push_back(trial);
+	}
+
+	std::vector<int> tickets = sendJobs(trials);
+
+	for (size_t i = 0; i < tickets.size(); i++)
+	{
+		if (tickets[i] < 0)
 		{
 			throw(std::runtime_error("::sendJob has not been implemented "
 			                              " in SimplexEngine superclass."));
 		}
 		
-		_points[i].tickets[ticket] = trial;
+		_points[i].tickets[tickets[i]] = trials[i];
 	}
 	
 	pickUpResults();
@@ -390,12 +404,18 @@ void SimplexEngine::sendReflectionJob(int i)
 
 void SimplexEngine::sendShrinkJobs()
 {
+	std::vector<SPoint> trials;
+
 	for (size_t i = 0; i < _points.size(); i++)
 	{
-		SPoint trial = scaleThrough(_points[i].vertex, _centroid.vertex, 0.8);
-		int ticket = sendJob(trial);
-		_points[i].tickets[ticket] = trial;
+		trials.push_back(scaleThrough(_points[i].vertex, _centroid.vertex, 0.8));
+	}
+	
+	std::vector<int> tickets = sendJobs(trials);
 
+	for (size_t i = 0; i < tickets.size(); i++)
+	{
+		_points[i].tickets[tickets[i]] = trials[i];
 		_points[i].decision = ShouldReflect;
 	}
 }
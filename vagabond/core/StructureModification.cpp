@@ -276,7 +276,7 @@ void StructureModification::retrieve()
 			found = true;
 			if (r->requests & JobExtractPositions)
 			{
-				handleAtomMap(r->aps);
+				handleAtomMap(r->atomPosMap());
 			}
 			if (r->requests & JobPositionVector)
 			{
@@ -86,6 +86,7 @@ void TorsionBasis::absorbVector(const Coord::Get &coord, int n, bool *mask)
 		_params[i]->setRefined(true);
 	}
 
+	_revision++;
 }
 
 int TorsionBasis::addParameter(Parameter *param, Atom *atom)
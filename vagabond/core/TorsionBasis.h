@@ -21,6 +21,7 @@
 
 #include <vector>
 #include <set>
+#include <atomic>
 #include "ResidueTorsion.h"
 #include <vagabond/utils/AcquireCoord.h>
 
@@ -28,6 +29,70 @@ class BondSequence;
 class Parameter;
 class Atom;
 
+/** torsion angles compiled into a flat table, for bases where each angle
+ *  is a fixed linear combination of the custom vector:
+ *  torsion[i] = sum(coefficients[k] * vec[indices[k]]) + reference[i],
+ *  for k between offsets[i] and offsets[i + 1]. */
+struct CompiledTorsions
+{
+	/* custom vector size compiled for, -1 if not compiled */
+	int n = -1;
+	int revision = -1;
+	bool usable = false;
+
+	std::vector<float> reference;
+	std::vector<int> offsets;
+	std::vector<int> indices;
+	std::vector<double> coefficients;
+	
+	void clear()
+	{
+		n = -1;
+		revision = -1;
+		usable = false;
+		reference.clear();
+		offsets.clear();
+		indices.clear();
+		coefficients.clear();
+	}
+	
+	void start()
+	{
+		reference.clear();
+		indices.clear();
+		coefficients.clear();
+		offsets.clear();
+		offsets.push_back(0);
+	}
+	
+	void addTerm(int idx, double coefficient)
+	{
+		indices.push_back(idx);
+		coefficients.push_back(coefficient);
+	}
+	
+	void finishTorsion(float ref)
+	{
+		reference.push_back(ref);
+		offsets.push_back(indices.size());
+	}
+	
+	void evaluate(const float *vec, float *torsions) const
+	{
+		for (size_t i = 0; i < reference.size(); i++)
+		{
+			float sum = 0;
+			for (int k = offsets[i]; k < offsets[i + 1]; k++)
+			{
+				float add = coefficients[k] * vec[indices[k]];
+				sum += add;
+			}
+
+			torsions[i] = sum + reference[i];
+		}
+	}
+};
+
 class TorsionBasis
 {
 public:
@@ -73,6 +138,22 @@ public:
 	virtual void absorbVector(const Coord::Get &coordinate, int n, 
 	                          bool *mask = nullptr);
 
+	/** fills in flat table of torsion angles, if the basis has a fixed
+	 *  linear relationship to the custom vector.
+	 * @param n total number of parameters in custom vector
+	 * @returns true if table is usable in place of valueForParameter() */
+	virtual bool compile(CompiledTorsions &ct, int n) const
+	{
+		return false;
+	}
+	
+	/** incremented when compiled tables go out of date, read by every
+	 *  calculator thread */
+	int revision() const
+	{
+		return _revision;
+	}
+
 	virtual void prepareRecalculation() {};
 	std::vector<int> grabIndices(const std::set<Parameter *> &params);
 	void trimParametersToUsed(std::set<Parameter *> &params);
@@ -95,6 +176,7 @@ public:
 	void setReferenceAngle(int i, float a)
 	{
 		_angles[i].angle = a;
+		_revision++;
 	}
 	
 	Atom *atom(int i)
@@ -119,6 +201,7 @@ protected:
 	};
 
 	std::vector<TorsionAngle> _angles;
+	std::atomic<int> _revision{0};
 
 };
 
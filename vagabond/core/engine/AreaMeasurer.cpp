@@ -16,8 +16,18 @@
 // 
 // Please email: vagabond @ hginn.co.uk for more details.
 
+#define _USE_MATH_DEFINES
+#include <math.h>
 #include "AreaMeasurer.h"
 #include "ContactSheet.h"
+#include "SurfaceAreaHandler.h"
+#include "ElementLibrary.h"
+#include "Fibonacci.h"
+#include "Atom.h"
+
+/* neighbours are tested for occlusion in chunks of this many, so that the
+ * inner loop has a fixed length and can be vectorised */
+#define NEIGHBOUR_CHUNK 8
 
 AreaMeasurer::AreaMeasurer(SurfaceAreaHandler *handler)
 {
@@ -30,12 +40,248 @@ AreaMeasurer::~AreaMeasurer()
 	delete _contacts;
 }
 
+void AreaMeasurer::prepareLattice()
+{
+	if (_unitX.size() > 0 && _unitX.size() >= (size_t)_pointNum)
+	{
+		return;
+	}
+
+	Fibonacci fib;
+	fib.generateLattice(_pointNum, 1);
+	std::vector<glm::vec3> &points = fib.getPoints();
+
+	_unitX.resize(points.size());
+	_unitY.resize(points.size());
+	_unitZ.resize(points.size());
+
+	for (size_t i = 0; i < points.size(); i++)
+	{
+		_unitX[i] = points[i].x;
+		_unitY[i] = points[i].y;
+		_unitZ[i] = points[i].z;
+	}
+}
+
+void AreaMeasurer::prepareAtoms()
+{
+	/* radii are only looked up again if the atoms have changed */
+	bool same = (_atoms.size() == _posMap.size());
+	size_t i = 0;
+
+	_atoms.resize(_posMap.size());
+	
+	AtomPosMap::iterator it;
+	for (it = _posMap.begin(); it != _posMap.end(); it++)
+	{
+		if (_atoms[i] != it->first)
+		{
+			same = false;
+			_atoms[i] = it->first;
+		}
+		
+		i++;
+	}
+	
+	float probe = _handler->probeRadius();
+
+	if (same && probe == _probe)
+	{
+		return;
+	}
+
+	_probe = probe;
+	_radii.resize(_atoms.size());
+	_maxRadius = 0;
+	
+	ElementLibrary &lib = ElementLibrary::library();
+
+	for (size_t i = 0; i < _atoms.size(); i++)
+	{
+		_radii[i] = lib.vdwRadius(_atoms[i]->elementSymbol());
+		_maxRadius = std::max(_maxRadius, _radii[i]);
+	}
+
+	/* most queries will reach out to the largest contact distance */
+	_contacts->setCellSize(2 * (_maxRadius + _probe));
+}
+
+void AreaMeasurer::prepareSample(size_t sample)
+{
+	_positions.resize(_atoms.size());
+	size_t i = 0;
+
+	AtomPosMap::iterator it;
+	for (it = _posMap.begin(); it != _posMap.end(); it++)
+	{
+		const WithPos &wp = it->second;
+
+		if (sample < wp.samples.size())
+		{
+			_positions[i] = wp.samples[sample];
+		}
+		else if (wp.samples.size() > 0)
+		{
+			/* ave is summed over the samples */
+			_positions[i] = wp.ave / (float)wp.samples.size();
+		}
+		else
+		{
+			_positions[i] = wp.ave;
+		}
+
+		i++;
+	}
+	
+	_contacts->updateSheet(_atoms, _positions);
+}
+
+float AreaMeasurer::atomArea(size_t idx)
+{
+	const float radius = _radii[idx] + _probe;
+	const glm::vec3 &centre = _positions[idx];
+	const float full = 4 * M_PI * radius * radius;
+
+	float reach = radius + _maxRadius + _probe;
+	const std::vector<int> &near = _contacts->atomsNear(centre, reach);
+
+	_nearX.clear();
+	_nearY.clear();
+	_nearZ.clear();
+	_nearSqRadius.clear();
+
+	for (const int &j : near)
+	{
+		if (j == (int)idx)
+		{
+			continue;
+		}
+		
+		float r = _radii[j] + _probe;
+		glm::vec3 diff = _positions[j] - centre;
+		float contact = r + radius;
+
+		if (glm::dot(diff, diff) >= contact * contact)
+		{
+			continue;
+		}
+
+		_nearX.push_back(_positions[j].x);
+		_nearY.push_back(_positions[j].y);
+		_nearZ.push_back(_positions[j].z);
+		_nearSqRadius.push_back(r * r);
+	}
+
+	if (_nearX.size() == 0)
+	{
+		return full;
+	}
+	
+	/* pad to whole chunks with neighbours which can never occlude */
+	size_t count = _nearX.size();
+	size_t padded = ((count + NEIGHBOUR_CHUNK - 1) / NEIGHBOUR_CHUNK) 
+	* NEIGHBOUR_CHUNK;
+	_nearX.resize(padded, 0);
+	_nearY.resize(padded, 0);
+	_nearZ.resize(padded, 0);
+	_nearSqRadius.resize(padded, -1);
+
+	const float *nx = &_nearX[0];
+	const float *ny = &_nearY[0];
+	const float *nz = &_nearZ[0];
+	const float *nr = &_nearSqRadius[0];
+
+	size_t exposed = 0;
+	size_t last = 0;
+
+	for (size_t k = 0; k < _unitX.size(); k++)
+	{
+		const float px = centre.x + radius * _unitX[k];
+		const float py = centre.y + radius * _unitY[k];
+		const float pz = centre.z + radius * _unitZ[k];
+		
+		/* the chunk which buried the previous point is likely to bury 
+		 * this one too, so it is checked first */
+		bool buried = false;
+
+		for (size_t c = 0; c < padded && !buried; c += NEIGHBOUR_CHUNK)
+		{
+			size_t start = (c + last) % padded;
+			int hits = 0;
+
+			for (size_t j = start; j < start + NEIGHBOUR_CHUNK; j++)
+			{
+				const float dx = px - nx[j];
+				const float dy = py - ny[j];
+				const float dz = pz - nz[j];
+				hits += (dx * dx + dy * dy + dz * dz < nr[j]);
+			}
+			
+			if (hits > 0)
+			{
+				buried = true;
+				last = start;
+			}
+		}
+
+		if (!buried)
+		{
+			exposed++;
+		}
+	}
+
+	return full * (float)exposed / (float)_unitX.size();
+}
+
 float AreaMeasurer::surfaceArea()
 {
-	_contacts->updateSheet(_posMap);
+	prepareLattice();
+	prepareAtoms();
+
+	_areas.clear();
+	_areas.resize(_atoms.size(), 0);
+
+	if (_atoms.size() == 0)
+	{
+		return 0;
+	}
+	
+	/* atoms may have been left out of some samples */
+	size_t samples = 0;
+	AtomPosMap::iterator it;
+	for (it = _posMap.begin(); it != _posMap.end(); it++)
+	{
+		samples = std::max(samples, it->second.samples.size());
+	}
+
+	if (samples == 0)
+	{
+		samples = 1;
+	}
 
-	// calculate
-	float area = 10;
+	float total = 0;
+	for (size_t s = 0; s < samples; s++)
+	{
+		prepareSample(s);
+
+		for (size_t i = 0; i < _atoms.size(); i++)
+		{
+			float area = atomArea(i) / (float)samples;
+			_areas[i] += area;
+			total += area;
+		}
+	}
+
+	return total;
+}
+
+void AreaMeasurer::copyAtomAreas(std::unordered_map<Atom *, float> &areas) const
+{
+	areas.clear();
+	areas.reserve(_atoms.size());
 
-	return area;
+	for (size_t i = 0; i < _atoms.size() && i < _areas.size(); i++)
+	{
+		areas[_atoms[i]] = _areas[i];
+	}
 }
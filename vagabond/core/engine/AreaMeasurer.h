@@ -25,6 +25,13 @@ class SurfaceAreaHandler;
 class ContactSheet;
 struct Job;
 
+/** \class AreaMeasurer
+ * \brief Shrake-Rupley surface area calculation for one job at a time.
+ *
+ * Each atom is represented by a lattice of points on a sphere of its
+ * Van der Waals radius (plus probe radius). The fraction of points which
+ * are not buried inside any neighbouring sphere gives the exposed area. */
+
 class AreaMeasurer
 {
 public:
@@ -51,14 +58,46 @@ public:
 		return _posMap;
 	}
 	
-	/** calculates surface area of previously copied atom map in Angstroms. */
+	/** number of points on each atom's sphere, used on next calculation */
+	void setPointCount(int num)
+	{
+		_pointNum = num;
+	}
+	
+	/** calculates surface area of previously copied atom map in Angstroms,
+	 *  averaged over all samples. */
 	float surfaceArea();
+	
+	/** after surfaceArea(), write per-atom areas (in Angstroms^2, averaged
+	 *  over samples) into the map provided */
+	void copyAtomAreas(std::unordered_map<Atom *, float> &areas) const;
 private:
+	void prepareAtoms();
+	void prepareLattice();
+	void prepareSample(size_t sample);
+	float atomArea(size_t idx);
+
 	Job *_job = nullptr;
 	AtomPosMap _posMap;
 
 	SurfaceAreaHandler *_handler = nullptr;
 	ContactSheet *_contacts = nullptr;
+	
+	int _pointNum = 120;
+	float _probe = -1; /* negative until radii have been looked up */
+	float _maxRadius = 0;
+
+	/* unit sphere lattice, structure of arrays */
+	std::vector<float> _unitX, _unitY, _unitZ;
+
+	/* atoms in the order used by the contact sheet */
+	std::vector<Atom *> _atoms;
+	std::vector<float> _radii;
+	std::vector<glm::vec3> _positions;
+	std::vector<float> _areas;
+
+	/* neighbours of a single atom, structure of arrays */
+	std::vector<float> _nearX, _nearY, _nearZ, _nearSqRadius;
 };
 
 #endif
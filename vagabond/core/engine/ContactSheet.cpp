@@ -17,19 +17,340 @@
 // Please email: vagabond @ hginn.co.uk for more details.
 
 #include "ContactSheet.h"
+#include <stdexcept>
+#include <cmath>
 
 ContactSheet::ContactSheet()
 {
 }
 
-void ContactSheet::updateSheet(AtomPosMap &newPositions)
+static bool is_finite(const glm::vec3 &v)
 {
-	// update any existing scratch calculations...
+	return std::isfinite(v.x) && std::isfinite(v.y) && std::isfinite(v.z);
+}
+
+void ContactSheet::setCellSize(float size)
+{
+	if (size <= 0)
+	{
+		throw std::runtime_error("Contact sheet cell size must be positive");
+	}
+
+	_cellSize = size;
+	_dirty = true;
+}
+
+void ContactSheet::updateSheet(const AtomPosMap &newPositions)
+{
+	beginUpdate(newPositions.size());
+
+	AtomPosMap::const_iterator it;
+	for (it = newPositions.begin(); it != newPositions.end(); it++)
+	{
+		/* positions in the map are summed over all samples */
+		const WithPos &wp = it->second;
+		glm::vec3 ave = wp.ave;
+		if (wp.samples.size() > 1)
+		{
+			ave /= (float)wp.samples.size();
+		}
+
+		setPosition(it->first, ave);
+	}
+
+	finishUpdate();
+}
+
+void ContactSheet::updateSheet(const AtomPosList &newPositions)
+{
+	beginUpdate(newPositions.size());
+
+	for (const AtomWithPos &awp : newPositions)
+	{
+		setPosition(awp.atom, awp.wp.ave);
+	}
+
+	finishUpdate();
+}
+
+void ContactSheet::updateSheet(const std::vector<Atom *> &atoms,
+                               const std::vector<glm::vec3> &positions)
+{
+	if (atoms.size() != positions.size())
+	{
+		throw std::runtime_error("Contact sheet given different numbers of "
+		                         "atoms and positions");
+	}
+
+	beginUpdate(atoms.size());
+
+	for (size_t i = 0; i < atoms.size(); i++)
+	{
+		setPosition(atoms[i], positions[i]);
+	}
+
+	finishUpdate();
+}
+
+void ContactSheet::beginUpdate(size_t count)
+{
+	_sameAtoms = (!_dirty && count == _atoms.size());
+	_updated = 0;
+	_atoms.resize(count);
+	_positions.resize(count);
+}
+
+void ContactSheet::setPosition(Atom *atom, const glm::vec3 &pos)
+{
+	size_t i = _updated;
+	_updated++;
+
+	if (_atoms[i] != atom)
+	{
+		_sameAtoms = false;
+		_atoms[i] = atom;
+	}
+
+	_positions[i] = pos;
+}
+
+void ContactSheet::finishUpdate()
+{
+	if (!_sameAtoms)
+	{
+		rebuild();
+		return;
+	}
+
+	/* same atoms in the same order, so the existing grid is still valid
+	 * as long as nobody has wandered too far from their cell */
+	float drift = 0;
+	for (size_t i = 0; i < _positions.size(); i++)
+	{
+		/* atoms without a usable position are left out of the grid */
+		if (is_finite(_positions[i]) != is_finite(_binned[i]))
+		{
+			rebuild();
+			return;
+		}
+		else if (!is_finite(_positions[i]))
+		{
+			continue;
+		}
+
+		glm::vec3 diff = _positions[i] - _binned[i];
+		float sqlength = glm::dot(diff, diff);
+
+		if (sqlength > drift)
+		{
+			drift = sqlength;
+		}
+	}
+
+	drift = sqrt(drift);
+
+	if (drift > _skin)
+	{
+		rebuild();
+		return;
+	}
+
+	_drift = drift;
+}
+
+void ContactSheet::rebuild()
+{
+	_binned = _positions;
+	_drift = 0;
+	_dirty = false;
+	_rebuilds++;
+
+	_lookup.clear();
+	_cellStarts.clear();
+	_cellAtoms.clear();
+
+	for (size_t i = 0; i < 3; i++)
+	{
+		_dims[i] = 0;
+	}
+
+	glm::vec3 min = glm::vec3(0.f);
+	glm::vec3 max = glm::vec3(0.f);
+	size_t binnable = 0;
+
+	for (size_t i = 0; i < _binned.size(); i++)
+	{
+		_lookup[_atoms[i]] = i;
+		
+		if (!is_finite(_binned[i]))
+		{
+			continue;
+		}
+
+		for (size_t j = 0; j < 3; j++)
+		{
+			bool first = (binnable == 0);
+			min[j] = (first ? _binned[i][j] : std::min(min[j], _binned[i][j]));
+			max[j] = (first ? _binned[i][j] : std::max(max[j], _binned[i][j]));
+		}
+
+		binnable++;
+	}
+
+	if (binnable == 0)
+	{
+		return;
+	}
+	
+	/* very sparse atoms should not produce a vast, mostly empty grid */
+	_gridSize = _cellSize;
+	size_t limit = _atoms.size() * 8 + 64;
+	size_t total = 0;
+
+	do
+	{
+		total = 1;
+		for (size_t j = 0; j < 3; j++)
+		{
+			_dims[j] = (int)floor((max[j] - min[j]) / _gridSize) + 1;
+			total *= _dims[j];
+		}
+		
+		if (total > limit)
+		{
+			_gridSize *= 2;
+		}
+	}
+	while (total > limit);
+
+	_origin = min;
+
+	/* counting sort of atom indices by cell */
+	std::vector<int> cells(_binned.size(), -1);
+	_cellStarts.resize(total + 1, 0);
+
+	for (size_t i = 0; i < _binned.size(); i++)
+	{
+		if (!is_finite(_binned[i]))
+		{
+			continue;
+		}
+
+		int c[3];
+		for (size_t j = 0; j < 3; j++)
+		{
+			c[j] = (int)floor((_binned[i][j] - _origin[j]) / _gridSize);
+			c[j] = std::max(0, std::min(c[j], _dims[j] - 1));
+		}
+
+		cells[i] = cellIndex(c[0], c[1], c[2]);
+		_cellStarts[cells[i] + 1]++;
+	}
+
+	for (size_t i = 0; i < total; i++)
+	{
+		_cellStarts[i + 1] += _cellStarts[i];
+	}
+
+	std::vector<int> fill(_cellStarts.begin(), _cellStarts.end() - 1);
+	_cellAtoms.resize(binnable);
+
+	for (size_t i = 0; i < _binned.size(); i++)
+	{
+		if (cells[i] < 0)
+		{
+			continue;
+		}
 
+		_cellAtoms[fill[cells[i]]] = i;
+		fill[cells[i]]++;
+	}
 }
 
-std::set<Atom *> ContactSheet::atomsNear(Atom *centre, float radius)
+int ContactSheet::indexOf(Atom *atom) const
 {
-	// replace empty set with nearby atoms
-	return std::set<Atom *>();
+	std::unordered_map<Atom *, int>::const_iterator it = _lookup.find(atom);
+	
+	if (it == _lookup.end())
+	{
+		return -1;
+	}
+
+	return it->second;
+}
+
+const std::vector<int> &ContactSheet::atomsNear(Atom *centre, float radius)
+{
+	int idx = indexOf(centre);
+	if (idx < 0)
+	{
+		throw std::runtime_error("Contact sheet queried with atom not in "
+		                         "the sheet");
+	}
+
+	findNeighbours(_positions[idx], radius, idx);
+	return _results;
+}
+
+const std::vector<int> &ContactSheet::atomsNear(const glm::vec3 &centre,
+                                                float radius)
+{
+	findNeighbours(centre, radius, -1);
+	return _results;
+}
+
+void ContactSheet::findNeighbours(const glm::vec3 &centre, float radius, 
+                                  int ignore)
+{
+	_results.clear();
+
+	if (_cellAtoms.size() == 0 || !is_finite(centre) || !std::isfinite(radius))
+	{
+		return;
+	}
+
+	/* binned positions may be out of date by up to _drift */
+	float reach = radius + _drift;
+	int lo[3], hi[3];
+
+	for (size_t j = 0; j < 3; j++)
+	{
+		lo[j] = (int)floor((centre[j] - reach - _origin[j]) / _gridSize);
+		hi[j] = (int)floor((centre[j] + reach - _origin[j]) / _gridSize);
+		
+		if (hi[j] < 0 || lo[j] >= _dims[j])
+		{
+			return;
+		}
+
+		lo[j] = std::max(lo[j], 0);
+		hi[j] = std::min(hi[j], _dims[j] - 1);
+	}
+
+	const float sqradius = radius * radius;
+
+	for (int z = lo[2]; z <= hi[2]; z++)
+	{
+		for (int y = lo[1]; y <= hi[1]; y++)
+		{
+			int start = _cellStarts[cellIndex(lo[0], y, z)];
+			int end = _cellStarts[cellIndex(hi[0], y, z) + 1];
+
+			/* cells along x are contiguous in _cellAtoms */
+			for (int k = start; k < end; k++)
+			{
+				int j = _cellAtoms[k];
+				if (j == ignore)
+				{
+					continue;
+				}
+
+				glm::vec3 diff = _positions[j] - centre;
+				if (glm::dot(diff, diff) <= sqradius)
+				{
+					_results.push_back(j);
+				}
+			}
+		}
+	}
 }
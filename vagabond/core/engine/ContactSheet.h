@@ -19,12 +19,23 @@
 #ifndef __vagabond__ContactSheet__
 #define __vagabond__ContactSheet__
 
-#include <set>
-#include "Atom.h"
+#include <vector>
+#include <unordered_map>
+#include "AtomPosMap.h"
+
+class Atom;
 
 /** \class ContactSheet
  * \brief class to pre-calculate and then query inter-atomic contacts
- * within a certain radius. */
+ * within a certain radius.
+ *
+ * Atoms are binned into a uniform grid of cells (a cell list). Bins are
+ * only rebuilt once an atom has drifted further than the skin distance from
+ * the position at which it was binned; until then, queries are widened by
+ * the largest drift and filtered against the current positions.
+ *
+ * Query results are written into a flat buffer owned by the sheet, which
+ * remains valid until the next query. */
 
 class ContactSheet
 {
@@ -32,15 +43,103 @@ public:
 	/** initialise contact sheet */
 	ContactSheet();
 
+	/** edge length of grid cells in Angstroms. Best set to the most common
+	 * query radius. Forces a rebuild on the next update. */
+	void setCellSize(float size);
+	
+	float cellSize() const
+	{
+		return _cellSize;
+	}
+
+	/** maximum drift (Angstroms) of any atom before the grid is rebuilt */
+	void setSkin(float skin)
+	{
+		_skin = skin;
+	}
+
 	/** when new atom positions have been obtained, update an existing contact
 	 * sheet for these positions before sending any queries. This can take
 	 * advantage of any partially-sorted existing sheet calculations as updated
-	 * atom positions will be closely related. */
-	void updateSheet(AtomPosMap &newPositions);
+	 * atom positions will be closely related. Average positions are used. */
+	void updateSheet(const AtomPosMap &newPositions);
+	void updateSheet(const AtomPosList &newPositions);
+
+	/** update from a list of atoms and a matching list of positions */
+	void updateSheet(const std::vector<Atom *> &atoms,
+	                 const std::vector<glm::vec3> &positions);
+	
+	/** finds atoms within radius of the centre atom, excluding itself.
+	 * @return indices into the sheet, see atom() and position() */
+	const std::vector<int> &atomsNear(Atom *centre, float radius);
+
+	/** finds atoms within radius of an arbitrary position.
+	 * @return indices into the sheet, see atom() and position() */
+	const std::vector<int> &atomsNear(const glm::vec3 &centre, float radius);
+	
+	/** number of atoms indexed by the sheet */
+	size_t atomCount() const
+	{
+		return _atoms.size();
+	}
+	
+	/** index of atom in sheet, or -1 if not present */
+	int indexOf(Atom *atom) const;
+
+	Atom *atom(int idx) const
+	{
+		return _atoms[idx];
+	}
+	
+	const glm::vec3 &position(int idx) const
+	{
+		return _positions[idx];
+	}
 	
-	std::set<Atom *> atomsNear(Atom *centre, float radius);
+	/** number of times the grid has been rebuilt from scratch */
+	size_t rebuildCount() const
+	{
+		return _rebuilds;
+	}
 private:
+	void beginUpdate(size_t count);
+	void setPosition(Atom *atom, const glm::vec3 &pos);
+	void finishUpdate();
+
+	void rebuild();
+	void findNeighbours(const glm::vec3 &centre, float radius, int ignore);
+
+	int cellIndex(int x, int y, int z) const
+	{
+		return x + _dims[0] * (y + _dims[1] * z);
+	}
+
+	float _cellSize = 4.f;
+	float _gridSize = 4.f;
+	float _skin = 0.5f;
+
+	/* positions as of last call to updateSheet */
+	std::vector<Atom *> _atoms;
+	std::vector<glm::vec3> _positions;
+
+	/* positions at which atoms were binned into the grid */
+	std::vector<glm::vec3> _binned;
+	std::unordered_map<Atom *, int> _lookup;
+
+	/* largest distance between current and binned position */
+	float _drift = 0;
+	bool _sameAtoms = false;
+	size_t _updated = 0;
+	bool _dirty = true;
+
+	/* grid of cells, stored as start offsets into _cellAtoms */
+	glm::vec3 _origin = glm::vec3(0.f);
+	int _dims[3] = {0, 0, 0};
+	std::vector<int> _cellStarts;
+	std::vector<int> _cellAtoms;
 
+	std::vector<int> _results;
+	size_t _rebuilds = 0;
 };
 
 #endif
@@ -20,6 +20,15 @@
 #include "AtomSegment.h"
 #include "engine/MapSumHandler.h"
 #include <vagabond/utils/maths.h>
+#include <algorithm>
+
+#define INTERPOLATION_TERMS (11)
+#define ALIGNED_TOLERANCE (1e-4)
+
+/* comparisons are correlated in chunks which stay in cache, with each
+ * sum split over lanes which can be handled as one vector */
+#define CHUNK_SIZE (256)
+#define LANES (8)
 
 Correlator::Correlator(OriginGrid<fftwf_complex> *data,
                        MapSumHandler *sumHandler)
@@ -31,6 +40,8 @@ Correlator::Correlator(OriginGrid<fftwf_complex> *data,
 void Correlator::prepareList()
 {
 	_template = _sumHandler->templateMap();
+	_values.clear();
+	std::vector<glm::vec3> positions;
 	
 	/* find minimum and maximum real-space limits of the template */
 	glm::vec3 min = _template->minBound();
@@ -78,26 +89,133 @@ void Correlator::prepareList()
 					continue;
 				}
 				
-				Comparison comp{relative_pos, value};
-				_comparisons.push_back(comp);
+				/* would never contribute to the correlation */
+				if (value != value)
+				{
+					continue;
+				}
+				
+				positions.push_back(relative_pos);
+				_values.push_back(value);
 			}
 		}
 	}
+
+	prepareLookups(positions);
+}
+
+void Correlator::prepareLookups(const std::vector<glm::vec3> &positions)
+{
+	const size_t n = positions.size();
+	const int stride = sizeof(Density) / sizeof(float);
+	_offsets.resize(INTERPOLATION_TERMS * n);
+	_weights.resize(INTERPOLATION_TERMS * n);
+	_aligned = true;
+
+	for (size_t i = 0; i < n; i++)
+	{
+		long indices[INTERPOLATION_TERMS];
+		float weights[INTERPOLATION_TERMS];
+		_template->interpolationWeights(positions[i], indices, weights);
+
+		for (size_t t = 0; t < INTERPOLATION_TERMS; t++)
+		{
+			_offsets[t * n + i] = indices[t] * stride;
+			_weights[t * n + i] = weights[t];
+		}
+
+		if (fabs(weights[0] - 1) > ALIGNED_TOLERANCE)
+		{
+			_aligned = false;
+		}
+	}
+
+	if (_aligned)
+	{
+		_offsets.resize(n);
+		_weights.clear();
+	}
+}
+
+/* weighted by the calculated density, as add_to_CD(&cd, x, y, y) */
+static void accumulate(CorrelData &cd, const float *xs, const float *ys,
+                       size_t n)
+{
+	float sums[6][LANES] = {};
+
+	for (size_t i = 0; i < n; i += LANES)
+	{
+		size_t end = std::min((size_t)LANES, n - i);
+
+		for (size_t l = 0; l < end; l++)
+		{
+			const float x = xs[i + l];
+			const float y = (ys[i + l] == ys[i + l] ? ys[i + l] : 0);
+			const float xw = x * y;
+			const float yw = y * y;
+
+			sums[0][l] += xw;
+			sums[1][l] += yw;
+			sums[2][l] += x * xw;
+			sums[3][l] += y * yw;
+			sums[4][l] += x * yw;
+			sums[5][l] += y;
+		}
+	}
+
+	for (size_t l = 0; l < LANES; l++)
+	{
+		cd.sum_x += sums[0][l];
+		cd.sum_y += sums[1][l];
+		cd.sum_xx += sums[2][l];
+		cd.sum_yy += sums[3][l];
+		cd.sum_xy += sums[4][l];
+		cd.sum_w += sums[5][l];
+	}
 }
 
 double Correlator::correlation(AtomSegment *seg)
 {
 	CorrelData cd = empty_CD();
-	int count = 0;
 
-	for (Comparison &comp : _comparisons)
+	const size_t n = _values.size();
+	const float *data = &seg->element(0).value[0];
+	float tests[CHUNK_SIZE];
+
+	for (size_t start = 0; start < n; start += CHUNK_SIZE)
 	{
-		glm::vec3 &real = comp.template_real_voxel;
-		float test = seg->interpolate(real);
-		float &val = comp.comparison_value;
-		count++;
+		const size_t count = std::min((size_t)CHUNK_SIZE, n - start);
+		const int *offsets = &_offsets[start];
+
+		if (_aligned)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				tests[i] = data[offsets[i]];
+			}
+		}
+		else
+		{
+			const float *weights = &_weights[start];
+
+			for (size_t i = 0; i < count; i++)
+			{
+				tests[i] = weights[i] * data[offsets[i]];
+			}
+
+			for (size_t t = 1; t < INTERPOLATION_TERMS; t++)
+			{
+				offsets += n;
+				weights += n;
+
+				for (size_t i = 0; i < count; i++)
+				{
+					tests[i] += weights[i] * data[offsets[i]];
+				}
+			}
+		}
 
-		add_to_CD(&cd, val, test, test);
+		accumulate(cd, &_values[start], tests, count);
 	}
 
 	return evaluate_CD(cd);
@@ -38,16 +38,23 @@ public:
 	void prepareList();
 	double correlation(AtomSegment *seg);
 private:
+	void prepareLookups(const std::vector<glm::vec3> &positions);
+
 	OriginGrid<fftwf_complex> *_density = nullptr;
 	MapSumHandler *_sumHandler = nullptr;
 	
-	struct Comparison
-	{
-		glm::vec3 template_real_voxel;
-		float comparison_value;
-	};
+	/* reference density value for each comparison */
+	std::vector<float> _values;
+
+	/* for each interpolation term in turn, a run over all comparisons of
+	 * float offsets into the template-sized segment and their weights */
+	std::vector<int> _offsets;
+	std::vector<float> _weights;
+	
+	/* all comparisons lie on template voxels, so only the first run of
+	 * offsets is used, without weights */
+	bool _aligned = false;
 
-	std::vector<Comparison> _comparisons;
 	const AtomMap *_template = nullptr;
 };
 
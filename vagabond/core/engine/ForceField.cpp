@@ -18,9 +18,11 @@
 
 #define _USE_MATH_DEFINES
 #include <math.h>
+#include <algorithm>
 #include "BondTorsion.h"
 #include "engine/ForceField.h"
 #include "engine/MechanicalBasis.h"
+#include "engine/ContactSheet.h"
 #include "ResidueId.h"
 #include "AtomGroup.h"
 #include "matrix_functions.h"
@@ -58,8 +60,11 @@ bool ForceField::isBackbone(Atom *a)
 
 void ForceField::setupVanDerWaals()
 {
-	std::cout << "Making restraints for " << this << std::endl;
 	AtomVector atoms;
+	std::vector<glm::vec3> positions;
+	
+	/* reporter is the CA of the same residue, as found by atomByIdName() */
+	std::map<int, Atom *> alphas;
 	
 	for (size_t i = 0; i < _group->size(); i++)
 	{
@@ -67,58 +72,77 @@ void ForceField::setupVanDerWaals()
 		if (isBackbone(a))
 		{
 			atoms.push_back(a);
+			positions.push_back(a->initialPosition());
+		}
+
+		int num = a->residueNumber();
+		if (a->atomName() == "CA" && a->residueId() == ResidueId(num) &&
+		    alphas.count(num) == 0)
+		{
+			alphas[num] = a;
 		}
 	}
 
-	int added = 0;
 	const double comp = 10;
 	
-	std::map<Atom *, Atom *> tmpReporters;
+	std::vector<Atom *> reporters(atoms.size(), nullptr);
 
 	for (size_t i = 0; i < atoms.size(); i++)
 	{
-		Atom &ai = *atoms[i];
-		Atom *cai = _group->atomByIdName(ResidueId(ai.residueNumber()), "CA");
-		tmpReporters[atoms[i]] = cai;
-		_reporters->add(cai);
+		auto it = alphas.find(atoms[i]->residueNumber());
+		if (it != alphas.end())
+		{
+			reporters[i] = it->second;
+		}
+
+		_reporters->add(reporters[i]);
 	}
 
-	for (size_t i = 0; i < atoms.size() - 1; i++)
+	/* only atoms in neighbouring cells can be close enough */
+	ContactSheet sheet;
+	sheet.setCellSize(comp);
+	sheet.updateSheet(atoms, positions);
+	std::vector<int> near;
+
+	for (size_t i = 0; i < atoms.size(); i++)
 	{
 		Atom &ai = *atoms[i];
-		Atom *cai = tmpReporters[&ai];
+		Atom *cai = reporters[i];
+		near.clear();
 
-		for (size_t j = i + 1; j < atoms.size(); j++)
+		for (const int &j : sheet.atomsNear(positions[i], comp))
+		{
+			if (j > (int)i)
+			{
+				near.push_back(j);
+			}
+		}
+		
+		/* keeps restraints in the same order as a search over all pairs */
+		std::sort(near.begin(), near.end());
+
+		for (const int &j : near)
 		{
 			Atom &aj = *atoms[j];
-			bool skip = false;
-			
-			int num = atoms[i]->bondsBetween(atoms[j], 5);
 
-			if (num <= 3)
+			glm::vec3 diff = positions[i] - positions[j];
+			double l = glm::dot(diff, diff);
+			
+			if (l >= (comp * comp))
 			{
 				continue;
 			}
 			
-			Atom *caj = tmpReporters[&aj];
+			int num = atoms[i]->bondsBetween(atoms[j], 5);
 
-			glm::vec3 diff = ai.initialPosition() - aj.initialPosition();
-			double l = glm::dot(diff, diff);
-			
-			if (l < (comp * comp))
+			if (num <= 3)
 			{
-				processAtoms(&ai, &aj, cai, caj);
-				added++;
-				
-				if (added % 10000 == 0)
-				{
-					_restraints.reserve(_restraints.size() + 10000);
-				}
+				continue;
 			}
+			
+			processAtoms(&ai, &aj, cai, reporters[j]);
 		}
 	}
-	
-	std::cout << "Restraints: " << _restraints.size() << std::endl;
 }
 
 float ramachandranDistance(Atom *a, Atom *b)
@@ -264,49 +288,54 @@ void ForceField::assignToAtomGroup()
 
 void ForceField::makeLookupTable()
 {
-	std::cout << "Making lookup table" << std::endl;
-	_table.clear();
-	_tableIndices.clear();
-	
-	std::map<Atom *, std::vector<LookupTable> > tmpMap;
-	int count = 0;
-	int reserve = _restraints.size();
-	_table.reserve(reserve);
+	_atomIndices.clear();
+	_atomIndices.reserve(_group->size());
 
 	for (size_t i = 0; i < _group->size(); i++)
 	{
-		Atom *a = (*_group)[i];
-		bool first = true;
-		
-		for (size_t j = 0; j < _restraints.size(); j++)
+		_atomIndices[(*_group)[i]] = i;
+	}
+
+	/* counting sort of restraint slots by atom */
+	std::vector<int> owners(_restraints.size() * 3, -1);
+	_tableStarts.clear();
+	_tableStarts.resize(_group->size() + 1, 0);
+
+	for (size_t j = 0; j < _restraints.size(); j++)
+	{
+		for (size_t n = 0; n < 3; n++)
 		{
-			Restraint &r = _restraints[j];
-			for (size_t n = 0; n < 3; n++)
+			Atom *a = _restraints[j].atoms[n];
+			auto it = (a ? _atomIndices.find(a) : _atomIndices.end());
+
+			if (it != _atomIndices.end())
 			{
-				if (r.atoms[n] == a)
-				{
-					LookupTable lt{a, j, n};
-					
-					if (first)
-					{
-						_tableIndices[a] = _table.size();
-					}
-
-					_table.push_back(lt);
-					count++;
-					
-					if (count >= reserve)
-					{
-						reserve += _restraints.size();
-						_table.reserve(reserve);
-					}
-					
-					first = false;
-				}
+				owners[j * 3 + n] = it->second;
+				_tableStarts[it->second + 1]++;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < _group->size(); i++)
+	{
+		_tableStarts[i + 1] += _tableStarts[i];
+	}
+
+	std::vector<size_t> fill(_tableStarts.begin(), _tableStarts.end() - 1);
+	_table.resize(_tableStarts.back());
+
+	for (size_t j = 0; j < _restraints.size(); j++)
+	{
+		for (size_t n = 0; n < 3; n++)
+		{
+			int owner = owners[j * 3 + n];
+			if (owner >= 0)
+			{
+				_table[fill[owner]] = LookupTable{j, n};
+				fill[owner]++;
 			}
 		}
 	}
-	std::cout << "... done." << std::endl;
 }
 
 void ForceField::updateRestraint(Restraint &r)
@@ -449,37 +478,23 @@ void ForceField::setupContributions(MechanicalBasis *mb)
 void ForceField::prepareCalculation()
 {
 	AtomPosMap::iterator it;
-	int count = 0;
 	
 	for (it = _aps.begin(); it != _aps.end(); it++)
 	{
-		Atom *a = it->first;
+		auto found = _atomIndices.find(it->first);
 		
-		if (_tableIndices.count(a))
+		if (found == _atomIndices.end())
 		{
-			size_t next = _tableIndices[a];
+			continue;
+		}
 
-			while (true)
-			{
-				LookupTable &lt = _table[next];
-				if (lt.a != a)
-				{
-					break;
-				}
-				
-				int ridx = lt.restraint_index;
-				int aidx = lt.atom_index;
-				
-				_restraints[ridx].pos[aidx] = _aps.at(a).samples[0];
-				count++;
-				
-				next++;
-				
-				if (next >= _table.size())
-				{
-					break;
-				}
-			}
+		const glm::vec3 &pos = it->second.samples[0];
+		size_t end = _tableStarts[found->second + 1];
+
+		for (size_t k = _tableStarts[found->second]; k < end; k++)
+		{
+			const LookupTable &lt = _table[k];
+			_restraints[lt.restraint_index].pos[lt.atom_index] = pos;
 		}
 	}
 
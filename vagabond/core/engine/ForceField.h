@@ -20,6 +20,7 @@
 #define __vagabond__ForceField__
 
 #include <list>
+#include <unordered_map>
 #include <vagabond/utils/svd/PCA.h>
 #include "Job.h"
 
@@ -164,13 +165,15 @@ private:
 	
 	struct LookupTable
 	{
-		Atom *a;
 		size_t restraint_index;
 		size_t atom_index;
 	};
 	
+	/* restraint slots for each atom of the group, stored together by atom:
+	 * those for atom i run from _tableStarts[i] to _tableStarts[i + 1] */
 	std::vector<LookupTable> _table;
-	std::map<Atom *, size_t> _tableIndices;
+	std::vector<size_t> _tableStarts;
+	std::unordered_map<Atom *, int> _atomIndices;
 	std::map<Atom *, float> _tmpColours;
 
 	AtomGroup *_group = nullptr;
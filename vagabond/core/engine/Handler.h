@@ -20,7 +20,10 @@
 #define __vagabond__Handler__
 
 #include <deque>
+#include <thread>
+#include <condition_variable>
 #include "engine/SimplePhore.h"
+#include "engine/LockFreeRing.h"
 #include "engine/ExpectantPhore.h"
 #include "engine/workers/ThreadWorker.h"
 #include "Job.h"
@@ -188,6 +191,202 @@ protected:
 
 	};
 	
+	/** Pool which hands objects around through a bounded lock-free ring
+	 *  instead of a mutex-guarded deque. Waiting threads spin for a while
+	 *  before parking on the pool's own semaphore, so short gaps between 
+	 *  objects do not cost a sleep/wake cycle. Pushing to a full ring waits
+	 *  for space, so the capacity must cover the number of objects in 
+	 *  circulation. */
+	template <class Object>
+	class RingPool
+	{
+	private:
+		std::atomic<int> _id{0};
+		std::atomic<bool> _finish{false};
+
+		std::vector<std::thread *> _threads;
+		std::vector<ThreadWorker *> _workers;
+		std::string _name;
+
+		LockFreeRing<Object> _ring;
+		int _spins = 2000;
+
+		/* parking semaphore for threads which have run out of spins */
+		std::atomic<int> _sleepers{0};
+		std::mutex _parking;
+		std::condition_variable _cv;
+
+		void wake(bool all)
+		{
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			if (all || _sleepers.load() > 0)
+			{
+				std::unique_lock<std::mutex> lock(_parking);
+				if (all)
+				{
+					_cv.notify_all();
+				}
+				else
+				{
+					_cv.notify_one();
+				}
+			}
+		}
+
+		void park()
+		{
+			std::unique_lock<std::mutex> lock(_parking);
+			_sleepers++;
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			while (!_finish && _ring.sizeGuess() == 0)
+			{
+				_cv.wait(lock);
+			}
+
+			_sleepers--;
+		}
+	public:
+		void setName(std::string name)
+		{
+			_name = name;
+		}
+
+		const std::string &name() const
+		{
+			return _name;
+		}
+
+		/** only call before any objects are pushed */
+		void setCapacity(size_t capacity)
+		{
+			_ring.resize(capacity);
+		}
+		
+		/** number of failed attempts to acquire before parking a thread */
+		void setSpinCount(int spins)
+		{
+			_spins = spins;
+		}
+		
+		void addWorker(ThreadWorker *worker, std::thread *thr)
+		{
+			_workers.push_back(worker);
+			_threads.push_back(thr);
+		}
+		
+		void cleanup()
+		{
+			for (size_t i = 0; i < _threads.size(); i++)
+			{
+				delete _threads[i];
+			}
+
+			for (size_t i = 0; i < _workers.size(); i++)
+			{
+				delete _workers[i];
+			}
+			
+			_threads.clear();
+			_workers.clear();
+			_ring.clear();
+
+			_finish = false;
+			_id = 0;
+		}
+		
+		void joinThreads()
+		{
+			for (size_t i = 0; i < _threads.size(); i++)
+			{
+				_threads[i]->join();
+				_workers[i]->expressTiming();
+			}
+		}
+		
+		bool finishing()
+		{
+			return _finish;
+		}
+
+		size_t threadCount()
+		{
+			return _threads.size();
+		}
+
+		size_t objectCount()
+		{
+			return _ring.sizeGuess();
+		}
+
+		void clearQueue()
+		{
+			Object obj;
+			while (_ring.tryPop(obj))
+			{
+
+			}
+		}
+
+		void acquireObject(Object &obj)
+		{
+			obj = nullptr;
+			int attempts = 0;
+
+			while (!_ring.tryPop(obj))
+			{
+				if (_finish)
+				{
+					obj = nullptr;
+					return;
+				}
+				
+				attempts++;
+				if (attempts < _spins / 2)
+				{
+					continue;
+				}
+				else if (attempts < _spins)
+				{
+					std::this_thread::yield();
+				}
+				else
+				{
+					park();
+					attempts = 0;
+				}
+			}
+		}
+
+		int pushObject(Object &obj, int *ticket = nullptr)
+		{
+			int mine = _id;
+			if (ticket != nullptr)
+			{
+				mine = ++_id;
+				*ticket = mine;
+			}
+
+			while (!_ring.tryPush(obj))
+			{
+				std::this_thread::yield();
+			}
+
+			wake(false);
+			return mine;
+		}
+
+		void finish()
+		{
+			clearQueue();
+			_finish = true;
+			wake(true);
+			joinThreads();
+			cleanup();
+		}
+	};
+	
 	class PathPool : public Pool<PathTask *>
 	{
 	private:
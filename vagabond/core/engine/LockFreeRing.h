@@ -0,0 +1,168 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// Please email: vagabond @ hginn.co.uk for more details.
+
+#ifndef __vagabond__LockFreeRing__
+#define __vagabond__LockFreeRing__
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+/** \class LockFreeRing
+ *  Bounded multi-producer, multi-consumer queue without locks. Each cell
+ *  carries a sequence number which tells producers and consumers whether
+ *  it is free to be written or ready to be read, so threads only contend
+ *  on a single compare-and-swap of the head or tail counter. */
+
+template <class T>
+class LockFreeRing
+{
+public:
+	LockFreeRing(size_t capacity = 1024)
+	{
+		resize(capacity);
+	}
+	
+	/** not thread-safe: only call when no other thread is using the ring.
+	 *  Capacity is rounded up to the next power of two. */
+	void resize(size_t capacity)
+	{
+		size_t size = 2;
+		while (size < capacity)
+		{
+			size *= 2;
+		}
+
+		_cells.reset(new Cell[size]);
+		_mask = size - 1;
+		clear();
+	}
+	
+	/** not thread-safe: only call when no other thread is using the ring. */
+	void clear()
+	{
+		for (size_t i = 0; i <= _mask; i++)
+		{
+			_cells[i].seq.store(i, std::memory_order_relaxed);
+		}
+
+		_head.store(0, std::memory_order_relaxed);
+		_tail.store(0, std::memory_order_relaxed);
+	}
+	
+	size_t capacity() const
+	{
+		return _mask + 1;
+	}
+	
+	/** approximate when other threads are pushing or popping */
+	size_t sizeGuess() const
+	{
+		size_t tail = _tail.load(std::memory_order_relaxed);
+		size_t head = _head.load(std::memory_order_relaxed);
+		return (tail > head ? tail - head : 0);
+	}
+
+	/** @return false if the ring is full */
+	bool tryPush(const T &obj)
+	{
+		Cell *cell = nullptr;
+		size_t pos = _tail.load(std::memory_order_relaxed);
+
+		while (true)
+		{
+			cell = &_cells[pos & _mask];
+			size_t seq = cell->seq.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+			if (diff == 0)
+			{
+				if (_tail.compare_exchange_weak(pos, pos + 1, 
+				                                std::memory_order_relaxed))
+				{
+					break;
+				}
+			}
+			else if (diff < 0)
+			{
+				return false;
+			}
+			else
+			{
+				pos = _tail.load(std::memory_order_relaxed);
+			}
+		}
+
+		cell->data = obj;
+		cell->seq.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	/** @return false if the ring is empty */
+	bool tryPop(T &obj)
+	{
+		Cell *cell = nullptr;
+		size_t pos = _head.load(std::memory_order_relaxed);
+
+		while (true)
+		{
+			cell = &_cells[pos & _mask];
+			size_t seq = cell->seq.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+
+			if (diff == 0)
+			{
+				if (_head.compare_exchange_weak(pos, pos + 1, 
+				                                std::memory_order_relaxed))
+				{
+					break;
+				}
+			}
+			else if (diff < 0)
+			{
+				return false;
+			}
+			else
+			{
+				pos = _head.load(std::memory_order_relaxed);
+			}
+		}
+
+		obj = cell->data;
+		cell->seq.store(pos + _mask + 1, std::memory_order_release);
+		return true;
+	}
+private:
+	struct Cell
+	{
+		std::atomic<size_t> seq;
+		T data;
+	};
+
+	std::unique_ptr<Cell[]> _cells;
+	size_t _mask = 0;
+
+	/* head and tail are kept on separate cache lines from each other */
+	char _pad0[64];
+	std::atomic<size_t> _head{0};
+	char _pad1[64];
+	std::atomic<size_t> _tail{0};
+	char _pad2[64];
+};
+
+#endif
@@ -34,20 +34,35 @@ MapSumHandler::~MapSumHandler()
 {
 	delete _template;
 	finish();
+
+	for (AtomSegment *seg : _allSegments)
+	{
+		delete seg;
+	}
+}
+
+AtomSegment *MapSumHandler::newSegment()
+{
+	AtomSegment *seg = new AtomSegment();
+
+	if (_mapHandler->elementCount() > 0)
+	{
+		seg->getDimensionsFrom(*_mapHandler->segment(0));
+		seg->setStatus(FFT<Density>::Real);
+	}
+	
+	_allSegments.push_back(seg);
+	return seg;
 }
 
 void MapSumHandler::createSegments()
 {
+	std::lock_guard<std::mutex> lock(_spareMutex);
+
 	for (size_t i = 0; i < _mapCount + 1; i++)
 	{
-		AtomSegment *seg = new AtomSegment();
+		AtomSegment *seg = newSegment();
 
-		if (_mapHandler->elementCount() > 0)
-		{
-			seg->getDimensionsFrom(*_mapHandler->segment(0));
-			seg->setStatus(FFT<Density>::Real);
-		}
-		
 		/* in order to calculate the plan once, rather than via competing
 		 *	threads later */
 		if (i == 0)
@@ -55,12 +70,33 @@ void MapSumHandler::createSegments()
 			_template = new AtomMap(*seg);
 		}
 
-		_mapPool.pushObject(seg);
+		_spare.push_back(seg);
 	}
 }
 
+AtomSegment *MapSumHandler::acquirePartial(bool force)
+{
+	std::lock_guard<std::mutex> lock(_spareMutex);
+	
+	if (_spare.size() == 0)
+	{
+		if (!force && _allSegments.size() >= _maxPartials)
+		{
+			return nullptr;
+		}
+
+		return newSegment();
+	}
+
+	AtomSegment *seg = _spare.back();
+	_spare.pop_back();
+	return seg;
+}
+
 void MapSumHandler::setup()
 {
+	/* enough for every summing thread to hold one, plus the spares */
+	_maxPartials = _mapCount + _threads + 2;
 	createSegments();
 }
 
@@ -93,11 +129,7 @@ MapSumHandler::MapJob *MapSumHandler::acquireMapJob(Job *job)
 		return _ticketMap[ticket];
 	}
 
-	AtomSegment *seg;
-	_mapPool.acquireObject(seg);
-
 	MapJob *mj = new MapJob();
-	mj->segment = seg;
 	mj->job = job;
 
 	_ticketMap[ticket] = mj;
@@ -129,33 +161,117 @@ ElementSegment *MapSumHandler::acquireElementSegment(MapJob *&mj)
 void MapSumHandler::returnSegment(AtomSegment *segment)
 {
 	segment->clear();
-	_mapPool.pushObject(segment);
+
+	std::lock_guard<std::mutex> lock(_spareMutex);
+	_spare.push_back(segment);
 }
 
-void MapSumHandler::returnMiniJob(MapJob *mj)
+void MapSumHandler::accumulateAtomically(MapJob *mj, ElementSegment *seg)
 {
-	_handout.lock();
-	mj->summed++;
-	int val = mj->summed;
-	
-	if (_ticketMap.size() > 1 && false)
-	{
-		std::cout << "Open tickets: " << _ticketMap.size() << std::endl;
+	AtomSegment *sum = nullptr;
 
-		std::map<int, MapJob *>::iterator it;
-		for (it = _ticketMap.begin(); it != _ticketMap.end(); it++)
+	{
+		std::lock_guard<std::mutex> lock(mj->mutex);
+		if (mj->segment == nullptr)
 		{
-			std::cout << "Ticket: " << it->first << " ";
-			std::cout << "total: " << it->second->summed << std::endl;
+			mj->segment = acquirePartial(true);
 		}
+
+		sum = mj->segment;
 	}
-	_handout.unlock();
 
-	if (val < _mapHandler->elementCount())
+	sum->addElementSegmentAtomically(seg);
+	_mapHandler->returnSegment(seg);
+
+	if (++mj->added == _mapHandler->elementCount())
 	{
+		finishMapJob(mj);
+	}
+}
+
+void MapSumHandler::accumulate(MapJob *mj, ElementSegment *seg)
+{
+	if (_atomic)
+	{
+		accumulateAtomically(mj, seg);
 		return;
 	}
-	
+
+	AtomSegment *partial = nullptr;
+	int count = 0;
+
+	{
+		std::unique_lock<std::mutex> lock(mj->mutex);
+
+		if (mj->pending == nullptr)
+		{
+			/* a job's first partial sum is always made, but further ones
+			 * only while under the cap */
+			partial = acquirePartial(mj->partials == 0);
+
+			if (partial != nullptr)
+			{
+				mj->partials++;
+			}
+			else
+			{
+				/* another thread is adding to this job's partial sum and 
+				 * will hand it back, as it cannot be complete without 
+				 * this segment */
+				mj->returned.wait(lock, [mj]() 
+				                  { return mj->pending != nullptr; });
+			}
+		}
+
+		if (partial == nullptr)
+		{
+			/* add to the waiting partial sum */
+			partial = mj->pending;
+			count = mj->pendingCount;
+			mj->pending = nullptr;
+			mj->pendingCount = 0;
+		}
+	}
+
+	partial->addElementSegment(seg);
+	_mapHandler->returnSegment(seg);
+	count++;
+
+	const int total = _mapHandler->elementCount();
+
+	while (count < total)
+	{
+		AtomSegment *other = nullptr;
+
+		{
+			std::lock_guard<std::mutex> lock(mj->mutex);
+
+			if (mj->pending == nullptr)
+			{
+				/* leave for the next thread to pick up */
+				mj->pending = partial;
+				mj->pendingCount = count;
+				mj->returned.notify_one();
+				return;
+			}
+
+			other = mj->pending;
+			count += mj->pendingCount;
+			mj->pending = nullptr;
+			mj->pendingCount = 0;
+			mj->partials--;
+		}
+
+		partial->addSegment(other);
+		returnSegment(other);
+	}
+
+	mj->segment = partial;
+	finishMapJob(mj);
+}
+
+void MapSumHandler::finishMapJob(MapJob *mj)
+{
 	Job *job = mj->job;
 	int ticket = job->ticket;
 
@@ -166,19 +282,13 @@ void MapSumHandler::returnMiniJob(MapJob *mj)
 	Result *r = job->result;
 	if (r == nullptr)
 	{
-		r = new Result();
-		r->setFromJob(job);
+		r = _calculator->freshResult(job);
 	}
 
 	if (job->requests & JobCalculateMapSegment) 
 	{
 		r->map = new AtomMap(*_template);
 		r->map->copyData(*mj->segment);
-		
-		if (!(job->requests & JobMapCorrelation))
-		{
-			returnSegment(mj->segment);
-		}
 	}
 	
 	if (job->requests & JobMapCorrelation)
@@ -197,6 +307,14 @@ void MapSumHandler::returnMiniJob(MapJob *mj)
 
 void MapSumHandler::finish()
 {
+	/* summing threads wait on the segment pool rather than their own, so
+	 * each one is woken with an empty segment */
+	for (size_t i = 0; i < _mapPool.threadCount(); i++)
+	{
+		ElementSegment *none = nullptr;
+		_segmentPool.pushObject(none);
+	}
+
 	_mapPool.finish();
 	_segmentPool.finish();
 }
@@ -53,16 +53,43 @@ public:
 		_threads = threads;
 	}
 	
+	/** sum every element segment of a job straight into one shared map 
+	 *  with atomic adds, instead of into partial sums. May be quicker for
+	 *  small maps or many threads. */
+	void setAtomicSum(bool atomic)
+	{
+		_atomic = atomic;
+	}
+	
 	size_t segmentCount()
 	{
-		return _mapPool.objectCount();
+		std::lock_guard<std::mutex> lock(_spareMutex);
+		return _spare.size();
+	}
+	
+	/** @returns number of partial sums made so far, in use or spare */
+	size_t partialCount()
+	{
+		std::lock_guard<std::mutex> lock(_spareMutex);
+		return _allSegments.size();
 	}
 	
 	struct MapJob
 	{
-		AtomSegment *segment;
-		Job *job;
-		std::atomic<int> summed{0};
+		AtomSegment *segment = nullptr;
+		Job *job = nullptr;
+
+		/* partial sum waiting to be combined with another */
+		AtomSegment *pending = nullptr;
+		int pendingCount = 0;
+		
+		/* partial sums belonging to this job, pending or being added to */
+		int partials = 0;
+		
+		/* element segments added when summing atomically */
+		std::atomic<int> added{0};
+		std::condition_variable returned;
+		std::mutex mutex;
 	};
 	
 	const AtomMap *templateMap()
@@ -72,7 +99,16 @@ public:
 
 	ElementSegment *acquireElementSegment(MapJob *&mj);
 	void transferElementSegment(ElementSegment *seg);
-	void returnMiniJob(MapJob *mj);
+	
+	/** adds the element segment to a partial sum for its job and returns 
+	 *  it to the map transfer handler. Partial sums held by different
+	 *  threads are added to one another in pairs as they become free, 
+	 *  until one contains every element. Once the number of partial sums
+	 *  reaches its cap, a thread waits for its job's partial sum to be 
+	 *  handed back rather than starting another. With setAtomicSum(), 
+	 *  every segment is added to one map for the job instead. */
+	void accumulate(MapJob *mj, ElementSegment *seg);
+
 	void returnSegment(AtomSegment *segment);
 	void setup();
 
@@ -81,15 +117,24 @@ public:
 private:
 	void createSegments();
 	void prepareThreads();
+	AtomSegment *newSegment();
+	AtomSegment *acquirePartial(bool force);
+	void accumulateAtomically(MapJob *mj, ElementSegment *seg);
+	void finishMapJob(MapJob *mj);
 
 	MapJob *acquireMapJob(Job *job);
 	
 	std::map<int, MapJob *> _ticketMap;
-	std::mutex _handout;
 	std::mutex _ticketHandout;
 	
 	Pool<AtomSegment *> _mapPool;
 	Pool<ElementSegment *> _segmentPool;
+	
+	/* partial sums are made when needed up to _maxPartials, beyond which
+	 * only jobs without any partial sum yet may have another */
+	std::vector<AtomSegment *> _spare;
+	std::vector<AtomSegment *> _allSegments;
+	std::mutex _spareMutex;
 
 	BondCalculator *_calculator = nullptr;
 	MapTransferHandler *_mapHandler = nullptr;
@@ -98,6 +143,8 @@ private:
 	AtomMap *_template = nullptr;
 	int _threads = 1;
 	int _mapCount = 1;
+	size_t _maxPartials = 0;
+	bool _atomic = false;
 };
 
 #endif
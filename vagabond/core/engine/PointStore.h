@@ -36,6 +36,11 @@ public:
 		return _positions[i];
 	}
 	
+	const std::vector<glm::vec3> &positions() const
+	{
+		return _positions;
+	}
+	
 	size_t positionCount() const
 	{
 		return _positions.size();
@@ -39,6 +39,19 @@ public:
 	{
 		_measureNum = measureNum;
 	}
+	
+	/** radius of solvent probe added to every atomic radius, in Angstroms.
+	 *  Default of 1.4 gives the solvent-accessible surface for water; zero
+	 *  gives the Van der Waals surface. */
+	void setProbeRadius(const float probe)
+	{
+		_probe = probe;
+	}
+	
+	const float &probeRadius() const
+	{
+		return _probe;
+	}
 
 	/** after atom position calculation, register job for area calculation */
 	void sendJobForCalculation(Job *job, AtomPosMap &aps);
@@ -68,6 +81,7 @@ private:
 
 	size_t _measureNum = 1;
 	int _threads = 1;
+	float _probe = 1.4;
 
 	Pool<AreaMeasurer *> _areaPool;
 	Pool<AreaMeasurer *> _idlePool;
@@ -19,6 +19,7 @@
 #include "engine/workers/ThreadCalculatesBondSequence.h"
 #include "BondSequenceHandler.h"
 #include "BondSequence.h"
+#include "BondCalculator.h"
 #include <iostream>
 
 ThreadCalculatesBondSequence::ThreadCalculatesBondSequence(BondSequenceHandler *h)
@@ -41,7 +42,24 @@ void ThreadCalculatesBondSequence::start()
 		
 		timeStart();
 
-		seq->calculate();
+		Job *job = seq->job();
+
+		if (job->batch != nullptr)
+		{
+			/* this chunk of the batch is calculated here in full, without
+			 * handing the sequence between threads for each vector */
+			BondCalculator *calc = _handler->calculator();
+			seq->calculateBatch(job);
+			Result *r = calc->freshResult(job);
+			seq->cleanUpToIdle();
+			job->destroy();
+			calc->submitResult(r);
+		}
+		else
+		{
+			seq->calculate();
+		}
+
 		timeEnd();
 	}
 	while (!_finish);
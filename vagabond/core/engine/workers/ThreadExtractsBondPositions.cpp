@@ -48,8 +48,7 @@ void ThreadExtractsBondPositions::extractPositions(Job *job, BondSequence *seq)
 {
 	Result *r = job->result;
 
-	const AtomPosMap &aps = seq->extractPositions();
-	r->aps = aps;
+	seq->extractFlat(r->flat);
 }
 
 void ThreadExtractsBondPositions::transferToSurfaceHandler(Job *job,
@@ -119,17 +118,17 @@ void ThreadExtractsBondPositions::start()
 		}
 		else
 		{
-			if (r == nullptr)
-			{
-				r = new Result();
-				r->setFromJob(job);
-			}
+			r = _seqHandler->calculator()->freshResult(job);
 		}
 
 		if (job->requests & JobCalculateDeviations)
 		{
 			calculateDeviation(job, seq);
 		}
+		if (job->requests & JobDeviationGradient)
+		{
+			r->gradient = seq->calculateDeviationGradient();
+		}
 		if (job->requests & JobExtractPositions)
 		{
 			extractPositions(job, seq);
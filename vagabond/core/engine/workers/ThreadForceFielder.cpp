@@ -56,7 +56,7 @@ void ThreadForceFielder::start()
 			double score = ff->score();
 			job->result->score = score;
 			
-			ff->getColours(r->aps);
+			ff->getColours(r->atomPosMap());
 		}
 
 		BondCalculator *calc = _ffHandler->calculator();
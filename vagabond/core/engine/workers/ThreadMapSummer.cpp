@@ -40,12 +40,7 @@ void ThreadMapSummer::start()
 		}
 		
 		timeStart();
-		// do stuff
-		AtomSegment *sum = mj->segment;
-		sum->addElementSegment(partial);
-
-		_mapHandler->returnSegment(partial);
-		_sumHandler->returnMiniJob(mj);
+		_sumHandler->accumulate(mj, partial);
 		timeEnd();
 	}
 	while (!_finish);
@@ -35,12 +35,7 @@ ThreadMapTransfer::ThreadMapTransfer(MapTransferHandler *h, std::string ele)
 void ThreadMapTransfer::putAtomsInMap(PointStore *store, ElementSegment *seg)
 {
 	seg->setJob(store->job());
-
-	for (size_t i = 0; i < store->positionCount(); i++)
-	{
-		const glm::vec3 &pos = store->position(i);
-		seg->addDensity(pos, 1);
-	}
+	seg->addAtoms(store->positions());
 }
 
 void ThreadMapTransfer::start()
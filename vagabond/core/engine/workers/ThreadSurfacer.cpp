@@ -61,6 +61,7 @@ void ThreadSurfacer::start()
 
 		Result *r = job->result;
 		r->surface_area = area;
+		am->copyAtomAreas(r->areas);
 		
 		sendToNext(job, am);
 		
@@ -53,6 +53,31 @@ int RingProgram::lowestAlignment()
 	return _alignmentMapping.begin()->first;
 }
 
+std::vector<int> RingProgram::alignmentIndices() const
+{
+	std::vector<int> idxs;
+
+	for (auto it = _alignmentMapping.begin(); it != _alignmentMapping.end(); 
+	     it++)
+	{
+		idxs.push_back(it->first);
+	}
+
+	return idxs;
+}
+
+std::vector<int> RingProgram::exitIndices() const
+{
+	std::vector<int> idxs;
+
+	for (const TorsionGroup &tg : _torsionGroups)
+	{
+		idxs.push_back(tg.self);
+	}
+
+	return idxs;
+}
+
 void RingProgram::addAlignmentIndex(int idx, std::string atomName)
 {
 	int cycle_idx = _cyclic.indexOfName(atomName);
@@ -218,17 +243,19 @@ void RingProgram::alignRingExit(std::vector<AtomBlock> &blocks)
 {
 	for (TorsionGroup &tg : _torsionGroups)
 	{
-		glm::vec4 self = glm::vec4(originalPosition(blocks, tg.self), 0);
-		glm::vec4 parent = glm::vec4(originalPosition(blocks, tg.parent), 0);
-		glm::vec3 gp = originalPosition(blocks, tg.gp);
+		int s_idx = tg.self + _idx;
+		glm::vec4 self = glm::vec4(originalPosition(blocks, s_idx), 0);
+		glm::vec4 parent = glm::vec4(originalPosition(blocks, tg.parent + _idx), 
+		                             0);
+		glm::vec3 gp = originalPosition(blocks, tg.gp + _idx);
 		
-		AtomBlock &mine = blocks[tg.self];
-		AtomBlock &child = blocks[tg.child];
+		AtomBlock &mine = blocks[s_idx];
+		AtomBlock &child = blocks[tg.child + _idx];
 
 		torsion_basis(mine.basis, parent, gp, self);
 		child.inherit = parent;
 		
-		mine.writeToChildren(blocks, tg.self, true);
+		mine.writeToChildren(blocks, s_idx, true);
 	}
 
 }
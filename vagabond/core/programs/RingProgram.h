@@ -91,6 +91,14 @@ public:
 
 	void run(std::vector<AtomBlock> &blocks, int rel, 
 	         const Coord::Get &coord, int n);
+
+	/** @returns blocks, relative to the trigger block, which the ring is
+	 *  aligned onto. run() moves these onto the ring as well. */
+	std::vector<int> alignmentIndices() const;
+
+	/** @returns ring members, relative to the trigger block, whose children
+	 *  are given new bases by run() on leaving the ring */
+	std::vector<int> exitIndices() const;
 	
 	void addTransformation(const glm::mat4x4 &trans);
 	void setSequence(BondSequence *seq)
@@ -131,6 +139,7 @@ private:
 		float curr_to_other = -1;
 	};
 	
+	/* block indices relative to the trigger block */
 	struct TorsionGroup
 	{
 		int child;
@@ -586,7 +586,9 @@ void RingProgrammer::makeProgram(std::vector<AtomBlock> &blocks, int prog_num,
 		}
 		*/
 		
-		prog->addBranchIndex(child, self, parent, grandparent, out);
+		prog->addBranchIndex(child - _triggerIndex, self - _triggerIndex, 
+		                     parent - _triggerIndex, 
+		                     grandparent - _triggerIndex, out);
 	}
 
 	prog->setTorsionBasis(basis);
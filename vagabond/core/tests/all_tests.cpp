@@ -17,13 +17,24 @@
 // Please email: vagabond @ hginn.co.uk for more details.
 
 #define BOOST_TEST_MODULE test_core
+#include "test_directory.h"
 #include "test_atomgroup.cpp"
 #include "test_atomsfromsequence.cpp"
+#include "test_bondsequence.cpp"
 #include "test_handler.cpp"
 #include "test_list.cpp"
 #include "test_molecule.cpp"
 #include "test_molrefiner.cpp"
 #include "test_ramachandran.cpp"
+#include "test_forcefield.cpp"
 #include "test_sequence.cpp"
+#include "test_sampler.cpp"
 #include "test_surface.cpp"
 #include "test_grid.cpp"
+#include "test_knotter.cpp"
+#include "test_snapshot.cpp"
+#include "test_geometrytable.cpp"
+#include "test_fft.cpp"
+#include "test_engine.cpp"
+
+BOOST_GLOBAL_FIXTURE(TestDirectory);
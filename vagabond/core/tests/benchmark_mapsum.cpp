@@ -0,0 +1,147 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// Please email: vagabond @ hginn.co.uk for more details.
+
+/* Throughput of summing element segments into a map for each job through
+ * MapSumHandler, comparing atomic adds into one shared map per job with
+ * partial AtomSegments which threads hand to one another until a job is 
+ * complete. */
+
+#include <vagabond/core/BondCalculator.h>
+#include <vagabond/core/ElementSegment.h>
+#include <vagabond/core/AtomSegment.h>
+#include <vagabond/core/engine/MapTransferHandler.h>
+#include <vagabond/core/engine/MapSumHandler.h>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+typedef std::chrono::steady_clock Clock;
+
+double handlerSum(BondCalculator &calc, MapTransferHandler &transfer,
+                  int jobs, int threads, bool atomic, size_t &partials)
+{
+	MapSumHandler summer(&calc);
+	summer.setAtomicSum(atomic);
+	summer.setMapHandler(&transfer);
+	summer.setThreads(threads - 1); // handler runs one more than asked
+	summer.setMapCount(threads);
+	summer.setup();
+	summer.start();
+
+	const std::vector<std::string> &elements = transfer.elements();
+	Clock::time_point start = Clock::now();
+
+	/* element segments come back to the transfer handler's pools once
+	 * summed, so feeding waits on the summing threads as in a pipeline */
+	for (int j = 0; j < jobs; j++)
+	{
+		Job *job = new Job();
+		job->ticket = j + 1;
+		job->requests = JobNotSpecified;
+
+		for (const std::string &ele : elements)
+		{
+			ElementSegment *seg = transfer.acquireSegment(ele);
+			seg->setJob(job);
+			summer.transferElementSegment(seg);
+		}
+	}
+
+	int done = 0;
+	while (done < jobs)
+	{
+		Result *r = calc.acquireResult();
+
+		if (r == nullptr)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		calc.recycleResult(r);
+		done++;
+	}
+
+	double secs = std::chrono::duration<double>(Clock::now() - start).count();
+
+	partials = summer.partialCount();
+	summer.finish();
+
+	return secs;
+}
+
+int main(int argc, char **argv)
+{
+	int dim = 64;
+	int jobs = 32;
+	if (argc > 1)
+	{
+		dim = atoi(argv[1]);
+	}
+
+	BondCalculator calc;
+	MapTransferHandler transfer(&calc);
+	
+	/* one element segment per element for every job */
+	std::map<std::string, int> elements;
+	const char *symbols[] = {"H", "C", "N", "O", "S", "P", "F"};
+	int count = sizeof(symbols) / sizeof(symbols[0]);
+
+	for (int i = 0; i < count; i++)
+	{
+		elements[symbols[i]] = 1;
+	}
+
+	/* atom-free transfer handler covers a 4 Angstrom padded box */
+	transfer.supplyAtomGroup(std::vector<Atom *>());
+	transfer.supplyElementList(elements);
+	transfer.setCubeDim(4.f / (dim - 1));
+	transfer.setup();
+
+	const ElementSegment *seg = transfer.segment(0);
+	double voxels = (double)seg->nn() * count * jobs;
+
+	std::cout << "voxels summed per second, " << jobs << " jobs of " 
+	<< count << " segments of " << seg->nx() << "x" << seg->ny() << "x" 
+	<< seg->nz() << std::endl;
+	std::cout << std::setw(8) << "threads";
+	std::cout << std::setw(16) << "atomic";
+	std::cout << std::setw(16) << "partial";
+	std::cout << std::setw(10) << "ratio";
+	std::cout << std::setw(10) << "partials" << std::endl;
+
+	for (int threads = 1; threads <= 64; threads *= 2)
+	{
+		size_t partials = 0;
+		double atomic = voxels / handlerSum(calc, transfer, jobs, threads,
+		                                    true, partials);
+		double handler = voxels / handlerSum(calc, transfer, jobs, threads,
+		                                     false, partials);
+
+		std::cout << std::setw(8) << threads;
+		std::cout << std::setw(16) << (size_t)atomic;
+		std::cout << std::setw(16) << (size_t)handler;
+		std::cout << std::setw(10) << std::setprecision(3) 
+		<< handler / atomic;
+		std::cout << std::setw(10) << partials << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,152 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// Please email: vagabond @ hginn.co.uk for more details.
+
+/* Throughput of objects handed from producer threads to consumer threads
+ * through the mutex-guarded Pool and the lock-free RingPool. Each round
+ * uses the same number of producers and consumers. */
+
+#include <vagabond/core/engine/Handler.h>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+class PoolBenchmark : public Handler
+{
+public:
+	template <class P>
+	class Consumer : public ThreadWorker
+	{
+	public:
+		Consumer(P *pool, std::atomic<size_t> *count)
+		{
+			_pool = pool;
+			_count = count;
+		}
+
+		virtual void start()
+		{
+			int *obj = nullptr;
+			do
+			{
+				_pool->acquireObject(obj);
+				if (obj == nullptr)
+				{
+					break;
+				}
+
+				(*_count)++;
+			}
+			while (true);
+		}
+
+		virtual std::string type()
+		{
+			return "Consumer";
+		}
+	private:
+		P *_pool;
+		std::atomic<size_t> *_count;
+	};
+
+	template <class P>
+	static double run(P &pool, int threads, size_t total)
+	{
+		std::atomic<size_t> count{0};
+		std::vector<int> objects(256);
+		size_t each = total / threads;
+
+		for (int i = 0; i < threads; i++)
+		{
+			Consumer<P> *worker = new Consumer<P>(&pool, &count);
+			std::thread *thr = new std::thread(&Consumer<P>::start, worker);
+			pool.addWorker(worker, thr);
+		}
+
+		std::chrono::steady_clock::time_point start;
+		start = std::chrono::steady_clock::now();
+
+		std::vector<std::thread *> producers;
+		for (int i = 0; i < threads; i++)
+		{
+			producers.push_back(new std::thread([&pool, &objects, each, i]()
+			{
+				for (size_t j = 0; j < each; j++)
+				{
+					int *obj = &objects[(i + j) % objects.size()];
+					pool.pushObject(obj);
+				}
+			}));
+		}
+
+		for (std::thread *thr : producers)
+		{
+			thr->join();
+			delete thr;
+		}
+
+		while (count < each * threads)
+		{
+			std::this_thread::yield();
+		}
+
+		std::chrono::steady_clock::time_point end;
+		end = std::chrono::steady_clock::now();
+		pool.finish();
+
+		double secs = std::chrono::duration<double>(end - start).count();
+		return (double)(each * threads) / secs;
+	}
+
+	static void compare(int threads, size_t total)
+	{
+		Pool<int *> pool;
+		double locked = run(pool, threads, total);
+
+		RingPool<int *> ring;
+		ring.setCapacity(4096);
+		double lockfree = run(ring, threads, total);
+
+		std::cout << std::setw(8) << threads;
+		std::cout << std::setw(16) << (size_t)locked;
+		std::cout << std::setw(16) << (size_t)lockfree;
+		std::cout << std::setw(10) << std::setprecision(3) 
+		<< lockfree / locked << std::endl;
+	}
+};
+
+int main(int argc, char **argv)
+{
+	size_t total = 1000000;
+	if (argc > 1)
+	{
+		total = atol(argv[1]);
+	}
+
+	std::cout << "objects per second" << std::endl;
+	std::cout << std::setw(8) << "threads";
+	std::cout << std::setw(16) << "Pool";
+	std::cout << std::setw(16) << "RingPool";
+	std::cout << std::setw(10) << "ratio" << std::endl;
+
+	for (int threads = 1; threads <= 64; threads *= 2)
+	{
+		PoolBenchmark::compare(threads, total);
+	}
+
+	return 0;
+}
@@ -22,10 +22,10 @@ int check_vecs(std::string name)
 	
 	Result *result = calculator.acquireResult();
 	std::cout << "Ticket: " << result->ticket << std::endl;
-	std::cout << "Atom count: " << result->aps.size() << std::endl;
+	std::cout << "Atom count: " << result->atomPosMap().size() << std::endl;
 	
 	AtomPosMap::iterator it;
-	for (it = result->aps.begin(); it != result->aps.end(); it++)
+	for (it = result->atomPosMap().begin(); it != result->atomPosMap().end(); it++)
 	{
 		Atom *a = it->first;
 		glm::vec3 v = it->second.ave;
@@ -0,0 +1,578 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// Please email: vagabond @ hginn.co.uk for more details.
+
+#include <vagabond/utils/include_boost.h>
+
+#include <vagabond/core/AtomGroup.h>
+#include <vagabond/core/Sequence.h>
+#include <vagabond/core/BondCalculator.h>
+#include <vagabond/core/Sampler.h>
+#include <vagabond/core/LBFGSEngine.h>
+#include <vagabond/core/TorsionBasis.h>
+#include <climits>
+
+namespace tt = boost::test_tools;
+
+AtomPosMap sampledPositions(AtomGroup *grp, bool pack)
+{
+	Sampler sampler(8, 2);
+
+	BondCalculator calc;
+	calc.setPipelineType(BondCalculator::PipelineAtomPositions);
+	calc.setMaxSimultaneousThreads(1);
+	calc.setTorsionBasisType(TorsionBasis::TypeConcerted);
+	calc.setSampler(&sampler);
+	calc.setPackBlocks(pack);
+	calc.addAnchorExtension(grp->chosenAnchor());
+	calc.setup();
+	calc.start();
+
+	Job job{};
+	job.custom.allocate_vectors(1, 2, sampler.pointCount());
+	job.custom.vecs[0].mean[0] = 20;
+	job.custom.vecs[0].mean[1] = -10;
+	job.requests = JobExtractPositions;
+	calc.submitJob(job);
+
+	Result *r = calc.acquireResult();
+	AtomPosMap aps = r->atomPosMap();
+	r->destroy();
+	calc.finish();
+
+	return aps;
+}
+
+BOOST_AUTO_TEST_CASE(packed_blocks_match_unpacked_blocks)
+{
+	Sequence seq("vspyl");
+	AtomGroup *grp = seq.convertToAtoms();
+	
+	AtomPosMap packed = sampledPositions(grp, true);
+	AtomPosMap unpacked = sampledPositions(grp, false);
+
+	BOOST_TEST(packed.size() == unpacked.size());
+	
+	int mismatches = 0;
+	for (auto it = unpacked.begin(); it != unpacked.end(); it++)
+	{
+		const std::vector<glm::vec3> &expected = it->second.samples;
+		const std::vector<glm::vec3> &found = packed[it->first].samples;
+		BOOST_TEST(expected.size() == found.size());
+
+		for (size_t i = 0; i < expected.size() && i < found.size(); i++)
+		{
+			if (expected[i] != found[i])
+			{
+				mismatches++;
+			}
+		}
+	}
+
+	BOOST_TEST(mismatches == 0);
+
+	delete grp;
+}
+
+/* every torsion from the compiled flat table should match the torsion
+ * found through valueForParameter(), for random custom vectors of up to
+ * dims parameters */
+void compareCompiledTorsions(TorsionBasis::Type type, int dims)
+{
+	Sequence seq("vspyl");
+	AtomGroup *grp = seq.convertToAtoms();
+
+	Sampler sampler(1, 2);
+	BondCalculator calc;
+	calc.setPipelineType(BondCalculator::PipelineAtomPositions);
+	calc.setMaxSimultaneousThreads(1);
+	calc.setTorsionBasisType(type);
+	calc.setSampler(&sampler);
+	calc.addAnchorExtension(grp->chosenAnchor());
+	calc.setup();
+	calc.start();
+
+	TorsionBasis *basis = calc.torsionBasis();
+	BondSequence *bs = calc.sequence();
+	const int n = std::min((int)basis->parameterCount(), dims);
+	BOOST_REQUIRE(n > 0);
+
+	CompiledTorsions compiled;
+	BOOST_REQUIRE(basis->compile(compiled, n));
+	BOOST_TEST(compiled.reference.size() == basis->parameterCount());
+
+	srand(3);
+	std::vector<float> vec(n);
+	std::vector<float> torsions(compiled.reference.size());
+
+	for (size_t trial = 0; trial < 20; trial++)
+	{
+		for (size_t i = 0; i < n; i++)
+		{
+			vec[i] = (rand() / (double)RAND_MAX) * 60 - 30;
+		}
+
+		Coord::Get coord = Coord::fromVector(vec);
+		compiled.evaluate(vec.data(), torsions.data());
+
+		for (size_t i = 0; i < torsions.size(); i++)
+		{
+			float expected = basis->valueForParameter(bs, i, coord, n)(coord);
+			BOOST_TEST(torsions[i] == expected, tt::tolerance(1e-4f));
+		}
+	}
+
+	calc.finish();
+	delete grp;
+}
+
+BOOST_AUTO_TEST_CASE(compiled_simple_torsions_match_uncompiled_torsions)
+{
+	/* simple bases are always given one parameter per torsion */
+	compareCompiledTorsions(TorsionBasis::TypeSimple, INT_MAX);
+}
+
+BOOST_AUTO_TEST_CASE(compiled_concerted_torsions_match_uncompiled_torsions)
+{
+	compareCompiledTorsions(TorsionBasis::TypeConcerted, 6);
+}
+
+BOOST_AUTO_TEST_CASE(batch_matches_individual_jobs)
+{
+	Sequence seq("vspyl");
+	AtomGroup *grp = seq.convertToAtoms();
+
+	BondCalculator calc;
+	calc.setPipelineType(BondCalculator::PipelineAtomPositions);
+	calc.setMaxSimultaneousThreads(2);
+	calc.setTorsionBasisType(TorsionBasis::TypeConcerted);
+	calc.addAnchorExtension(grp->chosenAnchor());
+	calc.setup();
+	calc.start();
+
+	Batch batch;
+	batch.requests = JobPositionVector;
+	batch.allocate(3, 2);
+	for (size_t i = 0; i < batch.count; i++)
+	{
+		batch.vector(i)[0] = 10 * i;
+		batch.vector(i)[1] = -5 * i;
+	}
+
+	calc.submitBatch(batch);
+	calc.retrieveBatch(batch);
+	BOOST_TEST(batch.atoms > 0);
+
+	for (size_t i = 0; i < batch.count; i++)
+	{
+		Job job{};
+		job.custom.allocate_vectors(1, 2, 0);
+		job.custom.vecs[0].mean[0] = batch.vector(i)[0];
+		job.custom.vecs[0].mean[1] = batch.vector(i)[1];
+		job.requests = JobPositionVector;
+		calc.submitJob(job);
+
+		Result *r = calc.acquireResult();
+		BOOST_TEST(r->apl.size() == batch.atoms);
+
+		int mismatches = 0;
+		for (size_t j = 0; j < r->apl.size() && j < batch.atoms; j++)
+		{
+			if (r->apl[j].wp.ave != batch.position(i, j))
+			{
+				mismatches++;
+			}
+		}
+
+		BOOST_TEST(mismatches == 0);
+		calc.recycleResult(r);
+	}
+
+	calc.finish();
+	delete grp;
+}
+
+BOOST_AUTO_TEST_CASE(looped_batch_deviations_match_individual_jobs)
+{
+	Sequence seq("vspyl");
+	AtomGroup *grp = seq.convertToAtoms();
+
+	BondCalculator calc;
+	calc.setPipelineType(BondCalculator::PipelineAtomPositions);
+	calc.setMaxSimultaneousThreads(2);
+	calc.addAnchorExtension(grp->chosenAnchor());
+	calc.setup();
+	calc.start();
+
+	size_t n = calc.maxCustomVectorSize();
+	Batch batch;
+	batch.requests = JobCalculateDeviations;
+	batch.allocate(4, n);
+	for (size_t i = 0; i < batch.count; i++)
+	{
+		for (size_t j = 0; j < n; j++)
+		{
+			batch.vector(i)[j] = 5 * i * cos(j);
+		}
+	}
+
+	calc.submitBatch(batch);
+	calc.retrieveBatch(batch);
+	BOOST_TEST(batch.looped);
+	BOOST_TEST(batch.deviations.size() == batch.count);
+
+	for (size_t i = 0; i < batch.count; i++)
+	{
+		Job job{};
+		job.custom.allocate_vectors(1, n, 0);
+		for (size_t j = 0; j < n; j++)
+		{
+			job.custom.vecs[0].mean[j] = batch.vector(i)[j];
+		}
+
+		job.requests = JobCalculateDeviations;
+		calc.submitJob(job);
+
+		Result *r = calc.acquireResult();
+		BOOST_TEST(r->deviation == batch.deviations[i]);
+		calc.recycleResult(r);
+	}
+
+	calc.finish();
+	delete grp;
+}
+
+BOOST_AUTO_TEST_CASE(batch_keeps_results_of_other_jobs)
+{
+	Sequence seq("vspyl");
+	AtomGroup *grp = seq.convertToAtoms();
+
+	BondCalculator calc;
+	calc.setPipelineType(BondCalculator::PipelineAtomPositions);
+	calc.setMaxSimultaneousThreads(2);
+	calc.addAnchorExtension(grp->chosenAnchor());
+	calc.setup();
+	calc.start();
+
+	size_t n = calc.maxCustomVectorSize();
+	Job job{};
+	job.custom.allocate_vectors(1, n, 0);
+	job.requests = JobCalculateDeviations;
+	int ticket = calc.submitJob(job);
+
+	Batch batch;
+	batch.requests = JobCalculateDeviations;
+	batch.allocate(5, n);
+	for (size_t i = 0; i < batch.count; i++)
+	{
+		for (size_t j = 0; j < n; j++)
+		{
+			batch.vector(i)[j] = 3 * i * sin(j);
+		}
+	}
+
+	calc.submitBatch(batch);
+	calc.retrieveBatch(batch);
+
+	/* the lone job's result must still be waiting after the batch */
+	Result *r = calc.acquireResult();
+	BOOST_REQUIRE(r != nullptr);
+	BOOST_TEST(r->ticket == ticket);
+	calc.recycleResult(r);
+
+	calc.finish();
+	delete grp;
+}
+
+std::vector<glm::vec3> positionsAfterChanges(AtomGroup *grp, bool skip,
+                                             Sampler *sampler = nullptr)
+{
+	BondCalculator calc;
+	calc.setPipelineType(BondCalculator::PipelineAtomPositions);
+	calc.setMaxSimultaneousThreads(1);
+	calc.setSkipUnchanged(skip);
+	calc.setSampler(sampler);
+	calc.addAnchorExtension(grp->chosenAnchor());
+	calc.setup();
+	calc.start();
+
+	size_t n = calc.maxCustomVectorSize();
+	int samples = (sampler ? sampler->pointCount() : 0);
+	std::vector<glm::vec3> all;
+
+	/* the same vector is reused for every job */
+	Job job{};
+	job.custom.allocate_vectors(1, n, samples);
+	job.borrowed = true;
+	job.requests = JobExtractPositions;
+
+	/* first job sets everything up, then each parameter moves in turn, 
+	 * including the hyper-values of the proline ring */
+	for (size_t i = 0; i <= n; i++)
+	{
+		if (i > 0)
+		{
+			job.custom.vecs[0].mean[i - 1] = 15;
+		}
+
+		calc.submitJob(job);
+
+		Result *r = calc.acquireResult();
+		AtomPosMap aps = r->atomPosMap();
+		for (auto it = aps.begin(); it != aps.end(); it++)
+		{
+			all.insert(all.end(), it->second.samples.begin(),
+			           it->second.samples.end());
+		}
+		r->destroy();
+	}
+
+	job.custom.destroy_vectors();
+	calc.finish();
+	return all;
+}
+
+void compareSkippedToFull(AtomGroup *grp, Sampler *sampler = nullptr)
+{
+	std::vector<glm::vec3> skipped = positionsAfterChanges(grp, true, sampler);
+	std::vector<glm::vec3> full = positionsAfterChanges(grp, false, sampler);
+
+	BOOST_TEST(skipped.size() == full.size());
+
+	float worst = 0;
+	for (size_t i = 0; i < skipped.size() && i < full.size(); i++)
+	{
+		worst = std::max(worst, glm::length(skipped[i] - full[i]));
+	}
+
+	BOOST_TEST(worst < 1e-4);
+}
+
+BOOST_AUTO_TEST_CASE(skipping_unchanged_blocks_matches_full_calculation)
+{
+	Sequence seq("vspyl");
+	AtomGroup *grp = seq.convertToAtoms();
+	
+	compareSkippedToFull(grp);
+
+	delete grp;
+}
+
+BOOST_AUTO_TEST_CASE(skipping_unchanged_blocks_matches_for_many_samples)
+{
+	Sequence seq("vspyl");
+	AtomGroup *grp = seq.convertToAtoms();
+	Sampler sampler(8, 2);
+	
+	compareSkippedToFull(grp, &sampler);
+
+	delete grp;
+}
+
+double deviationAt(BondCalculator &calc, const std::vector<float> &vec,
+                   std::vector<float> *grad = nullptr)
+{
+	Job job{};
+	job.custom.allocate_vectors(1, vec.size(), 0);
+	for (size_t i = 0; i < vec.size(); i++)
+	{
+		job.custom.vecs[0].mean[i] = vec[i];
+	}
+
+	job.requests = JobCalculateDeviations;
+	if (grad != nullptr)
+	{
+		job.requests = (JobType)(JobCalculateDeviations | JobDeviationGradient);
+	}
+
+	calc.submitJob(job);
+
+	Result *r = calc.acquireResult();
+	double dev = r->deviation;
+	if (grad != nullptr)
+	{
+		*grad = r->gradient;
+	}
+	r->destroy();
+
+	return dev;
+}
+
+BOOST_AUTO_TEST_CASE(deviation_gradient_matches_finite_differences)
+{
+	Sequence seq("hlan");
+	AtomGroup *grp = seq.convertToAtoms();
+
+	BondCalculator calc;
+	calc.setPipelineType(BondCalculator::PipelineAtomPositions);
+	calc.setMaxSimultaneousThreads(1);
+	calc.setSuperpose(false);
+	calc.addAnchorExtension(grp->chosenAnchor());
+	calc.setup();
+	calc.start();
+
+	size_t n = calc.maxCustomVectorSize();
+	std::vector<float> start(n);
+	for (size_t i = 0; i < n; i++)
+	{
+		start[i] = 10 * sin(i);
+	}
+
+	std::vector<float> grad;
+	deviationAt(calc, start, &grad);
+	BOOST_TEST(grad.size() == n);
+
+	const float h = 0.05;
+	for (size_t i = 0; i < n && i < grad.size(); i++)
+	{
+		std::vector<float> plus = start, minus = start;
+		plus[i] += h;
+		minus[i] -= h;
+
+		double diff = (deviationAt(calc, plus) - deviationAt(calc, minus)) / (2 * h);
+		BOOST_TEST(fabs(grad[i] - diff) < 1e-4 + 1e-2 * fabs(diff));
+	}
+
+	calc.finish();
+	delete grp;
+}
+
+BOOST_AUTO_TEST_CASE(deviation_gradient_is_empty_with_ring_programs)
+{
+	Sequence seq("vspyl");
+	AtomGroup *grp = seq.convertToAtoms();
+
+	BondCalculator calc;
+	calc.setPipelineType(BondCalculator::PipelineAtomPositions);
+	calc.setMaxSimultaneousThreads(1);
+	calc.setSuperpose(false);
+	calc.addAnchorExtension(grp->chosenAnchor());
+	calc.setup();
+	calc.start();
+
+	std::vector<float> grad;
+	std::vector<float> start(calc.maxCustomVectorSize(), 10);
+	deviationAt(calc, start, &grad);
+	BOOST_TEST(grad.size() == 0);
+
+	calc.finish();
+	delete grp;
+}
+
+/* scores deviations of the sequence away from a displaced starting point */
+class DeviationRunner : public RunsEngine
+{
+public:
+	DeviationRunner(BondCalculator *calc, const std::vector<float> &offset)
+	{
+		_calc = calc;
+		_offset = offset;
+	}
+
+	virtual size_t parameterCount()
+	{
+		return _offset.size();
+	}
+
+	virtual int sendJob(const std::vector<float> &all)
+	{
+		std::vector<float> vec = _offset;
+		for (size_t i = 0; i < vec.size(); i++)
+		{
+			vec[i] += all[i];
+		}
+
+		std::vector<float> grad;
+		int ticket = getNextTicket();
+		double dev = deviationAt(*_calc, vec, gradientsWanted() ? &grad : 
+		                         nullptr);
+		setScoreForTicket(ticket, dev);
+
+		if (grad.size() == vec.size())
+		{
+			_supplied = true;
+			setGradientForTicket(ticket, grad);
+		}
+
+		return ticket;
+	}
+
+	virtual bool returnsGradients()
+	{
+		return _supplied;
+	}
+
+	const int &lastTicket() const
+	{
+		return getLastTicket();
+	}
+private:
+	BondCalculator *_calc;
+	std::vector<float> _offset;
+	bool _supplied = false;
+};
+
+void refineWithLBFGS(const std::string &residues, bool analytic)
+{
+	Sequence seq(residues);
+	AtomGroup *grp = seq.convertToAtoms();
+
+	BondCalculator calc;
+	calc.setPipelineType(BondCalculator::PipelineAtomPositions);
+	calc.setMaxSimultaneousThreads(1);
+	calc.setSuperpose(false);
+	calc.addAnchorExtension(grp->chosenAnchor());
+	calc.setup();
+	calc.start();
+
+	std::vector<float> offset(calc.maxCustomVectorSize());
+	for (size_t i = 0; i < offset.size(); i++)
+	{
+		offset[i] = 5 * sin(i);
+	}
+
+	DeviationRunner runner(&calc, offset);
+	LBFGSEngine engine(&runner);
+	engine.setStepSize(2);
+	engine.setMaxRuns(200);
+	engine.start();
+
+	BOOST_TEST(engine.improved());
+	BOOST_TEST(runner.returnsGradients() == analytic);
+
+	/* no gradients left behind for tickets which were never read */
+	int left = 0;
+	std::vector<float> grad;
+	for (int i = 0; i <= runner.lastTicket(); i++)
+	{
+		left += runner.gradientForTicket(i, grad);
+	}
+
+	BOOST_TEST(left == 0);
+	calc.finish();
+	delete grp;
+}
+
+BOOST_AUTO_TEST_CASE(lbfgs_refines_with_analytic_gradients)
+{
+	refineWithLBFGS("hlan", true);
+}
+
+BOOST_AUTO_TEST_CASE(lbfgs_refines_proline_with_finite_differences)
+{
+	refineWithLBFGS("vspyl", false);
+}
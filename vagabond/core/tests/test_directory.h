@@ -0,0 +1,85 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// Please email: vagabond @ hginn.co.uk for more details.
+
+#ifndef __vagabond__test_directory__
+#define __vagabond__test_directory__
+
+#include <vagabond/utils/include_boost.h>
+#include <vagabond/utils/FileReader.h>
+#include <vagabond/core/FFTPlanner.h>
+#include <vagabond/core/AtomSnapshot.h>
+#include <cstdlib>
+#include <cstdio>
+#include <unistd.h>
+
+/* temporary directory for the whole test run, which takes the files that
+ * would otherwise go to the user's cache directory, and is removed with
+ * its contents at the end */
+struct TestDirectory
+{
+	TestDirectory()
+	{
+		char name[] = "/tmp/rope_tests_XXXXXX";
+		if (mkdtemp(name) != nullptr)
+		{
+			path() = name;
+		}
+
+		FFTPlanner::setWisdomFile(file("rope.fftw_wisdom"));
+		AtomSnapshot::setDirectory(file("snapshots"));
+	}
+
+	~TestDirectory()
+	{
+		if (path().length())
+		{
+			removeAll(path());
+		}
+	}
+
+	/* path for a file within the directory, or empty if there is none */
+	static std::string file(std::string name)
+	{
+		return (path().length() ? path() + "/" + name : "");
+	}
+
+	static std::string &path()
+	{
+		static std::string dir;
+		return dir;
+	}
+
+	static void removeAll(std::string dir)
+	{
+		for (const std::string &entry : glob_pattern(dir + "/*"))
+		{
+			if (is_directory(entry))
+			{
+				removeAll(entry);
+			}
+			else
+			{
+				remove(entry.c_str());
+			}
+		}
+
+		rmdir(dir.c_str());
+	}
+};
+
+#endif
@@ -0,0 +1,85 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// Please email: vagabond @ hginn.co.uk for more details.
+
+#include <vagabond/utils/include_boost.h>
+
+#include <vagabond/core/CMAESEngine.h>
+
+namespace tt = boost::test_tools;
+
+/* scores a weighted sum of squares about a fixed minimum */
+class QuadraticRunner : public RunsEngine
+{
+public:
+	QuadraticRunner(const std::vector<float> &minimum)
+	{
+		_minimum = minimum;
+	}
+
+	virtual size_t parameterCount()
+	{
+		return _minimum.size();
+	}
+
+	virtual int sendJob(const std::vector<float> &all)
+	{
+		double sum = 0;
+		for (size_t i = 0; i < _minimum.size(); i++)
+		{
+			double diff = all[i] - _minimum[i];
+			sum += (i + 1) * diff * diff;
+		}
+
+		int ticket = getNextTicket();
+		setScoreForTicket(ticket, sum);
+		_calls++;
+		return ticket;
+	}
+
+	const int &calls() const
+	{
+		return _calls;
+	}
+private:
+	std::vector<float> _minimum;
+	int _calls = 0;
+};
+
+BOOST_AUTO_TEST_CASE(cmaes_converges_on_quadratic)
+{
+	std::vector<float> minimum = {2, -1, 0.5, 3, -2.5, 1};
+	QuadraticRunner runner(minimum);
+
+	CMAESEngine engine(&runner);
+	engine.setPopulation(8);
+	engine.setStepSize(1);
+	engine.setMaxRuns(4000);
+	engine.start();
+
+	BOOST_TEST(engine.improved());
+	BOOST_TEST(engine.bestScore() < 1e-4);
+	BOOST_TEST(runner.calls() <= 4000 + 2 * 8);
+
+	const std::vector<float> &best = engine.bestResult();
+	BOOST_REQUIRE(best.size() == minimum.size());
+
+	for (size_t i = 0; i < minimum.size(); i++)
+	{
+		BOOST_TEST(best[i] == minimum[i], tt::tolerance(0.05f));
+	}
+}
@@ -0,0 +1,149 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Please email: vagabond @ hginn.co.uk for more details.
+
+#include <vagabond/utils/include_boost.h>
+
+#include <vagabond/core/ElementSegment.h>
+#include <vagabond/core/FFTPlanner.h>
+#include "test_directory.h"
+#include <vagabond/utils/FileReader.h>
+#include <algorithm>
+#include <cstdio>
+#include <cmath>
+
+namespace tt = boost::test_tools;
+
+ElementSegment *planned_segment(int n)
+{
+	ElementSegment *seg = new ElementSegment();
+	seg->setDimensions(n, n, n);
+	seg->setRealDim(0.7);
+	seg->setOrigin(glm::vec3(0.f));
+	seg->setElement("N");
+	seg->setStatus(FFT<VoxelElement>::Real);
+	seg->makePlans();
+
+	return seg;
+}
+
+/* dimensions no other test uses, so plans are made here first */
+BOOST_AUTO_TEST_CASE(fft_plans_are_reused_for_same_dimensions)
+{
+	std::string previous = FFTPlanner::wisdomFile();
+	std::string filename = TestDirectory::file("test_fft.fftw_wisdom");
+	FFTPlanner::setWisdomFile(filename);
+
+	ElementSegment *first = planned_segment(13);
+	ElementSegment *second = planned_segment(13);
+	ElementSegment *other = planned_segment(15);
+
+	BOOST_REQUIRE(first->plan().forward != nullptr);
+	BOOST_TEST(first->hasRealPlan());
+
+	BOOST_TEST(second->plan().forward == first->plan().forward);
+	BOOST_TEST(second->plan().backward == first->plan().backward);
+	BOOST_TEST(second->plan().real_forward == first->plan().real_forward);
+	BOOST_TEST(second->plan().real_backward == first->plan().real_backward);
+
+	BOOST_TEST(other->plan().forward != first->plan().forward);
+
+	delete first;
+	delete second;
+	delete other;
+	remove(filename.c_str());
+	FFTPlanner::setWisdomFile(previous);
+}
+
+BOOST_AUTO_TEST_CASE(fft_wisdom_is_saved_and_loaded)
+{
+	std::string previous = FFTPlanner::wisdomFile();
+	std::string filename = TestDirectory::file("test_fft.fftw_wisdom");
+	remove(filename.c_str());
+
+	FFTPlanner::setWisdomFile(filename);
+	ElementSegment *seg = planned_segment(17);
+	BOOST_TEST(file_exists(filename));
+
+	std::unique_lock<std::mutex> lock(FFTPlanner::mutex());
+	FFTPlanner::setWisdomFile(filename);
+	BOOST_TEST(FFTPlanner::importWisdom());
+
+	/* only read once per file */
+	BOOST_TEST(!FFTPlanner::importWisdom());
+	lock.unlock();
+
+	delete seg;
+	remove(filename.c_str());
+	FFTPlanner::setWisdomFile(previous);
+}
+
+/* the complex transform which calculateMap() used before real transforms */
+void complex_calculate_map(ElementSegment *seg)
+{
+	seg->fft();
+
+	for (size_t i = 0; i < seg->nn(); i++)
+	{
+		VoxelElement &ve = seg->element(i);
+		ve.value[0] *= ve.scatter;
+		ve.value[1] *= ve.scatter;
+	}
+
+	seg->fft();
+}
+
+BOOST_AUTO_TEST_CASE(element_segment_real_transform_matches_complex_transform)
+{
+	std::vector<glm::vec3> positions = {glm::vec3(3.7, 4.6, 5.0),
+	                                    glm::vec3(2.1, 6.3, 1.2),
+	                                    glm::vec3(7.4, 0.8, 3.3)};
+
+	/* both even and odd box sizes */
+	for (int n : {12, 13})
+	{
+		ElementSegment *real = planned_segment(n);
+		ElementSegment *complex = planned_segment(n);
+		BOOST_REQUIRE(real->hasRealPlan());
+
+		for (ElementSegment *seg : {real, complex})
+		{
+			seg->setRoute(ElementSegment::Fourier);
+			seg->clear();
+			seg->addAtoms(positions);
+		}
+
+		real->calculateMap();
+		complex_calculate_map(complex);
+
+		float biggest = 0;
+		float worst = 0;
+		for (size_t i = 0; i < real->nn(); i++)
+		{
+			float expected = complex->element(i).value[0];
+			float diff = real->element(i).value[0] - expected;
+			biggest = std::max(biggest, fabsf(expected));
+			worst = std::max(worst, fabsf(diff));
+		}
+
+		BOOST_TEST(biggest > 0.f);
+		BOOST_TEST(worst <= 1e-4 * biggest);
+
+		delete real;
+		delete complex;
+	}
+}
@@ -0,0 +1,100 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// Please email: vagabond @ hginn.co.uk for more details.
+
+#include <vagabond/utils/include_boost.h>
+
+#include <vagabond/core/AtomGroup.h>
+#include <vagabond/core/Sequence.h>
+#include <vagabond/core/engine/ForceField.h>
+#include <memory>
+#include <cfloat>
+
+namespace tt = boost::test_tools;
+
+BOOST_AUTO_TEST_CASE(forcefield_contacts_match_search_over_all_pairs)
+{
+	/* outlives the force field, which detaches itself from the group */
+	Sequence seq("aaaaaaaa");
+	std::unique_ptr<AtomGroup> grp(seq.convertToAtoms());
+
+	/* atoms start at the origin, so place them along the chain */
+	grp->recalculate();
+
+	AtomVector atoms;
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+
+	for (size_t i = 0; i < grp->size(); i++)
+	{
+		Atom *a = (*grp)[i];
+		a->setInitialPosition(a->derivedPosition());
+
+		if (!a->hetatm() && a->elementSymbol() != "H")
+		{
+			atoms.push_back(a);
+			min = glm::min(min, a->initialPosition());
+			max = glm::max(max, a->initialPosition());
+		}
+	}
+
+	/* must span more than one cell of the contact sheet, and some pairs
+	 * must lie beyond the cutoff */
+	glm::vec3 extent = max - min;
+	BOOST_REQUIRE(std::max(extent.x, std::max(extent.y, extent.z)) > 10);
+
+	FFProperties props;
+	props.group = grp.get();
+	props.t = FFProperties::VdWContacts;
+
+	ForceField ff(props);
+	ff.setup();
+
+	std::vector<std::pair<Atom *, Atom *> > expected;
+	int beyond = 0;
+	for (size_t i = 0; i < atoms.size(); i++)
+	{
+		for (size_t j = i + 1; j < atoms.size(); j++)
+		{
+			glm::vec3 diff = atoms[i]->initialPosition() - 
+			atoms[j]->initialPosition();
+
+			if (glm::dot(diff, diff) >= 100)
+			{
+				beyond++;
+				continue;
+			}
+
+			if (atoms[i]->bondsBetween(atoms[j], 5) > 3)
+			{
+				expected.push_back(std::make_pair(atoms[i], atoms[j]));
+			}
+		}
+	}
+
+	BOOST_TEST(beyond > 0);
+	BOOST_TEST(expected.size() > 0);
+
+	const std::vector<ForceField::Restraint> &rs = ff.restraints();
+	BOOST_TEST(rs.size() == expected.size());
+
+	for (size_t i = 0; i < rs.size() && i < expected.size(); i++)
+	{
+		BOOST_TEST(rs[i].atoms[0] == expected[i].first);
+		BOOST_TEST(rs[i].atoms[1] == expected[i].second);
+	}
+}
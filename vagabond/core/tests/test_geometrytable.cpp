@@ -0,0 +1,71 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Please email: vagabond @ hginn.co.uk for more details.
+
+#include <vagabond/utils/include_boost.h>
+
+#include <vagabond/core/GeometryTable.h>
+
+namespace tt = boost::test_tools;
+
+/* no literal "." rows, so the fallback must come from the residue entries */
+void add_residue_geometry(GeometryTable &table)
+{
+	table.addGeometryLength("COD", "A", "B", 1.5, 0.02);
+	table.addGeometryLength("COD", "N", "C", 1.3, 0.02);
+	table.addGeometryAngle("COD", "A", "B", "C", 110, 2);
+}
+
+BOOST_AUTO_TEST_CASE(geometrytable_falls_back_to_any_residue_geometry)
+{
+	GeometryTable table;
+	add_residue_geometry(table);
+	table.filterPeptides(true);
+
+	BOOST_TEST(table.length("OTH", "A", "B") == 1.5);
+	BOOST_TEST(table.length("OTH", "B", "A") == 1.5);
+	BOOST_TEST(table.angle("OTH", "C", "B", "A") == 110);
+	BOOST_TEST(table.angleExists("OTH", "A", "B", "C"));
+
+	/* peptide bonds are still not borrowed from other residues */
+	BOOST_TEST(table.length("OTH", "N", "C") < 0);
+	BOOST_TEST(table.length("OTH", "A", "C") < 0);
+}
+
+BOOST_AUTO_TEST_CASE(geometrytable_link_geometry_is_not_a_fallback)
+{
+	GeometryTable table;
+	table.addGeometryLength("COD-OTH", "A", "B", 1.5, 0.02, true);
+	table.addGeometryAngle("COD-OTH", "A", "B", "C", 110, 2, true);
+	table.filterPeptides(true);
+
+	BOOST_TEST(table.length("OTH", "A", "B") < 0);
+	BOOST_TEST(table.angle("OTH", "A", "B", "C") < 0);
+}
+
+BOOST_AUTO_TEST_CASE(geometrytable_absorbed_table_keeps_fallback)
+{
+	GeometryTable other;
+	add_residue_geometry(other);
+
+	GeometryTable table;
+	table.absorb(other);
+	table.filterPeptides(true);
+
+	BOOST_TEST(table.length("OTH", "A", "B") == 1.5);
+	BOOST_TEST(table.angle("OTH", "A", "B", "C") == 110);
+}
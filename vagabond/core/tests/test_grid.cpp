@@ -19,6 +19,11 @@
 #include <vagabond/utils/include_boost.h>
 
 #include <vagabond/core/ArbitraryMap.h>
+#include <vagabond/core/ElementSegment.h>
+#include <vagabond/core/AtomSegment.h>
+#include <vagabond/core/AtomMap.h>
+#include <vagabond/core/engine/Correlator.h>
+#include <vagabond/utils/maths.h>
 #include <vagabond/core/MtzFile.h>
 #include <vagabond/core/matrix_functions.h>
 namespace tt = boost::test_tools;
@@ -50,3 +55,185 @@ BOOST_AUTO_TEST_CASE(test_grid_adds_other)
 	std::string str = test.write_to_string();
 	std::cout << str[0] << std::endl;
 }
+
+void prepare_segment(ElementSegment *seg)
+{
+	seg->setDimensions(20, 20, 20);
+	seg->setRealDim(0.7);
+	seg->setOrigin(glm::vec3(0.f));
+	seg->setElement("N");
+	seg->setStatus(FFT<VoxelElement>::Real);
+	seg->makePlans();
+	seg->clear();
+}
+
+double segment_correlation(ElementSegment &a, ElementSegment &b)
+{
+	double sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+	double n = a.nn();
+	for (size_t i = 0; i < a.nn(); i++)
+	{
+		double x = a.elementValue(i);
+		double y = b.elementValue(i);
+		sx += x; sy += y; sxx += x * x; syy += y * y; sxy += x * y;
+	}
+
+	return (sxy - sx * sy / n) / sqrt((sxx - sx * sx / n) * 
+	                                  (syy - sy * sy / n));
+}
+
+BOOST_AUTO_TEST_CASE(element_segment_direct_splat_matches_fourier)
+{
+	ElementSegment fourier, direct;
+	std::vector<glm::vec3> positions = {glm::vec3(3.7, 4.6, 5.0),
+	                                    glm::vec3(8.4, 8.4, 8.4)};
+
+	for (ElementSegment *seg : {&fourier, &direct})
+	{
+		prepare_segment(seg);
+	}
+
+	fourier.setRoute(ElementSegment::Fourier);
+	direct.setRoute(ElementSegment::Direct);
+
+	for (ElementSegment *seg : {&fourier, &direct})
+	{
+		seg->addAtoms(positions);
+		seg->calculateMap();
+	}
+
+	BOOST_TEST(direct.sum() == fourier.sum(), tt::tolerance(1e-3));
+	BOOST_TEST(segment_correlation(fourier, direct) > 0.999);
+}
+
+BOOST_AUTO_TEST_CASE(element_segment_mixed_routes_match_fourier)
+{
+	ElementSegment fourier, mixed;
+	std::vector<glm::vec3> first = {glm::vec3(3.7, 4.6, 5.0),
+	                                glm::vec3(2.1, 6.3, 1.2)};
+	std::vector<glm::vec3> second = {glm::vec3(8.4, 8.4, 8.4),
+	                                 glm::vec3(11.3, 2.2, 7.9)};
+
+	for (ElementSegment *seg : {&fourier, &mixed})
+	{
+		prepare_segment(seg);
+	}
+
+	fourier.setRoute(ElementSegment::Fourier);
+	fourier.addAtoms(first);
+	fourier.addAtoms(second);
+	fourier.calculateMap();
+
+	/* Fourier deposits must still be blurred after later splats */
+	mixed.setRoute(ElementSegment::Fourier);
+	mixed.addAtoms(first);
+	mixed.setRoute(ElementSegment::Direct);
+	mixed.addAtoms(second);
+	mixed.calculateMap();
+
+	BOOST_TEST(mixed.sum() == fourier.sum(), tt::tolerance(1e-3));
+	BOOST_TEST(segment_correlation(fourier, mixed) > 0.999);
+}
+
+BOOST_AUTO_TEST_CASE(interpolation_weights_reproduce_interpolate)
+{
+	ArbitraryMap *map = quickMap();
+	for (size_t i = 0; i < map->nn(); i++)
+	{
+		map->setReal(i, (float)((i * 37) % 11));
+	}
+
+	std::vector<glm::vec3> positions = {glm::vec3(0.3, 0.2, 0.1),
+	                                    glm::vec3(4.5, 5.8, 9.9),
+	                                    glm::vec3(-3.2, 12.7, 6.0),
+	                                    glm::vec3(2.0, 3.0, 4.0)};
+
+	for (const glm::vec3 &pos : positions)
+	{
+		long indices[11];
+		float weights[11];
+		map->interpolationWeights(pos, indices, weights);
+
+		float sum = 0;
+		for (size_t i = 0; i < 11; i++)
+		{
+			sum += weights[i] * map->elementValue(indices[i]);
+		}
+
+		BOOST_TEST(sum == map->interpolate(pos), tt::tolerance(1e-4));
+	}
+	
+	delete map;
+}
+
+/* correlation as Correlator used to find it, interpolating the segment at
+ * every comparison position */
+double interpolated_correlation(AtomSegment &seg, 
+                                const std::vector<glm::vec3> &positions,
+                                const std::vector<float> &values)
+{
+	CorrelData cd = empty_CD();
+
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		float test = seg.interpolate(positions[i]);
+		add_to_CD(&cd, values[i], test, test);
+	}
+
+	return evaluate_CD(cd);
+}
+
+void check_correlator(AtomSegment &seg, 
+                      const std::vector<glm::vec3> &positions, bool aligned)
+{
+	AtomMap templ(seg);
+
+	/* reference values follow the segment, with some noise */
+	std::vector<float> values;
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		float noise = (float)((i * 13) % 7) - 3.f;
+		values.push_back(seg.interpolate(positions[i]) + noise);
+	}
+
+	Correlator correlator(nullptr, nullptr);
+	correlator._template = &templ;
+	correlator._values = values;
+	correlator.prepareLookups(positions);
+	
+	BOOST_TEST(correlator._aligned == aligned);
+
+	double expected = interpolated_correlation(seg, positions, values);
+	double cc = correlator.correlation(&seg);
+
+	BOOST_TEST(cc == expected, tt::tolerance(1e-4));
+}
+
+BOOST_AUTO_TEST_CASE(correlator_matches_interpolated_correlation)
+{
+	AtomSegment seg;
+	seg.setDimensions(8, 8, 8, false);
+	seg.setRealDim(0.7);
+	seg.setOrigin(glm::vec3(-2.f, 1.f, 0.5f));
+	seg.setStatus(FFT<Density>::Real);
+
+	for (size_t i = 0; i < seg.nn(); i++)
+	{
+		seg.element(i).value[0] = (float)((i * 37) % 11);
+		seg.element(i).value[1] = 0;
+	}
+
+	/* more comparisons than one chunk, and not a whole number of lanes */
+	std::vector<glm::vec3> voxels, between;
+	for (size_t i = 0; i < 300; i++)
+	{
+		int x = i % 8; int y = (i / 8) % 8; int z = (i / 64) % 8;
+		voxels.push_back(seg.real(x, y, z));
+
+		glm::vec3 off = glm::vec3((i * 7) % 10, (i * 3) % 10, (i * 9) % 10);
+		between.push_back(seg.real(x, y, z) + off * 0.07f + 0.01f);
+	}
+
+	check_correlator(seg, voxels, true);
+	check_correlator(seg, between, false);
+}
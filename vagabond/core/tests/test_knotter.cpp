@@ -0,0 +1,216 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Please email: vagabond @ hginn.co.uk for more details.
+
+#include <vagabond/utils/include_boost.h>
+
+#include <vagabond/core/AtomGroup.h>
+#include <vagabond/core/Atom.h>
+#include <vagabond/core/Knotter.h>
+#include <vagabond/core/GeometryTable.h>
+#include <vagabond/core/BondLength.h>
+#include <vagabond/core/BondAngle.h>
+#include <vagabond/core/BondTorsion.h>
+
+namespace tt = boost::test_tools;
+
+typedef std::vector<Atom *> AtomList;
+
+/* cubic lattice of atoms 1.5 Angstroms apart, nudged off the lattice points.
+ * Names cycle through A, B and C so that only some neighbours are bonded,
+ * and one atom in fifty has no position at all. Each atom is its own
+ * residue, so bonds are found through the link geometry. */
+AtomList lattice_atoms(AtomGroup &group, int side)
+{
+	AtomList atoms;
+	const char *names[] = {"A", "B", "C"};
+	int n = 0;
+
+	for (int x = 0; x < side; x++)
+	{
+		for (int y = 0; y < side; y++)
+		{
+			for (int z = 0; z < side; z++)
+			{
+				glm::vec3 pos = glm::vec3(x, y, z) * 1.5f;
+				pos += glm::vec3(sin(n), cos(3 * n), sin(7 * n)) * 0.05f;
+
+				if (n % 50 == 49)
+				{
+					pos = glm::vec3(NAN);
+				}
+
+				Atom *a = new Atom();
+				a->setCode("LAT");
+				a->setAtomName(names[(x + 2 * y + 3 * z) % 3]);
+				a->setResidueId(std::to_string(n));
+				a->setInitialPosition(pos, 30);
+				group += a;
+				atoms.push_back(a);
+				n++;
+			}
+		}
+	}
+
+	return atoms;
+}
+
+GeometryTable lattice_table()
+{
+	GeometryTable table;
+	table.addGeometryLength("LAT", "A", "B", 1.5, 0.01, true);
+	table.addGeometryLength("LAT", "B", "C", 1.5, 0.01, true);
+
+	const char *names[] = {"A", "B", "C"};
+	for (size_t i = 0; i < 3; i++)
+	{
+		for (size_t j = 0; j < 3; j++)
+		{
+			for (size_t k = 0; k < 3; k++)
+			{
+				table.addGeometryAngle("LAT", names[i], names[j],
+				                       names[k], 90, 0.01, true);
+			}
+		}
+	}
+
+	return table;
+}
+
+void delete_lattice(AtomGroup *group, AtomList &atoms)
+{
+	delete group;
+	for (Atom *a : atoms)
+	{
+		delete a;
+	}
+}
+
+/* bond search over every pair of atoms, which the Knotter must match
+ * bond for bond and in the same order */
+std::vector<std::pair<Atom *, Atom *> > bonds_by_all_pairs(AtomList &atoms,
+                                                           GeometryTable &t)
+{
+	std::vector<std::pair<Atom *, Atom *> > bonds;
+
+	for (size_t i = 0; i < atoms.size(); i++)
+	{
+		for (size_t j = i + 1; j < atoms.size(); j++)
+		{
+			glm::vec3 diff = atoms[j]->derivedPosition() -
+			atoms[i]->derivedPosition();
+
+			if (fabs(diff.x) > 3 || fabs(diff.y) > 3 || fabs(diff.z) > 3)
+			{
+				continue;
+			}
+
+			std::string p = atoms[i]->atomName();
+			std::string q = atoms[j]->atomName();
+			double standard = t.length("LAT", p, q, true);
+
+			if (standard < 0)
+			{
+				standard = t.length("LAT", q, p, true);
+			}
+
+			if (standard >= 0 && glm::length(diff) < standard * 1.4)
+			{
+				bonds.push_back(std::make_pair(atoms[i], atoms[j]));
+			}
+		}
+	}
+
+	return bonds;
+}
+
+BOOST_AUTO_TEST_CASE(knotter_grid_bonds_match_search_over_all_pairs)
+{
+	AtomGroup *group = new AtomGroup();
+	group->setOwns(true);
+	AtomList atoms = lattice_atoms(*group, 22);
+	GeometryTable table = lattice_table();
+
+	Knotter knotter(group, &table);
+	knotter.setDoAngles(false);
+	knotter.knot();
+
+	std::vector<std::pair<Atom *, Atom *> > bonds;
+	bonds = bonds_by_all_pairs(atoms, table);
+
+	BOOST_TEST(bonds.size() > atoms.size());
+	BOOST_TEST(group->bondLengthCount() == bonds.size());
+
+	bool same = true;
+	for (size_t i = 0; i < bonds.size() && i < group->bondLengthCount(); i++)
+	{
+		BondLength *bl = group->bondLength(i);
+		same &= (bl->atom(0) == bonds[i].first);
+		same &= (bl->atom(1) == bonds[i].second);
+	}
+
+	BOOST_TEST(same);
+	delete_lattice(group, atoms);
+}
+
+BOOST_AUTO_TEST_CASE(knotter_torsions_match_search_over_all_angle_pairs)
+{
+	AtomGroup *group = new AtomGroup();
+	group->setOwns(true);
+	AtomList atoms = lattice_atoms(*group, 12);
+	GeometryTable table = lattice_table();
+
+	Knotter knotter(group, &table);
+	knotter.knot();
+
+	std::vector<std::vector<Atom *> > torsions;
+	for (size_t i = 0; i < group->bondAngleCount(); i++)
+	{
+		BondAngle *first = group->bondAngle(i);
+
+		for (size_t j = i + 1; j < group->bondAngleCount(); j++)
+		{
+			BondAngle *second = group->bondAngle(j);
+
+			if (first->formsTorsionWith(second))
+			{
+				std::vector<Atom *> quad(4);
+				first->getSequentialAtoms(second, &quad[0], &quad[1],
+				                          &quad[2], &quad[3]);
+				torsions.push_back(quad);
+			}
+		}
+	}
+
+	BOOST_TEST(torsions.size() > 0);
+	BOOST_TEST(group->bondTorsionCount() == torsions.size());
+
+	bool same = true;
+	for (size_t i = 0; i < torsions.size() &&
+	     i < group->bondTorsionCount(); i++)
+	{
+		BondTorsion *t = group->bondTorsion(i);
+
+		for (size_t j = 0; j < 4; j++)
+		{
+			same &= (t->atom(j) == torsions[i][j]);
+		}
+	}
+
+	BOOST_TEST(same);
+	delete_lattice(group, atoms);
+}
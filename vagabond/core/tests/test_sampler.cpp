@@ -0,0 +1,72 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// Please email: vagabond @ hginn.co.uk for more details.
+
+#include <vagabond/utils/include_boost.h>
+#include <vagabond/core/Sampler.h>
+#include <cmath>
+
+namespace tt = boost::test_tools;
+
+/* every sample expanded at once should match the same sample added to the
+ * mean one at a time through addToVec() */
+void compareExpandToAddToVec(int n, int dims, bool withTensor)
+{
+	Sampler sampler(n, dims);
+	sampler.setup();
+	
+	std::vector<float> mean(dims), tensor(dims * dims);
+	for (int i = 0; i < dims; i++)
+	{
+		mean[i] = cos(i * 0.7);
+		for (int j = 0; j < dims; j++)
+		{
+			tensor[i * dims + j] = sin(i * 1.3 + j * 0.4);
+		}
+	}
+	
+	float *t = (withTensor ? &tensor[0] : nullptr);
+
+	std::vector<float> out;
+	sampler.expand(&mean[0], t, dims, out);
+	BOOST_REQUIRE(out.size() == sampler.pointCount() * dims);
+
+	for (size_t s = 0; s < sampler.pointCount(); s++)
+	{
+		std::vector<float> vec = mean;
+		float *ptr = &vec[0];
+		sampler.addToVec(ptr, t, s);
+
+		for (int i = 0; i < dims; i++)
+		{
+			BOOST_TEST(out[s * dims + i] == vec[i], tt::tolerance(1e-4f));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(sampler_expand_matches_add_to_vec)
+{
+	/* 150 samples leave a part-filled tile at the end */
+	Sampler sampler(150, 4);
+	sampler.setup();
+	BOOST_TEST(sampler.pointCount() % 64 != 0);
+	BOOST_TEST(sampler.pointCount() > 64);
+
+	compareExpandToAddToVec(150, 4, true);
+	compareExpandToAddToVec(150, 4, false);
+	compareExpandToAddToVec(128, 3, true);
+}
@@ -0,0 +1,202 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Please email: vagabond @ hginn.co.uk for more details.
+
+#include <vagabond/utils/include_boost.h>
+
+#include <vagabond/core/AtomSnapshot.h>
+#include <vagabond/core/AtomContent.h>
+#include <vagabond/core/Atom.h>
+#include <vagabond/core/BondLength.h>
+#include <vagabond/core/BondAngle.h>
+#include <vagabond/core/BondTorsion.h>
+#include <vagabond/core/Chirality.h>
+#include <vagabond/core/HyperValue.h>
+#include <fstream>
+#include <cstdio>
+#include <unistd.h>
+#include "test_directory.h"
+
+namespace tt = boost::test_tools;
+
+std::string snapshot_model()
+{
+	return TestDirectory::file("snapshot_model.pdb");
+}
+
+void write_snapshot_model(std::string contents)
+{
+	std::ofstream file;
+	file.open(snapshot_model());
+	file << contents;
+	file.close();
+}
+
+/* points snapshots at a scratch directory for one test, then removes the
+ * model, any snapshots written and the directory, and restores the old
+ * snapshot directory - even if the test bails out early */
+struct SnapshotScratch
+{
+	SnapshotScratch() : previous(AtomSnapshot::directory())
+	{
+		AtomSnapshot::setDirectory(TestDirectory::file("snapshot_cache"));
+		write_snapshot_model("ATOM  snapshot test\n");
+	}
+
+	~SnapshotScratch()
+	{
+		for (const std::string &path : snapshots)
+		{
+			remove(path.c_str());
+		}
+
+		remove(snapshot_model().c_str());
+		rmdir(TestDirectory::file("snapshot_cache").c_str());
+		AtomSnapshot::setDirectory(previous);
+	}
+
+	void track(const AtomSnapshot &snapshot)
+	{
+		snapshots.push_back(snapshot.path());
+	}
+
+	std::string previous;
+	std::vector<std::string> snapshots;
+};
+
+/* five atoms in a row with every kind of bondstraint between them */
+AtomGroup *snapshot_group()
+{
+	AtomGroup *group = new AtomGroup();
+	group->setOwns(true);
+	const char *names[] = {"N", "CA", "C", "O", "CB"};
+
+	for (size_t i = 0; i < 5; i++)
+	{
+		Atom *a = new Atom();
+		a->setElementSymbol(std::string(names[i]).substr(0, 1));
+		a->setAtomName(names[i]);
+		a->setAtomNum(i + 10);
+		ResidueId id(4);
+		id.insert = "A";
+		a->setResidueId(id);
+		a->setChain("B");
+		a->setCode("ALA");
+		a->setOccupancy(0.5);
+		a->setInitialPosition(glm::vec3(i, i * i, -1.5 * i), 20 + i);
+		*group += a;
+	}
+
+	AtomGroup &g = *group;
+	new BondLength(group, g[0], g[1], 1.46);
+	new BondLength(group, g[1], g[2], 1.52);
+	new BondLength(group, g[2], g[3], 1.23);
+	new BondLength(group, g[1], g[4], 1.53);
+	new BondAngle(group, g[0], g[1], g[2], 111);
+	new BondAngle(group, g[1], g[2], g[3], 121);
+	BondTorsion *t = new BondTorsion(group, g[0], g[1], g[2], g[3], 180);
+	t->setConstrained(true);
+	new Chirality(group, g[1], g[0], g[2], g[4], -1);
+	new HyperValue(group, g[1], "puckering", 0.25);
+
+	return group;
+}
+
+void delete_snapshot_group(AtomGroup *group)
+{
+	for (size_t i = 0; i < group->size(); i++)
+	{
+		delete (*group)[i];
+	}
+
+	delete group;
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_restores_atoms_and_bondstraints)
+{
+	SnapshotScratch scratch;
+
+	AtomGroup *group = snapshot_group();
+	AtomSnapshot snapshot(snapshot_model(), File::KnotTorsions);
+	scratch.track(snapshot);
+	BOOST_REQUIRE(snapshot.valid());
+	BOOST_TEST(snapshot.load() == nullptr);
+
+	snapshot.save(group);
+	AtomContent *content = AtomSnapshot(snapshot_model(),
+	                                    File::KnotTorsions).load();
+	BOOST_REQUIRE(content != nullptr);
+
+	BOOST_TEST(content->size() == group->size());
+	for (size_t i = 0; i < group->size(); i++)
+	{
+		Atom *a = (*group)[i];
+		Atom *b = (*content)[i];
+		BOOST_TEST(a->desc() == b->desc());
+		BOOST_TEST(a->elementSymbol() == b->elementSymbol());
+		BOOST_TEST(a->atomNum() == b->atomNum());
+		BOOST_TEST(a->occupancy() == b->occupancy());
+		BOOST_TEST(a->initialBFactor() == b->initialBFactor());
+		BOOST_TEST(glm::length(a->initialPosition() -
+		                       b->derivedPosition()) == 0.f);
+		BOOST_TEST(a->bondLengthCount() == b->bondLengthCount());
+		BOOST_TEST(a->bondAngleCount() == b->bondAngleCount());
+		BOOST_TEST(a->bondTorsionCount() == b->bondTorsionCount());
+	}
+
+	BOOST_TEST(content->bondLengthCount() == 4);
+	BOOST_TEST(content->bondLength(3)->length() == 1.53);
+	BOOST_TEST(content->bondLength(3)->atom(1) == (*content)[4]);
+	BOOST_TEST(content->bondAngleCount() == 2);
+	BOOST_TEST(content->bondAngle(1)->angle() == 121);
+	BOOST_TEST(content->bondTorsionCount() == 1);
+	BOOST_TEST(content->bondTorsion(0)->isConstrained());
+	BOOST_TEST(content->bondTorsion(0)->atom(3) == (*content)[3]);
+	BOOST_TEST(content->chiralityCount() == 1);
+	BOOST_TEST(content->chirality(0)->sign() == -1);
+	BOOST_TEST(content->hyperValueCount() == 1);
+	BOOST_TEST(content->hyperValue(0)->name() == "puckering");
+	BOOST_TEST(content->hyperValue(0)->value() == 0.25);
+
+	delete content;
+	delete_snapshot_group(group);
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_is_ignored_when_file_or_level_changes)
+{
+	SnapshotScratch scratch;
+
+	AtomGroup *group = snapshot_group();
+	AtomSnapshot snapshot(snapshot_model(), File::KnotNone);
+	scratch.track(snapshot);
+	snapshot.save(group);
+	delete_snapshot_group(group);
+
+	AtomSnapshot other_level(snapshot_model(), File::KnotLengths);
+	BOOST_TEST(other_level.load() == nullptr);
+
+	write_snapshot_model("ATOM  snapshot test, changed\n");
+	AtomSnapshot other_file(snapshot_model(), File::KnotNone);
+	BOOST_TEST(other_file.load() == nullptr);
+
+	write_snapshot_model("ATOM  snapshot test\n");
+	AtomContent *content = AtomSnapshot(snapshot_model(),
+	                                    File::KnotNone).load();
+	BOOST_TEST(content != nullptr);
+
+	delete content;
+}
@@ -20,6 +20,8 @@
 
 #include <vagabond/core/AtomGroup.h>
 #include <vagabond/core/BondCalculator.h>
+#include <vagabond/core/ElementLibrary.h>
+#include <vagabond/core/engine/ContactSheet.h>
 
 namespace tt = boost::test_tools;
 
@@ -37,6 +39,7 @@ BOOST_AUTO_TEST_CASE(oxygen_atom_has_surface_area)
 	
 	BondCalculator calc;
 	calc.setPipelineType(BondCalculator::PipelineSolventSurfaceArea);
+	calc.setProbeRadius(0);
 	calc.addAnchorExtension(&a);
 	
 	calc.setup();
@@ -52,3 +55,113 @@ BOOST_AUTO_TEST_CASE(oxygen_atom_has_surface_area)
 	float area = r->surface_area;
 	BOOST_TEST(area == 29.0333, tt::tolerance(1e-2));
 }
+
+BOOST_AUTO_TEST_CASE(default_probe_gives_solvent_accessible_area)
+{
+	// probe of 1.4 Ang for water on top of oxygen radius of 1.52 Ang.
+	// surface: 4 * pi * 2.92^2 is 107.147 Ang^2.
+
+	Atom a;
+	a.setElementSymbol("O");
+	
+	AtomGroup grp;
+	grp += &a;
+	
+	BondCalculator calc;
+	calc.setPipelineType(BondCalculator::PipelineSolventSurfaceArea);
+	calc.addAnchorExtension(&a);
+	
+	calc.setup();
+	calc.start();
+	
+	Job job{};
+	job.requests = static_cast<JobType>(JobSolventSurfaceArea);
+
+	calc.submitJob(job);
+
+	Result *r = calc.acquireResult();
+	
+	float area = r->surface_area;
+	BOOST_TEST(area == 107.147, tt::tolerance(1e-2));
+}
+
+BOOST_AUTO_TEST_CASE(unknown_element_has_default_radius)
+{
+	ElementLibrary &lib = ElementLibrary::library();
+
+	size_t before = lib.warningCount();
+
+	BOOST_TEST(lib.vdwRadius("O") == 1.52f);
+	BOOST_TEST(lib.warningCount() == before);
+
+	BOOST_TEST(lib.vdwRadius("YB") == DEFAULT_VDW_RADIUS, 
+	           tt::tolerance(1e-4));
+	BOOST_TEST(lib.warningCount() == before + 1);
+	BOOST_TEST(lib.warning(before).find("yb") != std::string::npos);
+
+	/* only warned the first time for each element */
+	BOOST_TEST(lib.vdwRadius("YB") == DEFAULT_VDW_RADIUS, 
+	           tt::tolerance(1e-4));
+	BOOST_TEST(lib.warningCount() == before + 1);
+
+	BOOST_TEST(lib.vdwRadius("LU") == DEFAULT_VDW_RADIUS, 
+	           tt::tolerance(1e-4));
+	BOOST_TEST(lib.vdwRadius("LU") == DEFAULT_VDW_RADIUS, 
+	           tt::tolerance(1e-4));
+	BOOST_TEST(lib.warningCount() == before + 2);
+	BOOST_TEST(lib.warning(before + 1).find("lu") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(contact_sheet_finds_atoms_within_radius)
+{
+	Atom atoms[4];
+	std::vector<Atom *> list;
+	std::vector<glm::vec3> positions;
+
+	for (size_t i = 0; i < 4; i++)
+	{
+		list.push_back(&atoms[i]);
+		positions.push_back(glm::vec3(i * 1.5, 0, 0));
+	}
+
+	ContactSheet sheet;
+	sheet.updateSheet(list, positions);
+
+	const std::vector<int> &near = sheet.atomsNear(&atoms[0], 2.f);
+	BOOST_TEST(near.size() == 1);
+	BOOST_TEST(sheet.atom(near[0]) == &atoms[1]);
+
+	// small movements should not require the grid to be rebuilt
+	positions[2].x = 2.8;
+	sheet.updateSheet(list, positions);
+	BOOST_TEST(sheet.rebuildCount() == 1);
+	BOOST_TEST(sheet.atomsNear(&atoms[0], 2.9f).size() == 2);
+}
+
+BOOST_AUTO_TEST_CASE(contact_sheet_skips_atoms_without_finite_positions)
+{
+	Atom atoms[4];
+	std::vector<Atom *> list;
+	std::vector<glm::vec3> positions;
+
+	for (size_t i = 0; i < 4; i++)
+	{
+		list.push_back(&atoms[i]);
+		positions.push_back(glm::vec3(i * 1.5, 0, 0));
+	}
+
+	positions[1] = glm::vec3(NAN);
+	positions[3].y = INFINITY;
+
+	ContactSheet sheet;
+	sheet.updateSheet(list, positions);
+
+	BOOST_TEST(sheet.atomsNear(&atoms[0], 3.1f).size() == 1);
+	BOOST_TEST(sheet.atomsNear(&atoms[1], 3.1f).size() == 0);
+	BOOST_TEST(sheet.atomsNear(glm::vec3(NAN), 3.1f).size() == 0);
+
+	// an atom gaining a position must make it into the grid
+	positions[1] = glm::vec3(1.5, 0, 0);
+	sheet.updateSheet(list, positions);
+	BOOST_TEST(sheet.atomsNear(&atoms[0], 3.1f).size() == 2);
+}
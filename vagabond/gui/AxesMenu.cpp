@@ -23,6 +23,7 @@
 #include <vagabond/gui/elements/Choice.h>
 #include <vagabond/gui/elements/ImageButton.h>
 #include <vagabond/gui/elements/TextButton.h>
+#include <algorithm>
 
 AxesMenu::AxesMenu(Scene *prev) : ListView(prev)
 {
@@ -67,7 +68,8 @@ void AxesMenu::setup()
 
 size_t AxesMenu::lineCount()
 {
-	return _cluster->rows();
+	/* clusters may have calculated fewer axes than members */
+	return std::min(_cluster->rows(), _cluster->columns());
 }
 
 Renderable *AxesMenu::getLine(int i)
@@ -30,6 +30,9 @@
 #include <vagabond/gui/elements/AskForText.h>
 #include <vagabond/gui/elements/BadChoice.h>
 
+/* only the largest axes are calculated, to choose from in the axes menu */
+#define DISPLAY_AXES 12
+
 using namespace rope;
 
 RopeSpaceItem::RopeSpaceItem(Entity *entity) : Item()
@@ -172,7 +175,9 @@ void RopeSpaceItem::calculateCluster()
 		Environment::pathManager()->addPathsToMetadataGroup(&angles);
 		angles.normalise();
 
-		cx = new TorsionCluster(angles);
+		TorsionCluster *tc = new TorsionCluster(angles);
+		tc->setComponents(DISPLAY_AXES);
+		cx = tc;
 	}
 	else if (_type == ConfPositional)
 	{
@@ -180,7 +185,9 @@ void RopeSpaceItem::calculateCluster()
 		group.setWhiteList(_whiteList);
 		group.write(_entity->name() + "_atoms.csv");
 
-		cx = new PositionalCluster(group);
+		PositionalCluster *pc = new PositionalCluster(group);
+		pc->setComponents(DISPLAY_AXES);
+		cx = pc;
 	}
 
 	_cluster = cx;
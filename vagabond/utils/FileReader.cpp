@@ -11,6 +11,7 @@
 #include <sstream>
 #include <cerrno>
 #include <cmath>
+#include <cstdlib>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <dirent.h>
@@ -299,6 +300,41 @@ std::string findNewFolder(std::string prefix)
 	}
 }
 
+std::string user_cache_directory()
+{
+#ifdef __EMSCRIPTEN__
+	return "";
+#else
+	std::string base;
+	const char *xdg = getenv("XDG_CACHE_HOME");
+	const char *home = getenv("HOME");
+
+	if (xdg != nullptr && strlen(xdg) > 0)
+	{
+		base = xdg;
+	}
+	else if (home != nullptr && strlen(home) > 0)
+	{
+		base = std::string(home) + "/.cache";
+	}
+	else
+	{
+		return "";
+	}
+
+	FileReader::makeDirectoryIfNeeded(base);
+	std::string dir = base + "/rope";
+	FileReader::makeDirectoryIfNeeded(dir);
+
+	if (!is_directory(dir))
+	{
+		return "";
+	}
+
+	return dir;
+#endif
+}
+
 bool is_str_alphabetical(const std::string &str)
 {
 	for (size_t i = 0; i < str.length(); i++)
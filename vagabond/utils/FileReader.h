@@ -57,6 +57,11 @@ std::string f_to_str(double val, int precision);
 
 std::string findNewFolder(std::string prefix = "refine_");
 
+/** per-user directory for files which can be regenerated, i.e. 
+ *  $XDG_CACHE_HOME/rope or ~/.cache/rope, created if needed.
+ *  @returns empty string if there is no such directory */
+std::string user_cache_directory();
+
 bool is_str_alphabetical(const std::string &str);
 
 /* Random string things */
@@ -20,6 +20,7 @@
 #define __vagabond__Mapping__
 
 #include "Face.h"
+#include "SimplexGrid.h"
 #include <map>
 #include <float.h>
 
@@ -189,6 +190,7 @@ public:
 
 		face->changed();
 		_mapped.push_back(face);
+		_grid.invalidate();
 	}
 	
 	HyperTriangle *face(int idx)
@@ -230,6 +232,8 @@ public:
 		{
 			_mapped.erase(it);
 		}
+
+		_grid.invalidate();
 	}
 	
 	virtual void remove_point(int idx)
@@ -295,6 +299,7 @@ public:
 	virtual void set_point_vector(int i, const float *coords)
 	{
 		_points[i]->set_vector(coords);
+		_grid.invalidate();
 	}
 
 	virtual std::vector<float> point_vector(int i)
@@ -619,15 +624,7 @@ public:
 
 	virtual int face_idx_for_point(const std::vector<float> &point)
 	{
-		for (size_t i = 0; i < _mapped.size(); i++)
-		{
-			if (face_has_point(i, point))
-			{
-				return i;
-			}
-		}
-
-		return -1;
+		return locate_face(point);
 	}
 
 	template <typename Vec, typename Wec>
@@ -683,15 +680,8 @@ public:
 	
 	HyperTriangle *face_for_point(const std::vector<float> &point) const
 	{
-		for (int i = 0; i < _mapped.size(); i++)
-		{
-			if (face_has_point(i, point))
-			{
-				return _mapped[i];
-			}
-		}
-
-		return nullptr;
+		int idx = locate_face(point);
+		return (idx >= 0 ? _mapped[idx] : nullptr);
 	}
 
 	virtual size_t point_count_for_face(int idx) const
@@ -737,6 +727,8 @@ public:
 
 	virtual void update(int idx)
 	{
+		_grid.invalidate();
+
 		if (idx >= 0)
 		{
 			for (HyperTriangle *ht : _members[_points[idx]])
@@ -806,6 +798,112 @@ public:
 	friend void from_json(const json &j, Mapping<D, Type> &face);
 protected:
 private:
+	/* successive queries tend to be close together, so first try the last
+	 * face found and walk a few faces from it towards the point, before
+	 * looking in the grid bucket for the point. May be called from many
+	 * threads, as long as none of them changes the mapping meanwhile */
+	int locate_face(const std::vector<float> &point) const
+	{
+		prepare_grid();
+
+		int last = _grid.last();
+		for (int step = 0; last >= 0 && step < 4 * D; step++)
+		{
+			if (face_has_point(last, point))
+			{
+				_grid.setLast(last);
+				return last;
+			}
+
+			/* cross the side opposite the most negative weight */
+			std::vector<float> bcp = _mapped[last]->point_to_barycentric(point);
+			int worst = std::min_element(bcp.begin(), bcp.end()) - bcp.begin();
+			last = _grid.neighbour(last, worst);
+		}
+
+		for (const int &idx : _grid.candidates(point))
+		{
+			if (face_has_point(idx, point))
+			{
+				_grid.setLast(idx);
+				return idx;
+			}
+		}
+
+		return -1;
+	}
+
+	void prepare_grid() const
+	{
+		if (_grid.valid())
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(_grid.mutex());
+		if (_grid.valid())
+		{
+			return;
+		}
+
+		std::map<HyperPoint *, std::vector<int> > members;
+		std::vector<float> mins, maxs;
+		mins.reserve(_mapped.size() * D);
+		maxs.reserve(_mapped.size() * D);
+
+		for (size_t i = 0; i < _mapped.size(); i++)
+		{
+			std::vector<float> min, max;
+			_mapped[i]->bounds(min, max);
+			mins.insert(mins.end(), min.begin(), min.end());
+			maxs.insert(maxs.end(), max.begin(), max.end());
+
+			for (size_t j = 0; j < _mapped[i]->pointCount(); j++)
+			{
+				members[&_mapped[i]->v_point(j)].push_back(i);
+			}
+		}
+
+		/* neighbour across from vertex j shares every other vertex */
+		std::vector<int> neighbours(_mapped.size() * (D + 1), -1);
+		for (size_t i = 0; i < _mapped.size(); i++)
+		{
+			HyperTriangle *face = _mapped[i];
+			for (size_t j = 0; j <= D && j < face->pointCount(); j++)
+			{
+				HyperPoint *other = &face->v_point(j == 0 ? 1 : 0);
+
+				for (const int &cand : members[other])
+				{
+					if (cand == i || _mapped[cand]->hasPoint(face->v_point(j)))
+					{
+						continue;
+					}
+
+					bool shared = true;
+					for (size_t k = 0; k < face->pointCount(); k++)
+					{
+						if (k != j && !_mapped[cand]->hasPoint(face->v_point(k)))
+						{
+							shared = false;
+							break;
+						}
+					}
+
+					if (shared)
+					{
+						neighbours[i * (D + 1) + j] = cand;
+						break;
+					}
+				}
+			}
+		}
+
+		_grid.build(mins, maxs, neighbours);
+	}
+
+	mutable SimplexGrid<D> _grid;
+
 	std::vector<HyperPoint *> _points;
 	std::vector<HyperTriangle *> _mapped;
 
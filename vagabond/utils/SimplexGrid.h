@@ -0,0 +1,218 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Please email: vagabond @ hginn.co.uk for more details.
+
+#ifndef __vagabond__SimplexGrid__
+#define __vagabond__SimplexGrid__
+
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <cmath>
+#include <float.h>
+
+/** \class SimplexGrid
+ *  uniform grid of buckets over the bounding boxes of the faces of a
+ *  Mapping, so that finding the face holding a point only tests the faces
+ *  in the point's bucket. Also keeps the neighbours of each face and the
+ *  last face found, so that nearby queries can walk from there instead.
+ *  Copies start out empty and are rebuilt on first use.
+ *  Many threads may look up faces at once, and only one of them rebuilds
+ *  the grid. Changing the Mapping invalidates the grid and must not 
+ *  overlap with lookups, as the faces themselves change underneath. */
+
+template <unsigned int D>
+class SimplexGrid
+{
+public:
+	SimplexGrid() {}
+
+	SimplexGrid(const SimplexGrid<D> &other) {}
+
+	SimplexGrid<D> &operator=(const SimplexGrid<D> &other)
+	{
+		invalidate();
+		return *this;
+	}
+
+	/** waits for any rebuild in progress, which would otherwise finish
+	 *  by marking the grid valid again */
+	void invalidate()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_valid = false;
+		_last = -1;
+	}
+
+	bool valid() const
+	{
+		return _valid;
+	}
+
+	/** held while building, so that only one thread does so */
+	std::mutex &mutex()
+	{
+		return _mutex;
+	}
+
+	/** @param mins minimum corner of each face's bounding box, D per face
+	 *  @param maxs maximum corner of each face's bounding box, D per face
+	 *  @param neighbours for each face, the D+1 faces across from each of
+	 *  its vertices in order, or -1 if there is none */
+	void build(const std::vector<float> &mins, const std::vector<float> &maxs,
+	           const std::vector<int> &neighbours)
+	{
+		size_t faces = mins.size() / D;
+		_neighbours = neighbours;
+		_buckets.clear();
+
+		for (size_t k = 0; k < D; k++)
+		{
+			_min[k] = FLT_MAX;
+			_max[k] = -FLT_MAX;
+		}
+
+		for (size_t i = 0; i < faces; i++)
+		{
+			for (size_t k = 0; k < D; k++)
+			{
+				_min[k] = std::min(_min[k], mins[i * D + k]);
+				_max[k] = std::max(_max[k], maxs[i * D + k]);
+			}
+		}
+
+		/* roughly one face per bucket */
+		_res = std::max(1, (int)lrint(pow(faces, 1. / D)));
+		size_t total = 1;
+		for (size_t k = 0; k < D; k++)
+		{
+			_size[k] = (_max[k] - _min[k]) / _res;
+			if (_size[k] <= 0)
+			{
+				_size[k] = 1;
+			}
+
+			total *= _res;
+		}
+
+		_buckets.resize(faces > 0 ? total : 0);
+
+		for (size_t i = 0; i < faces; i++)
+		{
+			int lo[D], hi[D], cur[D];
+			for (size_t k = 0; k < D; k++)
+			{
+				lo[k] = cell(mins[i * D + k], k);
+				hi[k] = cell(maxs[i * D + k], k);
+				cur[k] = lo[k];
+			}
+
+			/* every bucket the bounding box touches */
+			while (true)
+			{
+				_buckets[bucket(cur)].push_back(i);
+
+				size_t k = 0;
+				for (; k < D; k++)
+				{
+					cur[k]++;
+					if (cur[k] <= hi[k])
+					{
+						break;
+					}
+					cur[k] = lo[k];
+				}
+
+				if (k == D)
+				{
+					break;
+				}
+			}
+		}
+
+		_last = -1;
+		_valid = true;
+	}
+
+	/** faces whose bounding boxes may contain the point, in face order */
+	const std::vector<int> &candidates(const std::vector<float> &point) const
+	{
+		int cur[D];
+
+		for (size_t k = 0; k < D; k++)
+		{
+			if (_buckets.size() == 0 || point[k] != point[k] ||
+			    point[k] < _min[k] || point[k] > _max[k])
+			{
+				return _empty;
+			}
+
+			cur[k] = cell(point[k], k);
+		}
+
+		return _buckets[bucket(cur)];
+	}
+
+	/** face across from vertex v of face f, or -1 */
+	int neighbour(int f, int v) const
+	{
+		return _neighbours[f * (D + 1) + v];
+	}
+
+	int last() const
+	{
+		return _last;
+	}
+
+	void setLast(int f)
+	{
+		_last = f;
+	}
+private:
+	int cell(float val, int k) const
+	{
+		int c = floor((val - _min[k]) / _size[k]);
+		return std::min(std::max(c, 0), _res - 1);
+	}
+
+	size_t bucket(const int *cur) const
+	{
+		size_t idx = 0;
+		for (int k = D - 1; k >= 0; k--)
+		{
+			idx = idx * _res + cur[k];
+		}
+
+		return idx;
+	}
+
+	std::vector<std::vector<int> > _buckets;
+	std::vector<int> _neighbours;
+	std::vector<int> _empty;
+
+	float _min[D];
+	float _max[D];
+	float _size[D];
+	int _res = 1;
+
+	std::atomic<bool> _valid{false};
+	std::atomic<int> _last{-1};
+	std::mutex _mutex;
+};
+
+#endif
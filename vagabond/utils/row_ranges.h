@@ -0,0 +1,53 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Please email: vagabond @ hginn.co.uk for more details.
+
+#ifndef __vagabond__row_ranges__
+#define __vagabond__row_ranges__
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <vector>
+
+/** splits rows into contiguous ranges, one for each hardware thread, and
+ *  calls job(start, end) for each range at the same time. The first range
+ *  runs on the calling thread. */
+inline void for_row_ranges(size_t rows, 
+                           const std::function<void(size_t, size_t)> &job)
+{
+	size_t threads = std::max(1u, std::thread::hardware_concurrency());
+	threads = std::min(threads, rows / 16 + 1);
+	size_t per = (rows + threads - 1) / threads;
+
+	std::vector<std::thread> workers;
+	for (size_t t = 1; t < threads; t++)
+	{
+		size_t start = std::min(rows, t * per);
+		size_t end = std::min(rows, start + per);
+		workers.push_back(std::thread(job, start, end));
+	}
+
+	job(0, std::min(rows, per));
+
+	for (std::thread &w : workers)
+	{
+		w.join();
+	}
+}
+
+#endif
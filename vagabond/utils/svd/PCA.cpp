@@ -23,9 +23,101 @@
 #include "matrix.h"
 #include <iostream>
 #include <stdexcept>
+#include <random>
+#include "../row_ranges.h"
 
 using namespace PCA;
 
+/* out = a * b */
+static void multiply(const Matrix &a, const Matrix &b, Matrix &out)
+{
+	for_row_ranges(a.rows, [&a, &b, &out](size_t start, size_t end)
+	{
+		for (size_t i = start; i < end; i++)
+		{
+			double *dest = out[i];
+			memset(dest, '\0', sizeof(double) * out.cols);
+
+			for (size_t k = 0; k < a.cols; k++)
+			{
+				const double v = a[i][k];
+				const double *src = b[k];
+
+				for (size_t j = 0; j < b.cols; j++)
+				{
+					dest[j] += v * src[j];
+				}
+			}
+		}
+	});
+}
+
+/* out = a' * b, with each thread owning a range of output rows while
+ * reading through a row by row */
+static void multiplyTransposed(const Matrix &a, const Matrix &b, Matrix &out)
+{
+	for_row_ranges(a.cols, [&a, &b, &out](size_t start, size_t end)
+	{
+		for (size_t i = start; i < end; i++)
+		{
+			memset(out[i], '\0', sizeof(double) * out.cols);
+		}
+
+		for (size_t k = 0; k < a.rows; k++)
+		{
+			const double *src = b[k];
+
+			for (size_t i = start; i < end; i++)
+			{
+				const double v = a[k][i];
+				double *dest = out[i];
+
+				for (size_t j = 0; j < b.cols; j++)
+				{
+					dest[j] += v * src[j];
+				}
+			}
+		}
+	});
+}
+
+/* modified Gram-Schmidt on the columns, twice over for stability. Columns
+ * which vanish are left as zero */
+static void orthonormalise(Matrix &m)
+{
+	for (size_t j = 0; j < m.cols; j++)
+	{
+		for (size_t pass = 0; pass < 2; pass++)
+		{
+			for (size_t k = 0; k < j; k++)
+			{
+				double dot = 0;
+				for (size_t i = 0; i < m.rows; i++)
+				{
+					dot += m[i][j] * m[i][k];
+				}
+
+				for (size_t i = 0; i < m.rows; i++)
+				{
+					m[i][j] -= dot * m[i][k];
+				}
+			}
+		}
+
+		double sq = 0;
+		for (size_t i = 0; i < m.rows; i++)
+		{
+			sq += m[i][j] * m[i][j];
+		}
+
+		double scale = (sq > 1e-24 ? 1 / sqrt(sq) : 0);
+		for (size_t i = 0; i < m.rows; i++)
+		{
+			m[i][j] *= scale;
+		}
+	}
+}
+
 void PCA::setupMatrix(Matrix *mat, int rows, int cols)
 {
 	mat->vals = (double *)calloc(rows * cols, sizeof(double));
@@ -108,6 +200,99 @@ bool PCA::runSVD(SVD *cc)
 	return true;
 }
 
+bool PCA::runTruncatedSVD(const Matrix &mat, SVD *cc, int rank, 
+                          int oversample, int iterations)
+{
+	int smallest = std::min(mat.rows, mat.cols);
+	rank = std::min(rank, smallest);
+	int l = std::min(rank + oversample, smallest);
+
+	if (rank <= 0)
+	{
+		throw std::runtime_error("Truncated SVD needs at least one component");
+	}
+
+	/* range of mat is sampled by random directions */
+	Matrix omega, y, z;
+	setupMatrix(&omega, mat.cols, l);
+	setupMatrix(&y, mat.rows, l);
+	setupMatrix(&z, mat.cols, l);
+
+	std::mt19937 generator(1);
+	std::normal_distribution<double> normal;
+	for (size_t i = 0; i < mat.cols * l; i++)
+	{
+		omega.vals[i] = normal(generator);
+	}
+
+	multiply(mat, omega, y);
+	orthonormalise(y);
+
+	for (size_t i = 0; i < iterations; i++)
+	{
+		multiplyTransposed(mat, y, z);
+		orthonormalise(z);
+		multiply(mat, z, y);
+		orthonormalise(y);
+	}
+
+	/* y now holds an orthonormal basis Q for the range. z = mat' Q is the
+	 * transpose of the small l x cols projection, so that if z = U S V'
+	 * then mat = (Q V) S U' */
+	multiplyTransposed(mat, y, z);
+
+	SVD small{};
+	setupSVD(&small, mat.cols, l);
+	copyMatrix(small.u, z);
+
+	try
+	{
+		runSVD(&small);
+	}
+	catch (const std::runtime_error &err)
+	{
+		freeMatrix(&omega);
+		freeMatrix(&y);
+		freeMatrix(&z);
+		freeSVD(&small);
+		throw;
+	}
+
+	reorderSVD(&small);
+
+	Matrix left;
+	setupMatrix(&left, mat.rows, l);
+	multiply(y, small.v, left);
+
+	setupMatrix(&cc->u, mat.rows, rank);
+	setupMatrix(&cc->v, mat.cols, rank);
+	cc->w = (double *)calloc(rank, sizeof(double));
+	cc->N = (double *)calloc(rank, sizeof(double));
+
+	for (size_t j = 0; j < rank; j++)
+	{
+		cc->w[j] = small.w[j];
+
+		for (size_t i = 0; i < mat.rows; i++)
+		{
+			cc->u[i][j] = left[i][j];
+		}
+
+		for (size_t i = 0; i < mat.cols; i++)
+		{
+			cc->v[i][j] = small.u[i][j];
+		}
+	}
+
+	freeMatrix(&omega);
+	freeMatrix(&y);
+	freeMatrix(&z);
+	freeMatrix(&left);
+	freeSVD(&small);
+
+	return true;
+}
+
 bool PCA::order_by_w(const OrderW &a, const OrderW &b) 
 {
 	return a.w > b.w;
@@ -90,6 +90,17 @@ namespace PCA
 	Matrix distancesFrom(Matrix &m);
 
 	bool runSVD(SVD *cc);
+
+	/** randomised SVD (Halko, Martinsson and Tropp 2011) returning only the
+	 *  largest components of a matrix, in descending order. Allocates
+	 *  cc->u as rows x rank, cc->w as rank and cc->v as cols x rank.
+	 *  @param mat matrix to decompose, left untouched
+	 *  @param rank number of components to keep
+	 *  @param oversample extra random directions for accuracy
+	 *  @param iterations power iterations, for slowly decaying spectra */
+	bool runTruncatedSVD(const Matrix &mat, SVD *cc, int rank, 
+	                     int oversample = 10, int iterations = 2);
+
 	bool order_by_w(const OrderW &a, const OrderW &b);
 
 }
@@ -0,0 +1,63 @@
+#include "../svd/PCA.h"
+#include <iostream>
+
+using namespace PCA;
+
+int main()
+{
+	int rows = 80;
+	int cols = 50;
+	int rank = 4;
+
+	Matrix mat;
+	setupMatrix(&mat, rows, cols);
+
+	for (size_t i = 0; i < rows; i++)
+	{
+		for (size_t j = 0; j < cols; j++)
+		{
+			mat[i][j] = 5 * sin(i * 0.3 + j * 0.1) + 2 * cos(i * 0.7 - j * 0.2)
+			+ 0.01 * sin(i * 17.1 + j * 31.7);
+		}
+	}
+
+	SVD full;
+	setupSVD(&full, rows, cols);
+	copyMatrix(full.u, mat);
+	runSVD(&full);
+	reorderSVD(&full);
+
+	SVD part{};
+	runTruncatedSVD(mat, &part, rank);
+
+	for (size_t j = 0; j < rank; j++)
+	{
+		double diff = fabs(part.w[j] - full.w[j]);
+		if (diff > 1e-6 * full.w[0])
+		{
+			std::cout << "Component " << j << " has value " << part.w[j] 
+			<< " but full SVD has " << full.w[j] << std::endl;
+			return 1;
+		}
+		
+		/* vectors may differ in sign only */
+		double dot = 0;
+		for (size_t i = 0; i < rows; i++)
+		{
+			dot += part.u[i][j] * full.u[i][j];
+		}
+
+		if (full.w[j] > 1e-3 * full.w[0] && fabs(fabs(dot) - 1) > 1e-4)
+		{
+			std::cout << "Component " << j << " vectors overlap by " << dot
+			<< std::endl;
+			return 1;
+		}
+	}
+
+	freeSVD(&full);
+	freeSVD(&part);
+	freeMatrix(&mat);
+
+	return 0;
+}
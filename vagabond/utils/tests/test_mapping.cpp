@@ -0,0 +1,173 @@
+// vagabond
+// Copyright (C) 2022 Helen Ginn
+// 
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// 
+// Please email: vagabond @ hginn.co.uk for more details.
+
+#include <vagabond/utils/include_boost.h>
+#include <vagabond/utils/Face.h>
+#include <vagabond/utils/Mapping.h>
+#include <random>
+#include <thread>
+
+namespace tt = boost::test_tools;
+
+typedef SharedFace<0, 2, float> Point2;
+
+/* jittered square grid cut into two triangles per square */
+std::vector<Point2 *> triangulate(Mapping<2, float> &map, int n, 
+                                  std::mt19937 &gen)
+{
+	std::uniform_real_distribution<float> jitter(-0.3, 0.3);
+	std::vector<Point2 *> points;
+
+	for (int j = 0; j <= n; j++)
+	{
+		for (int i = 0; i <= n; i++)
+		{
+			float x = i + (i > 0 && i < n ? jitter(gen) : 0);
+			float y = j + (j > 0 && j < n ? jitter(gen) : 0);
+			points.push_back(new Point2({x, y}, x + y));
+		}
+	}
+
+	for (int j = 0; j < n; j++)
+	{
+		for (int i = 0; i < n; i++)
+		{
+			Point2 *a = points[j * (n + 1) + i];
+			Point2 *b = points[j * (n + 1) + i + 1];
+			Point2 *c = points[(j + 1) * (n + 1) + i];
+			Point2 *d = points[(j + 1) * (n + 1) + i + 1];
+			map.add_simplex({a, b, d});
+			map.add_simplex({a, d, c});
+		}
+	}
+
+	return points;
+}
+
+int linear_face_for_point(Mapping<2, float> &map, 
+                          const std::vector<float> &pt)
+{
+	for (size_t i = 0; i < map.faceCount(); i++)
+	{
+		if (map.face_has_point(i, pt))
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/* points on shared edges belong to more than one face, so the lookup need
+ * only find a face holding the point whenever the scan finds one */
+int mismatches(Mapping<2, float> &map, int n, std::mt19937 &gen)
+{
+	std::uniform_real_distribution<float> coord(-1.5, n + 1.5);
+	int bad = 0;
+
+	for (size_t i = 0; i < 2000; i++)
+	{
+		std::vector<float> pt = {coord(gen), coord(gen)};
+
+		int found = map.face_idx_for_point(pt);
+		int expected = linear_face_for_point(map, pt);
+
+		if ((found < 0) != (expected < 0))
+		{
+			bad++;
+		}
+		else if (found >= 0 && !map.face_has_point(found, pt))
+		{
+			bad++;
+		}
+	}
+
+	return bad;
+}
+
+BOOST_AUTO_TEST_CASE(mapping_lookup_matches_linear_scan)
+{
+	std::mt19937 gen(1);
+	Mapping<2, float> map;
+	std::vector<Point2 *> points = triangulate(map, 12, gen);
+
+	BOOST_TEST(map.faceCount() == 2 * 12 * 12);
+	BOOST_TEST(mismatches(map, 12, gen) == 0);
+
+	for (Point2 *p : points)
+	{
+		delete p;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(mapping_lookup_matches_linear_scan_after_moving_points)
+{
+	std::mt19937 gen(2);
+	Mapping<2, float> map;
+	std::vector<Point2 *> points = triangulate(map, 8, gen);
+	BOOST_TEST(mismatches(map, 8, gen) == 0);
+
+	/* stretch the mapping, which must rebuild the lookup grid */
+	for (size_t i = 0; i < map.pointCount(); i++)
+	{
+		std::vector<float> v = map.point_vector(i);
+		float moved[] = {v[0] * 1.5f, v[1] * 0.5f};
+		map.set_point_vector(i, moved);
+	}
+
+	BOOST_TEST(mismatches(map, 8, gen) == 0);
+
+	for (Point2 *p : points)
+	{
+		delete p;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(mapping_lookup_matches_linear_scan_from_many_threads)
+{
+	std::mt19937 gen(3);
+	Mapping<2, float> map;
+	std::vector<Point2 *> points = triangulate(map, 10, gen);
+
+	/* first lookups all arrive before the grid has been built */
+	std::vector<int> bad(4, 0);
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < bad.size(); i++)
+	{
+		threads.push_back(std::thread([&map, &bad, i]()
+		{
+			std::mt19937 mine(10 + i);
+			bad[i] = mismatches(map, 10, mine);
+		}));
+	}
+
+	for (std::thread &t : threads)
+	{
+		t.join();
+	}
+
+	for (const int &b : bad)
+	{
+		BOOST_TEST(b == 0);
+	}
+
+	for (Point2 *p : points)
+	{
+		delete p;
+	}
+}